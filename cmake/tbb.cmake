@@ -16,6 +16,5 @@ add_dependencies(libtbb tbb)
 target_link_libraries(libtbb INTERFACE
     ${binary_dir}/libtbb.so
     ${binary_dir}/libtbbmalloc.so
-    ${binary_dir}/libtbbmalloc_proxy.so
 )
 set(TBB_INC ${source_dir}/include)
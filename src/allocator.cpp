@@ -0,0 +1,304 @@
+/**
+ * @file allocator.cpp
+ *
+ * The allocators that can be chosen, and the pool.
+ */
+
+#include <malloc.h>
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+
+#include "tbb/scalable_allocator.h"
+
+#include "allocator.h"
+#include "util.h"
+
+// Exported by tbbmalloc for its malloc replacement. They tell the objects of
+// scalable_malloc from others, which they hand to the function given, so
+// memory from before TBB was chosen can still be freed.
+extern "C" void __TBB_malloc_safer_free(void *ptr,
+                                        void (*originalFree)(void *));
+extern "C" size_t __TBB_malloc_safer_msize(void *ptr,
+                                           size_t (*originalMsize)(void *));
+
+constexpr size_t Pool::kGranule;
+constexpr size_t Pool::kMaxBytes;
+constexpr size_t Pool::kClasses;
+constexpr size_t Pool::kSpanBytes;
+constexpr size_t Pool::kArenaBytes;
+
+namespace {
+
+std::atomic<Allocator> chosen{Allocator::Glibc};
+// Set once TBB has been chosen, after which any pointer may be its.
+std::atomic<bool> tbbUsed{false};
+
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+/**
+ * The address space of the pool, reserved up front and handed out a span at
+ * a time. All blocks of a span are of one size class, so the class of a
+ * block is found from its address, with no header.
+ */
+struct Arena {
+  static constexpr size_t kSpans = Pool::kArenaBytes / Pool::kSpanBytes;
+
+  char *base{nullptr};
+  std::atomic<size_t> nextSpan{0};
+  unsigned char spanClass[kSpans];
+  // The blocks of threads that have exited, by class.
+  std::mutex mutex;
+  FreeBlock *orphans[Pool::kClasses];
+
+  Arena() noexcept {
+    void *p = mmap(nullptr, Pool::kArenaBytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p != MAP_FAILED)
+      base = static_cast<char *>(p);
+  }
+
+  bool Owns(const void *ptr) const noexcept {
+    auto p = static_cast<const char *>(ptr);
+    return base and p >= base and p < base + Pool::kArenaBytes;
+  }
+
+  size_t ClassOf(const void *ptr) const noexcept {
+    auto offset = static_cast<const char *>(ptr) - base;
+    return spanClass[offset / Pool::kSpanBytes];
+  }
+};
+
+// Zero-initialized, and constructed on first use of the pool only.
+std::atomic<Arena *> arena{nullptr};
+
+Arena *poolArena() noexcept {
+  static Arena instance;
+  if (not arena.load(std::memory_order_acquire))
+    arena.store(&instance, std::memory_order_release);
+  return &instance;
+}
+
+size_t blockSize(size_t cls) noexcept { return (cls + 1) * Pool::kGranule; }
+
+/**
+ * The blocks a thread has to hand out: those freed on it, and the rest of the
+ * last span it took for each class. When the thread exits its free blocks
+ * are left to the arena for the others.
+ */
+struct PoolCache {
+  FreeBlock *free[Pool::kClasses];
+  char *next[Pool::kClasses];
+  char *end[Pool::kClasses];
+
+  ~PoolCache() {
+    auto a = arena.load(std::memory_order_acquire);
+    if (not a)
+      return;
+    std::lock_guard<std::mutex> lock(a->mutex);
+    for (size_t cls = 0; cls < Pool::kClasses; ++cls) {
+      while (auto block = free[cls]) {
+        free[cls] = block->next;
+        block->next = a->orphans[cls];
+        a->orphans[cls] = block;
+      }
+    }
+  }
+
+  void *Refill(Arena &a, size_t cls) noexcept {
+    {
+      std::lock_guard<std::mutex> lock(a.mutex);
+      if (auto block = a.orphans[cls]) {
+        a.orphans[cls] = block->next;
+        return block;
+      }
+    }
+    auto span = a.nextSpan.fetch_add(1, std::memory_order_relaxed);
+    if (span >= Arena::kSpans)
+      return nullptr;
+    a.spanClass[span] = cls;
+    auto first = a.base + span * Pool::kSpanBytes;
+    auto size = blockSize(cls);
+    next[cls] = first + size;
+    end[cls] = first + Pool::kSpanBytes / size * size;
+    return first;
+  }
+};
+
+thread_local PoolCache poolCache;
+
+/**
+ * @return A block of at least bytes from the pool, or nullptr if they are
+ *  too many for it or it is out of space.
+ */
+void *poolAllocate(size_t bytes) noexcept {
+  if (bytes > Pool::kMaxBytes)
+    return nullptr;
+  auto a = poolArena();
+  if (not a->base)
+    return nullptr;
+  size_t cls = bytes ? (bytes - 1) / Pool::kGranule : 0;
+  auto &cache = poolCache;
+  if (auto block = cache.free[cls]) {
+    cache.free[cls] = block->next;
+    return block;
+  }
+  if (cache.next[cls] != cache.end[cls]) {
+    auto block = cache.next[cls];
+    cache.next[cls] += blockSize(cls);
+    return block;
+  }
+  return cache.Refill(*a, cls);
+}
+
+void poolFree(Arena &a, void *ptr) noexcept {
+  auto cls = a.ClassOf(ptr);
+  auto block = static_cast<FreeBlock *>(ptr);
+  auto &cache = poolCache;
+  block->next = cache.free[cls];
+  cache.free[cls] = block;
+}
+
+Arena *owningArena(const void *ptr) noexcept {
+  auto a = arena.load(std::memory_order_acquire);
+  return a and a->Owns(ptr) ? a : nullptr;
+}
+
+size_t glibcSize(void *ptr) { return malloc_usable_size(ptr); }
+
+} // anonymous namespace
+
+std::ostream &operator<<(std::ostream &os, Allocator allocator) {
+  const char *ptr;
+  switch (allocator) {
+  case Allocator::Glibc:
+    ptr = "glibc";
+    break;
+  case Allocator::TbbMalloc:
+    ptr = "tbbmalloc";
+    break;
+  case Allocator::Pool:
+    ptr = "pool";
+    break;
+  default:
+    ptr = "unknown";
+    break;
+  }
+  return os << ptr;
+}
+
+/**
+ * @param s The string to parse, glibc, tbbmalloc or pool.
+ * @param allocator Set to the allocator parsed.
+ * @return True if s is a valid allocator, false otherwise.
+ */
+bool parseAllocator(const std::string &s, Allocator &allocator) {
+  auto name = toLower(s);
+  if (name == "glibc")
+    allocator = Allocator::Glibc;
+  else if (name == "tbbmalloc")
+    allocator = Allocator::TbbMalloc;
+  else if (name == "pool")
+    allocator = Allocator::Pool;
+  else
+    return false;
+  return true;
+}
+
+/**
+ * Chooses the allocator of the allocations from now on. Memory from the one
+ * before can still be freed.
+ * @param allocator The allocator.
+ */
+void setAllocator(Allocator allocator) noexcept {
+  if (allocator == Allocator::TbbMalloc)
+    tbbUsed.store(true);
+  chosen.store(allocator);
+}
+
+/**
+ * @return The allocator chosen.
+ */
+Allocator currentAllocator() noexcept {
+  return chosen.load(std::memory_order_relaxed);
+}
+
+/**
+ * @param bytes The size of the allocation.
+ * @return Memory from the allocator chosen, aligned for any type, or nullptr
+ *  if there is none left.
+ */
+void *allocate(size_t bytes) noexcept {
+  switch (currentAllocator()) {
+  case Allocator::TbbMalloc:
+    return scalable_malloc(bytes ? bytes : 1);
+  case Allocator::Pool:
+    if (auto ptr = poolAllocate(bytes))
+      return ptr;
+    break;
+  default:
+    break;
+  }
+  return std::malloc(bytes ? bytes : 1);
+}
+
+/**
+ * @param bytes The size of the allocation.
+ * @param alignment A power of two, at least sizeof(void *).
+ * @return Memory from the allocator chosen, aligned to alignment, or nullptr
+ *  if there is none left.
+ */
+void *allocateAligned(size_t bytes, size_t alignment) noexcept {
+  switch (currentAllocator()) {
+  case Allocator::TbbMalloc:
+    return scalable_aligned_malloc(bytes ? bytes : 1, alignment);
+  case Allocator::Pool:
+    // A class that is a multiple of the alignment has its blocks aligned, as
+    // spans start on pages.
+    if (alignment <= 4096) {
+      auto rounded = (bytes + alignment - 1) / alignment * alignment;
+      if (auto ptr = poolAllocate(rounded))
+        return ptr;
+    }
+    break;
+  default:
+    break;
+  }
+  void *ptr = nullptr;
+  return posix_memalign(&ptr, alignment, bytes ? bytes : 1) ? nullptr : ptr;
+}
+
+/**
+ * Frees memory from any of the allocators.
+ * @param ptr The memory, or nullptr.
+ */
+void deallocate(void *ptr) noexcept {
+  if (not ptr)
+    return;
+  if (auto a = owningArena(ptr))
+    poolFree(*a, ptr);
+  else if (tbbUsed.load(std::memory_order_relaxed))
+    __TBB_malloc_safer_free(ptr, std::free);
+  else
+    std::free(ptr);
+}
+
+/**
+ * @param ptr Memory from any of the allocators, or nullptr.
+ * @return The bytes it has, at least the ones asked for.
+ */
+size_t allocationSize(const void *ptr) noexcept {
+  if (not ptr)
+    return 0;
+  auto p = const_cast<void *>(ptr);
+  if (auto a = owningArena(ptr))
+    return blockSize(a->ClassOf(ptr));
+  if (tbbUsed.load(std::memory_order_relaxed))
+    return __TBB_malloc_safer_msize(p, glibcSize);
+  return malloc_usable_size(p);
+}
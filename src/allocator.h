@@ -0,0 +1,45 @@
+/**
+ * @file allocator.h
+ *
+ * The allocator behind operator new and BucketArray, chosen for the whole
+ * process so that every structure of a run gets its memory the same way.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+/**
+ * Where the memory of the structures comes from:
+ * - Glibc: malloc, as without any other allocator
+ * - TbbMalloc: TBB's scalable_malloc, with its per-thread heaps
+ * - Pool: a pool in this process of fixed-size blocks in 16 byte size
+ *   classes, which threads keep on free lists of their own, for blocks of up
+ *   to Pool::kMaxBytes; bigger ones come from malloc
+ */
+enum class Allocator { Glibc, TbbMalloc, Pool };
+
+std::ostream &operator<<(std::ostream &os, Allocator allocator);
+
+bool parseAllocator(const std::string &s, Allocator &allocator);
+
+void setAllocator(Allocator allocator) noexcept;
+Allocator currentAllocator() noexcept;
+
+void *allocate(size_t bytes) noexcept;
+void *allocateAligned(size_t bytes, size_t alignment) noexcept;
+void deallocate(void *ptr) noexcept;
+size_t allocationSize(const void *ptr) noexcept;
+
+/**
+ * The sizes of the in-tree pool.
+ */
+struct Pool {
+  static constexpr size_t kGranule = 16;
+  static constexpr size_t kMaxBytes = 512;
+  static constexpr size_t kClasses = kMaxBytes / kGranule;
+  static constexpr size_t kSpanBytes = size_t(1) << 18;
+  static constexpr size_t kArenaBytes = size_t(1) << 34;
+};
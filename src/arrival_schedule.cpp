@@ -0,0 +1,67 @@
+/**
+ * @file arrival_schedule.cpp
+ *
+ * Definitions for ArrivalSchedule.
+ */
+
+#include <thread>
+
+#include "arrival_schedule.h"
+#include "latency_histogram.h"
+#include "util.h"
+
+constexpr double ArrivalSchedule::kSpinNs;
+
+std::ostream &operator<<(std::ostream &os, Arrivals arrivals) {
+  return os << (arrivals == Arrivals::Constant ? "constant" : "poisson");
+}
+
+/**
+ * @param s The string to parse, constant or poisson.
+ * @param arrivals Set to the arrivals parsed.
+ * @return True if s is a valid kind of arrivals, false otherwise.
+ */
+bool parseArrivals(const std::string &s, Arrivals &arrivals) {
+  auto name = toLower(s);
+  if (name == "constant")
+    arrivals = Arrivals::Constant;
+  else if (name == "poisson")
+    arrivals = Arrivals::Poisson;
+  else
+    return false;
+  return true;
+}
+
+/**
+ * Starts the schedule at the current time, with the first operation due now.
+ * @param rate The operations per second of the worker, 0 for closed loop.
+ * @param arrivals How the gaps between operations are drawn.
+ * @param seed The seed of the gaps.
+ */
+void ArrivalSchedule::Start(double rate, Arrivals arrivals, uint64_t seed) {
+  meanGap = rate > 0.0 ? 1e9 / rate / CycleClock::NsPerTick() : 0.0;
+  spinTicks = kSpinNs / CycleClock::NsPerTick();
+  this->arrivals = arrivals;
+  engine.seed(seed);
+  exponential = std::exponential_distribution<double>(1.0);
+  start = CycleClock::Now();
+  next = 0.0;
+}
+
+/**
+ * Waits until the next operation is due, and schedules the one after it.
+ * Operations that are already late are due at once, and their lateness is
+ * kept rather than made up by skipping ahead.
+ * @return When the operation was due.
+ */
+uint64_t ArrivalSchedule::Wait() {
+  auto due = start + static_cast<uint64_t>(next);
+  // Short waits spin, so the operation starts on time, and long ones yield to
+  // the other threads on the core.
+  for (uint64_t now; (now = CycleClock::Now()) < due;)
+    if (due - now > spinTicks)
+      std::this_thread::yield();
+  next += arrivals == Arrivals::Poisson ? meanGap * exponential(engine)
+                                        : meanGap;
+  return due;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file arrival_schedule.h
+ *
+ * When the operations of an open-loop run are due.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+
+/**
+ * How the gaps between the operations of an open-loop run are drawn:
+ * - Constant: all the same
+ * - Poisson: from an exponential distribution, so the operations arrive as a
+ *   Poisson process, like independent requests do
+ */
+enum class Arrivals { Constant, Poisson };
+
+std::ostream &operator<<(std::ostream &os, Arrivals arrivals);
+
+bool parseArrivals(const std::string &s, Arrivals &arrivals);
+
+/**
+ * The send times of the operations of one worker in an open-loop run, in
+ * CycleClock ticks. The worker waits for each operation's send time before
+ * running it, and its latency is measured from that time rather than from
+ * when the worker got around to it, so the time an operation spends queued
+ * behind slow ones is counted instead of omitted. A schedule with no rate
+ * leaves the worker closed-loop.
+ */
+struct ArrivalSchedule {
+  static constexpr double kSpinNs = 20000.0;
+
+  double meanGap{0.0};
+  uint64_t spinTicks{0};
+  Arrivals arrivals{Arrivals::Poisson};
+  std::default_random_engine engine;
+  std::exponential_distribution<double> exponential;
+  // The send time of the next operation is start + next. Only the offset is a
+  // double, since the counter itself is too large for a double to keep
+  // whole ticks of it, and the rounding would add up over the run.
+  uint64_t start{0};
+  double next{0.0};
+
+  void Start(double rate, Arrivals arrivals, uint64_t seed);
+
+  bool IsOpen() const noexcept { return meanGap > 0.0; }
+
+  uint64_t Wait();
+};
@@ -0,0 +1,309 @@
+/**
+ * @file baseline.cpp
+ *
+ * Definitions for Baseline and the comparison of runs.
+ */
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "allocator.h"
+#include "arrival_schedule.h"
+#include "baseline.h"
+#include "key_distribution.h"
+#include "statistics.h"
+#include "topology.h"
+
+namespace {
+
+/**
+ * Just enough of a JSON reader for the files --stats json writes: objects,
+ * arrays, strings without escapes other than quotes and backslashes, numbers
+ * and literals. Every method returns false on malformed input.
+ */
+struct JsonReader {
+  const std::string &text;
+  size_t pos{0};
+
+  explicit JsonReader(const std::string &text) : text(text) {}
+
+  void SkipSpace() noexcept {
+    while (pos < text.size() and std::isspace(text[pos]))
+      ++pos;
+  }
+
+  bool Peek(char c) noexcept {
+    SkipSpace();
+    return pos < text.size() and text[pos] == c;
+  }
+
+  bool Expect(char c) noexcept {
+    if (not Peek(c))
+      return false;
+    ++pos;
+    return true;
+  }
+
+  bool String(std::string &s) {
+    if (not Expect('"'))
+      return false;
+    s.clear();
+    while (pos < text.size() and text[pos] != '"') {
+      if (text[pos] == '\\' and pos + 1 < text.size())
+        ++pos;
+      s += text[pos++];
+    }
+    return Expect('"');
+  }
+
+  bool Number(double &d) {
+    SkipSpace();
+    const char *start = text.c_str() + pos;
+    char *end;
+    d = std::strtod(start, &end);
+    if (end == start)
+      return false;
+    pos += end - start;
+    return true;
+  }
+
+  bool Bool(bool &b) {
+    SkipSpace();
+    for (auto literal : {"true", "false"}) {
+      if (text.compare(pos, std::strlen(literal), literal) == 0) {
+        pos += std::strlen(literal);
+        b = literal[0] == 't';
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Reads the members of an object, calling member(key) with the reader at
+   * the start of each value, which it must read.
+   */
+  template <typename F> bool Object(F member) {
+    if (not Expect('{'))
+      return false;
+    if (Expect('}'))
+      return true;
+    do {
+      std::string key;
+      if (not String(key) or not Expect(':') or not member(key))
+        return false;
+    } while (Expect(','));
+    return Expect('}');
+  }
+
+  /**
+   * Reads the elements of an array, calling element() with the reader at the
+   * start of each, which it must read.
+   */
+  template <typename F> bool Array(F element) {
+    if (not Expect('['))
+      return false;
+    if (Expect(']'))
+      return true;
+    do {
+      if (not element())
+        return false;
+    } while (Expect(','));
+    return Expect(']');
+  }
+
+  bool Skip() {
+    std::string s;
+    double d;
+    bool b;
+    if (Peek('{'))
+      return Object([&](const std::string &) { return Skip(); });
+    if (Peek('['))
+      return Array([&] { return Skip(); });
+    if (Peek('"'))
+      return String(s);
+    if (text.compare(pos, 4, "null") == 0) {
+      pos += 4;
+      return true;
+    }
+    return Bool(b) or Number(d);
+  }
+};
+
+/**
+ * Reads the configuration of a baseline into params.
+ * @return False if it is malformed.
+ */
+bool readConfig(JsonReader &reader, RunnerParams &params) {
+  return reader.Object([&](const std::string &key) {
+    std::string s;
+    double d;
+    if (reader.Peek('"')) {
+      if (not reader.String(s))
+        return false;
+      if (key == "scaling")
+        params.scalingMode =
+            s == "memory" ? ScalingMode::Memory : ScalingMode::Problem;
+      else if (key == "distribution")
+        return parseDistribution(s, params.distribution);
+      else if (key == "structs")
+        params.structs = s;
+      else if (key == "types")
+        params.types = s;
+      else if (key == "placement")
+        return parsePlacement(s, params.placement);
+      else if (key == "arrivals")
+        return parseArrivals(s, params.arrivals);
+      else if (key == "allocator")
+        return parseAllocator(s, params.allocator);
+      return true;
+    }
+    if (key == "affinity")
+      return reader.Bool(params.withAffinity);
+    if (not reader.Number(d))
+      return reader.Skip();
+    if (key == "n")
+      params.n = d;
+    else if (key == "inserts")
+      params.inserts = d;
+    else if (key == "removals")
+      params.removals = d;
+    else if (key == "lookups")
+      params.lookups = d;
+    else if (key == "preload")
+      params.preload = d;
+    else if (key == "loadFactor")
+      params.mapLoadFactor = d;
+    else if (key == "repeat")
+      params.repeat = d;
+    else if (key == "minThreads")
+      params.minThreads = d;
+    else if (key == "maxThreads")
+      params.maxThreads = d;
+    else if (key == "duration")
+      params.duration = d;
+    else if (key == "rate")
+      params.rate = d;
+    return true;
+  });
+}
+
+/**
+ * Reads the cells of a baseline.
+ * @return False if they are malformed.
+ */
+bool readCells(JsonReader &reader, std::vector<BaselineCell> &cells) {
+  return reader.Array([&] {
+    BaselineCell cell;
+    bool ok = reader.Object([&](const std::string &key) {
+      double d;
+      if (key == "list")
+        return reader.String(cell.list);
+      if (key == "threads") {
+        if (not reader.Number(d))
+          return false;
+        cell.threads = d;
+        return true;
+      }
+      if (key == "runtimes")
+        return reader.Array([&] {
+          if (not reader.Number(d))
+            return false;
+          cell.runTimes.push_back(d);
+          return true;
+        });
+      return reader.Skip();
+    });
+    cells.push_back(std::move(cell));
+    return ok;
+  });
+}
+
+} // anonymous namespace
+
+/**
+ * Reads a file written by --stats json.
+ * @param path The path of the file.
+ * @param error Set to what went wrong, if anything did.
+ * @return False if the file could not be read or is malformed.
+ */
+bool Baseline::Load(const std::string &path, std::string &error) {
+  error.clear();
+  std::ifstream in(path);
+  if (not in) {
+    error = path + ": " + std::strerror(errno);
+    return false;
+  }
+  std::ostringstream oss;
+  oss << in.rdbuf();
+  auto text = oss.str();
+  JsonReader reader(text);
+  bool ok = reader.Object([&](const std::string &key) {
+    if (key == "config")
+      return readConfig(reader, params);
+    if (key == "results")
+      return readCells(reader, cells);
+    return reader.Skip();
+  });
+  if (not ok)
+    error = path + ": not a statistics file, at offset " +
+            std::to_string(reader.pos);
+  else if (cells.empty())
+    error = path + ": no results";
+  return error.empty();
+}
+
+/**
+ * @return The cell of a list or map at a thread count, or nullptr if there is
+ *  none.
+ */
+const BaselineCell *Baseline::Find(const std::string &list,
+                                   unsigned threads) const noexcept {
+  for (auto &cell : cells)
+    if (cell.list == list and cell.threads == threads)
+      return &cell;
+  return nullptr;
+}
+
+/**
+ * Compares every cell of a run to the baseline with the Mann-Whitney U test on
+ * the runtimes of their repeats.
+ * @param baseline The baseline.
+ * @param results The results of the run.
+ * @param threshold How much slower, as a fraction, a cell has to be to regress.
+ * @param alpha The significance level.
+ * @return A comparison per cell of the run, in order.
+ */
+std::vector<CellComparison>
+compareToBaseline(const Baseline &baseline,
+                  const std::vector<RunnerResults> &results, double threshold,
+                  double alpha) {
+  std::vector<CellComparison> comparisons;
+  for (auto &r : results) {
+    auto threads = r.params.minThreads;
+    for (auto &repeats : r.repeats) {
+      CellComparison c;
+      c.list = r.name;
+      c.threads = threads++;
+      std::vector<double> runTimes;
+      for (auto &sample : repeats)
+        runTimes.push_back(sample.runTime);
+      c.median = summarize(runTimes).median;
+      if (auto cell = baseline.Find(c.list, c.threads)) {
+        c.hasBaseline = true;
+        c.baselineMedian = summarize(cell->runTimes).median;
+        c.speedup = c.median > 0.0 ? c.baselineMedian / c.median : 0.0;
+        c.p = mannWhitneyP(cell->runTimes, runTimes);
+        c.significant = c.p < alpha;
+        c.regressed =
+            c.significant and c.median > c.baselineMedian * (1.0 + threshold);
+      }
+      comparisons.push_back(std::move(c));
+    }
+  }
+  return comparisons;
+}
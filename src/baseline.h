@@ -0,0 +1,57 @@
+/**
+ * @file baseline.h
+ *
+ * Loading the statistics of a previous run and comparing a new run to them.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "benchmark_runner.h"
+
+/**
+ * The runtimes of the repeats of one list or map at one thread count.
+ */
+struct BaselineCell {
+  std::string list;
+  unsigned threads{0};
+  std::vector<double> runTimes;
+};
+
+/**
+ * A previous run, as written by --stats json: the configuration it ran with
+ * and the runtimes of every cell.
+ */
+struct Baseline {
+  RunnerParams params;
+  std::vector<BaselineCell> cells;
+
+  bool Load(const std::string &path, std::string &error);
+  const BaselineCell *Find(const std::string &list,
+                           unsigned threads) const noexcept;
+};
+
+/**
+ * How a cell of a new run compares to the same cell of the baseline. The
+ * speedup is the baseline median runtime over the new one, so below 1 is
+ * slower. A cell regresses if it is significantly slower by more than the
+ * threshold.
+ */
+struct CellComparison {
+  std::string list;
+  unsigned threads{0};
+  bool hasBaseline{false};
+  double baselineMedian{0.0};
+  double median{0.0};
+  double speedup{0.0};
+  double p{1.0};
+  bool significant{false};
+  bool regressed{false};
+};
+
+std::vector<CellComparison>
+compareToBaseline(const Baseline &baseline,
+                  const std::vector<RunnerResults> &results, double threshold,
+                  double alpha = 0.05);
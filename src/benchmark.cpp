@@ -11,27 +11,40 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
-#include <iterator>
+#include <utility>
 #include <set>
+#include <sstream>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
+#include "allocator.h"
+#include "baseline.h"
 #include "benchmark_runner.h"
 #include "coarse_grain_list.h"
 #include "dllist.h"
+#include "elimination_list.h"
 #include "fine_grain_list.h"
 #include "hashmap.h"
+#include "key_distribution.h"
+#include "latency_histogram.h"
 #include "libcuckoo_hashmap.h"
+#include "lockfree_dllist.h"
 #include "lockfree_list.h"
 #include "nonblocking_list.h"
+#include "statistics.h"
+#include "tagged_lockfree_list.h"
 #include "tbb_hashmap.h"
+#include "trace.h"
 #include "util.h"
+#include "ycsb.h"
 
 namespace {
 // Aliases
@@ -41,16 +54,124 @@ using CoarseGrainListMap = HashMap<T, K, CoarseGrainList>;
 template <typename T, typename K>
 using FineGrainListMap = HashMap<T, K, FineGrainList>;
 template <typename T, typename K>
+using CompactFineGrainListMap = HashMap<T, K, CompactFineGrainList>;
+template <typename T, typename K>
 using NonBlockingListMap = HashMap<T, K, NonBlockingList>;
 template <typename T, typename K>
 using LockFreeListMap = HashMap<T, K, LockFreeList>;
+template <typename T, typename K>
+using EliminationListMap = HashMap<T, K, EliminationList>;
+template <typename T, typename K>
+using LockFreeDlListMap = HashMap<T, K, LockFreeDlList>;
+template <typename T, typename K>
+using TaggedLockFreeListMap = HashMap<T, K, TaggedLockFreeList>;
 
 void usage(const char *name);
 void usageErr(const char *name);
-void checkArgs(const RunnerParams &params);
+void checkArgs(const RunnerParams &params, bool checkMix);
 void printResults(const std::vector<RunnerResults> &results,
-                  const RunnerParams &params, bool pretty);
+                  const RunnerParams &params, bool pretty,
+                  const std::string &statsFormat);
+void printLatencies(const RunnerResults &results, bool pretty);
+void printPerfCounts(const RunnerResults &results, bool pretty);
+void printPlacement(const RunnerResults &results, bool pretty);
+void printMemory(const RunnerResults &results, bool pretty);
+void printLocks(const RunnerResults &results, bool pretty);
+void printListStats(const RunnerResults &results, bool pretty);
+void printStats(const std::vector<RunnerResults> &results,
+                const RunnerParams &params, const std::string &format,
+                std::FILE *out);
+bool printComparison(const std::vector<CellComparison> &comparisons,
+                     double threshold);
+void printTimeSeries(const std::vector<RunnerResults> &results,
+                     const RunnerParams &params, std::FILE *out);
 std::set<std::string> getTypeNames(const std::string &names, const char *prog);
+template <template <typename, typename> class TMap>
+void runFalseSharing(BenchmarkRunner &runner, const std::string &mapName,
+                     std::vector<RunnerResults> &results);
+std::vector<const YcsbWorkload *> getYcsbWorkloads(const std::string &names,
+                                                   const char *prog);
+template <typename TRun>
+void forEachList(const std::set<std::string> &typeNames, TRun run);
+template <typename TRun>
+void forEachMap(const std::set<std::string> &typeNames, TRun run);
+
+// What forEachList() and forEachMap() run on each type. The single threaded
+// types are passed std::true_type and the others std::false_type.
+
+/**
+ * The regular runs, with the single threaded types on their own runners.
+ */
+struct RegularRun {
+  BenchmarkRunner &runner;
+  std::vector<RunnerResults> &results;
+
+  template <template <typename...> class TList>
+  void List(const std::string &name, std::true_type) {
+    results.push_back(runner.RunListSingle<TList>(name));
+  }
+  template <template <typename...> class TList>
+  void List(const std::string &name, std::false_type) {
+    results.push_back(runner.RunList<TList>(name));
+  }
+  template <template <typename, typename> class TMap>
+  void Map(const std::string &name, std::true_type) {
+    results.push_back(runner.RunMapSingle<TMap>(name));
+  }
+  template <template <typename, typename> class TMap>
+  void Map(const std::string &name, std::false_type) {
+    results.push_back(runner.RunMap<TMap>(name));
+  }
+};
+
+/**
+ * A YCSB workload on the maps.
+ */
+struct YcsbRun {
+  BenchmarkRunner &runner;
+  std::vector<RunnerResults> &results;
+  const YcsbWorkload &workload;
+
+  template <template <typename, typename> class TMap, typename TSingle>
+  void Map(const std::string &name, TSingle) {
+    results.push_back(runner.RunYcsb<TMap>(name, workload, TSingle::value));
+  }
+};
+
+/**
+ * A replay of a trace.
+ */
+struct ReplayRun {
+  BenchmarkRunner &runner;
+  std::vector<RunnerResults> &results;
+  const TraceFile &trace;
+
+  template <template <typename...> class TList, typename TSingle>
+  void List(const std::string &name, TSingle) {
+    results.push_back(runner.RunListReplay<TList>(name, trace, TSingle::value));
+  }
+  template <template <typename, typename> class TMap, typename TSingle>
+  void Map(const std::string &name, TSingle) {
+    results.push_back(runner.RunMapReplay<TMap>(name, trace, TSingle::value));
+  }
+};
+
+/**
+ * A timed build from empty.
+ */
+struct BuildRun {
+  BenchmarkRunner &runner;
+  std::vector<RunnerResults> &results;
+
+  template <template <typename...> class TList, typename TSingle>
+  void List(const std::string &name, TSingle) {
+    results.push_back(runner.RunListBuild<TList>(name, TSingle::value));
+  }
+  template <template <typename, typename> class TMap, typename TSingle>
+  void Map(const std::string &name, TSingle) {
+    results.push_back(runner.RunMapBuild<TMap>(name, TSingle::value));
+  }
+};
 } // anonymous namespace
 
 int main(int argc, char *argv[]) {
@@ -72,12 +193,34 @@ int main(int argc, char *argv[]) {
       {"outdir", required_argument, nullptr, 'o'},
       {"datastruct", required_argument, nullptr, 'd'},
       {"repeat", required_argument, nullptr, 1002},
+      {"false-sharing", no_argument, nullptr, 1003},
+      {"no-latencies", no_argument, nullptr, 1004},
+      {"duration", required_argument, nullptr, 1005},
+      {"sample-interval", required_argument, nullptr, 1006},
+      {"distribution", required_argument, nullptr, 1007},
+      {"ycsb", required_argument, nullptr, 1008},
+      {"no-perf-counters", no_argument, nullptr, 1009},
+      {"replay", required_argument, nullptr, 1010},
+      {"stats", required_argument, nullptr, 1011},
+      {"baseline", required_argument, nullptr, 1012},
+      {"regression-threshold", required_argument, nullptr, 1013},
+      {"placement", required_argument, nullptr, 1014},
+      {"rate", required_argument, nullptr, 1015},
+      {"arrivals", required_argument, nullptr, 1016},
+      {"allocator", required_argument, nullptr, 1017},
+      {"build", no_argument, nullptr, 1018},
       {0, 0, 0, 0}};
   bool isPrettyFormat = false;
   bool isMapOnly = false;
+  bool isFalseSharing = false;
+  bool isBuild = false;
+  std::vector<const YcsbWorkload *> ycsbWorkloads;
+  std::string replayPath;
+  std::string statsFormat;
+  std::string baselinePath;
+  double regressionThreshold = 0.05;
   bool runList = false;
   bool runMap = false;
-  std::string types;
   RunnerParams params;
   int opt;
   while ((opt = getopt_long(argc, argv, "hn:i:r:l:s:ap:m:x:u:o:d:", longOptions,
@@ -152,8 +295,8 @@ int main(int argc, char *argv[]) {
       }
       break;
     case 1000:
-      types = optarg;
-      if (types.empty())
+      params.types = optarg;
+      if (params.types.empty())
         usageErr(argv[0]);
       break;
     case 1001:
@@ -164,14 +307,147 @@ int main(int argc, char *argv[]) {
       if (params.repeat < 1)
         usageErr(argv[0]);
       break;
+    case 1003:
+      isFalseSharing = true;
+      break;
+    case 1004:
+      params.latencies = false;
+      break;
+    case 1005:
+      params.duration = std::stod(optarg);
+      if (params.duration <= 0.0)
+        usageErr(argv[0]);
+      break;
+    case 1006:
+      params.sampleInterval = std::stoul(optarg);
+      if (params.sampleInterval < 1)
+        usageErr(argv[0]);
+      break;
+    case 1007:
+      if (not parseDistribution(optarg, params.distribution))
+        usageErr(argv[0]);
+      break;
+    case 1008:
+      ycsbWorkloads = getYcsbWorkloads(optarg, argv[0]);
+      break;
+    case 1009:
+      params.perfCounters = false;
+      break;
+    case 1010:
+      replayPath = optarg;
+      break;
+    case 1011:
+      statsFormat = optarg;
+      if (statsFormat != "json" and statsFormat != "csv")
+        usageErr(argv[0]);
+      break;
+    case 1012:
+      baselinePath = optarg;
+      break;
+    case 1013:
+      regressionThreshold = std::atof(optarg);
+      if (regressionThreshold < 0.0)
+        usageErr(argv[0]);
+      break;
+    case 1014:
+      if (not parsePlacement(optarg, params.placement))
+        usageErr(argv[0]);
+      params.withAffinity = params.placement != Placement::None;
+      break;
+    case 1015:
+      params.rate = std::atof(optarg);
+      if (params.rate <= 0.0)
+        usageErr(argv[0]);
+      break;
+    case 1016:
+      if (not parseArrivals(optarg, params.arrivals))
+        usageErr(argv[0]);
+      break;
+    case 1017:
+      if (not parseAllocator(optarg, params.allocator))
+        usageErr(argv[0]);
+      break;
+    case 1018:
+      isBuild = true;
+      break;
     case '?':
     default:
       usageErr(argv[0]);
     }
   }
 
-  auto typeNames = getTypeNames(types, argv[0]);
-  checkArgs(params);
+  Baseline baseline;
+  if (not baselinePath.empty()) {
+    std::string error;
+    if (not baseline.Load(baselinePath, error)) {
+      std::fprintf(stderr, "ERROR: unable to read baseline %s\n",
+                   error.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+    // Rerun with the configuration of the baseline.
+    auto &bp = baseline.params;
+    params.n = bp.n;
+    params.inserts = bp.inserts;
+    params.removals = bp.removals;
+    params.lookups = bp.lookups;
+    params.preload = bp.preload;
+    params.mapLoadFactor = bp.mapLoadFactor;
+    params.scalingMode = bp.scalingMode;
+    params.distribution = bp.distribution;
+    params.repeat = bp.repeat;
+    params.minThreads = bp.minThreads;
+    params.maxThreads = bp.maxThreads;
+    params.duration = bp.duration;
+    params.placement = bp.placement;
+    params.withAffinity = bp.withAffinity;
+    params.rate = bp.rate;
+    params.arrivals = bp.arrivals;
+    params.allocator = bp.allocator;
+    // And the same kind of run on the same types, except that the trace of a
+    // replay has to be given again.
+    params.structs = bp.structs;
+    params.types = bp.types;
+    runList = bp.structs == "list" or bp.structs == "both";
+    runMap = bp.structs == "map" or bp.structs == "both";
+    isFalseSharing = bp.structs == "falsesharing";
+    isBuild = bp.structs == "build";
+    ycsbWorkloads.clear();
+    if (bp.structs.compare(0, 5, "ycsb-") == 0) {
+      for (auto name : bp.structs.substr(5))
+        if (auto workload = findYcsbWorkload(name))
+          ycsbWorkloads.push_back(workload);
+    }
+    if (bp.structs != "replay") {
+      replayPath.clear();
+    } else if (replayPath.empty()) {
+      std::fprintf(stderr, "ERROR: baseline %s replays a trace, which has to "
+                           "be given with --replay\n",
+                   baselinePath.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  // The kind of run, which the last of these to run decides.
+  if (isFalseSharing)
+    params.structs = "falsesharing";
+  if (not ycsbWorkloads.empty()) {
+    params.structs = "ycsb-";
+    for (auto workload : ycsbWorkloads)
+      params.structs += workload->name;
+  }
+  if (not replayPath.empty())
+    params.structs = "replay";
+  if (isBuild)
+    params.structs = "build";
+  if (not baselinePath.empty() and params.structs != baseline.params.structs) {
+    std::fprintf(stderr, "ERROR: baseline %s ran \"%s\", not \"%s\"\n",
+                 baselinePath.c_str(), baseline.params.structs.c_str(),
+                 params.structs.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+
+  auto typeNames = getTypeNames(params.types, argv[0]);
+  checkArgs(params, ycsbWorkloads.empty() and replayPath.empty());
   std::vector<RunnerResults> results;
   BenchmarkRunner runner(params);
 
@@ -180,45 +456,76 @@ int main(int argc, char *argv[]) {
     runMap = 1;
   }
 
-  // Lists
-  if (runList) {
+  if (isFalseSharing) {
+    // Only the maps built on HashMap have buckets to pad, and the single
+    // threaded one has nothing to share.
+    runList = runMap = false;
     for (auto &name : typeNames) {
-      if (name == "single")
-        results.push_back(runner.RunListSingle<DlList>("DlList"));
-      else if (name == "coarsegrain")
-        results.push_back(runner.RunList<CoarseGrainList>("CoarseGrainList"));
+      if (name == "coarsegrain")
+        runFalseSharing<CoarseGrainListMap>(runner, "CoarseGrainListMap",
+                                            results);
       else if (name == "finegrain")
-        results.push_back(runner.RunList<FineGrainList>("FineGrainList"));
+        runFalseSharing<FineGrainListMap>(runner, "FineGrainListMap", results);
+      else if (name == "compact")
+        runFalseSharing<CompactFineGrainListMap>(
+            runner, "CompactFineGrainListMap", results);
       else if (name == "spinning")
-        results.push_back(runner.RunList<NonBlockingList>("NonBlockingList"));
+        runFalseSharing<NonBlockingListMap>(runner, "NonBlockingListMap",
+                                            results);
       else if (name == "lockfree")
-        results.push_back(runner.RunList<LockFreeList>("LockFreeList"));
+        runFalseSharing<LockFreeListMap>(runner, "LockFreeListMap", results);
+      else if (name == "elimination")
+        runFalseSharing<EliminationListMap>(runner, "EliminationListMap",
+                                            results);
+      else if (name == "lockfreedl")
+        runFalseSharing<LockFreeDlListMap>(runner, "LockFreeDlListMap",
+                                           results);
+      else if (name == "tagged")
+        runFalseSharing<TaggedLockFreeListMap>(runner, "TaggedLockFreeListMap",
+                                               results);
     }
   }
 
-  if (runMap) {
-    // Maps
-    for (auto &name : typeNames) {
-      if (name == "single")
-        results.push_back(runner.RunMapSingle<DlListMap>("DlListMap"));
-      else if (name == "coarsegrain")
-        results.push_back(
-            runner.RunMap<CoarseGrainListMap>("CoarseGrainListMap"));
-      else if (name == "finegrain")
-        results.push_back(runner.RunMap<FineGrainListMap>("FineGrainListMap"));
-      else if (name == "spinning")
-        results.push_back(
-            runner.RunMap<NonBlockingListMap>("NonBlockingListMap"));
-      else if (name == "lockfree")
-        results.push_back(runner.RunMap<LockFreeListMap>("LockFreeListMap"));
-      else if (name == "cuckoo")
-        results.push_back(runner.RunMap<LibCuckooHashMap>("LibCuckooHashMap"));
-      else if (name == "tbb")
-        results.push_back(runner.RunMap<TbbHashMap>("TbbHashMap"));
+  if (not ycsbWorkloads.empty()) {
+    runList = runMap = false;
+    for (auto workload : ycsbWorkloads)
+      forEachMap(typeNames, YcsbRun{runner, results, *workload});
+  }
+
+  if (not replayPath.empty()) {
+    TraceFile trace;
+    std::string error;
+    if (not trace.Open(replayPath, error)) {
+      std::fprintf(stderr, "ERROR: unable to replay %s\n", error.c_str());
+      std::exit(EXIT_FAILURE);
     }
+    if (runList)
+      forEachList(typeNames, ReplayRun{runner, results, trace});
+    if (runMap)
+      forEachMap(typeNames, ReplayRun{runner, results, trace});
+    runList = runMap = false;
   }
 
-  printResults(results, params, isPrettyFormat);
+  if (isBuild) {
+    if (runList)
+      forEachList(typeNames, BuildRun{runner, results});
+    if (runMap)
+      forEachMap(typeNames, BuildRun{runner, results});
+    runList = runMap = false;
+  }
+
+  if (runList)
+    forEachList(typeNames, RegularRun{runner, results});
+  if (runMap)
+    forEachMap(typeNames, RegularRun{runner, results});
+
+  printResults(results, params, isPrettyFormat, statsFormat);
+  if (not baselinePath.empty()) {
+    auto comparisons =
+        compareToBaseline(baseline, results, regressionThreshold);
+    if (printComparison(comparisons, regressionThreshold))
+      std::exit(EXIT_FAILURE);
+  }
   std::exit(EXIT_SUCCESS);
 }
 
@@ -282,12 +589,122 @@ void usage(const char *name) {
   std::printf("\t\t- single (runs DlList and DlListHashMap)\n");
   std::printf("\t\t- coarsegrain\n");
   std::printf("\t\t- finegrain\n");
+  std::printf("\t\t- compact (finegrain with four byte locks)\n");
   std::printf("\t\t- spinning\n");
   std::printf("\t\t- lockfree\n");
+  std::printf("\t\t- elimination\n");
+  std::printf("\t\t- lockfreedl\n");
+  std::printf("\t\t- tagged\n");
   std::printf("\t\t- cuckoo\n");
   std::printf("\t\t- tbb\n");
   std::printf("\t--map-only\n");
   std::printf("\t\tOnly runs hash map tests.\n");
+  std::printf("\t--false-sharing\n");
+  std::printf("\t\tInstead of the regular runs, has each thread hammer a\n");
+  std::printf("\t\tbucket of its own in a map with one bucket per thread,\n");
+  std::printf("\t\twith packed and with padded buckets. Only applies to\n");
+  std::printf("\t\tthe types built on HashMap.\n");
+  std::printf("\t--no-latencies\n");
+  std::printf("\t\tDoes not time individual operations. By default the\n");
+  std::printf("\t\tp50, p99, p99.9 and max latencies of inserts, removals\n");
+  std::printf("\t\tand lookups are reported along with the runtimes, in\n");
+  std::printf("\t\tnanoseconds.\n");
+  std::printf("\t--duration <SECONDS>\n");
+  std::printf("\t\tRuns each thread count for a fixed time instead of a\n");
+  std::printf("\t\tfixed number of operations, inserting removed numbers\n");
+  std::printf("\t\tagain once the new ones run out. The throughput is\n");
+  std::printf("\t\tsampled along the way and written as a time series,\n");
+  std::printf("\t\tto a _timeseries file next to the results with -o.\n");
+  std::printf("\t--sample-interval <MILLISECONDS>\n");
+  std::printf("\t\tHow often timed runs sample their throughput. 50 by\n");
+  std::printf("\t\tdefault.\n");
+  std::printf("\t--distribution <uniform|zipf[:T]|hotspot:X,Y|latest[:T]>\n");
+  std::printf("\t\tHow removals and lookups choose their keys. With\n");
+  std::printf("\t\tuniform, the default, each thread picks uniformly\n");
+  std::printf("\t\tamong the keys it inserted. zipf picks from all the\n");
+  std::printf("\t\tkeys with Zipfian skew T in (0, 1), 0.99 by default,\n");
+  std::printf("\t\thotspot sends a fraction X of the operations to a\n");
+  std::printf("\t\tfraction Y of the keys, and latest skews each thread\n");
+  std::printf("\t\ttowards the keys it inserted last.\n");
+  std::printf("\t--ycsb <WORKLOADS|all>\n");
+  std::printf("\t\tInstead of the regular runs, runs the YCSB core\n");
+  std::printf("\t\tworkloads given, separated by commas, on every map\n");
+  std::printf("\t\ttype. All n numbers are loaded before the clock starts,\n");
+  std::printf("\t\tand n operations are run. The workloads are:\n");
+  std::printf("\t\t- a (50%% reads, 50%% updates)\n");
+  std::printf("\t\t- b (95%% reads, 5%% updates)\n");
+  std::printf("\t\t- c (reads only)\n");
+  std::printf("\t\t- d (95%% reads of the latest keys, 5%% inserts)\n");
+  std::printf("\t\t- e (95%% scans of up to 100 keys, 5%% inserts)\n");
+  std::printf("\t\t- f (50%% reads, 50%% read-modify-writes)\n");
+  std::printf("\t--replay <FILE>\n");
+  std::printf("\t\tInstead of the regular runs, replays a binary trace\n");
+  std::printf("\t\ton the lists and maps selected, starting from empty\n");
+  std::printf("\t\tones. The file is mapped into memory, and each thread\n");
+  std::printf("\t\treplays a contiguous part of the records as fast as it\n");
+  std::printf("\t\tcan. Traces are recorded with the RecordingList and\n");
+  std::printf("\t\tRecordingMap shims of trace.h.\n");
+  std::printf("\t--build\n");
+  std::printf("\t\tInstead of the regular runs, times building the lists\n");
+  std::printf("\t\tand maps selected from empty: the threads insert all\n");
+  std::printf("\t\tthe numbers between them, with no preload and no other\n");
+  std::printf("\t\toperations.\n");
+  std::printf("\t--no-perf-counters\n");
+  std::printf("\t\tDoes not read hardware counters. By default each\n");
+  std::printf("\t\tworker counts cycles, instructions, branch misses, LLC\n");
+  std::printf("\t\tmisses and dTLB misses in user space over its run, and\n");
+  std::printf("\t\tthe instructions per cycle and misses per operation are\n");
+  std::printf("\t\treported where the counters are available.\n");
+  std::printf("\t--stats <json|csv>\n");
+  std::printf("\t\tAlso reports the statistics of the repeats of each\n");
+  std::printf("\t\tthread count: the mean, standard deviation, minimum,\n");
+  std::printf("\t\tmedian and 95%% confidence interval of the runtime,\n");
+  std::printf("\t\tthe throughput, the parallel efficiency against the\n");
+  std::printf("\t\tfewest threads, and every repeat. They go to a file\n");
+  std::printf("\t\tnext to the results with -o, and after them without.\n");
+  std::printf("\t--baseline <FILE>\n");
+  std::printf("\t\tReruns the configuration of a file written by --stats\n");
+  std::printf("\t\tjson, which replaces the operation mix, n, preload,\n");
+  std::printf("\t\tload factor, scaling, distribution, repeats, threads,\n");
+  std::printf("\t\tduration, kind of run (-d, --false-sharing, --ycsb,\n");
+  std::printf("\t\t--build or --replay) and --type given. A replay needs\n");
+  std::printf("\t\tits trace given again with --replay. Each list\n");
+  std::printf("\t\tand thread count is compared to the file with the\n");
+  std::printf("\t\tMann-Whitney U test on the runtimes of the repeats,\n");
+  std::printf("\t\tand the comparison goes to stderr. Exits with failure\n");
+  std::printf("\t\tif any is significantly slower, at 5%%, by more than\n");
+  std::printf("\t\tthe regression threshold. Needs at least 4 repeats on\n");
+  std::printf("\t\teach side for anything to be significant.\n");
+  std::printf("\t--placement <POLICY>\n");
+  std::printf("\t\tPins the threads to CPUs in the order of a policy,\n");
+  std::printf("\t\tfrom the CPU topology in sysfs. The policies are:\n");
+  std::printf("\t\t- linear (by CPU number, as -a does)\n");
+  std::printf("\t\t- compact (SMT siblings, then cores of a package)\n");
+  std::printf("\t\t- scatter (across packages, then cores, then SMT)\n");
+  std::printf("\t\t- physical-first (a thread per core before SMT)\n");
+  std::printf("\t\t- numa-rr (taking turns between NUMA nodes)\n");
+  std::printf("\t\tThe CPU of each thread is reported with the results.\n");
+  std::printf("\t--rate <FLOAT>\n");
+  std::printf("\t\tRuns open-loop: the threads together start this many\n");
+  std::printf("\t\toperations per second, each waiting until its next\n");
+  std::printf("\t\toperation is due, and latencies are measured from\n");
+  std::printf("\t\twhen it was due, so queueing behind slow operations\n");
+  std::printf("\t\tis counted. Past the rate a structure can sustain,\n");
+  std::printf("\t\tthe latencies grow without bound. Runs closed-loop,\n");
+  std::printf("\t\twith each operation as soon as the last one is done,\n");
+  std::printf("\t\tby default.\n");
+  std::printf("\t--arrivals <poisson|constant>\n");
+  std::printf("\t\tThe gaps between the operations of open-loop runs,\n");
+  std::printf("\t\tdrawn from an exponential distribution or all the\n");
+  std::printf("\t\tsame. poisson by default.\n");
+  std::printf("\t--allocator <glibc|tbbmalloc|pool>\n");
+  std::printf("\t\tWhere the memory of every list and map comes from:\n");
+  std::printf("\t\tmalloc, TBB's scalable_malloc, or a pool of blocks in\n");
+  std::printf("\t\tsize classes that each thread keeps free lists of.\n");
+  std::printf("\t\tglibc by default. It is reported with the memory use.\n");
+  std::printf("\t--regression-threshold <FLOAT>\n");
+  std::printf("\t\tHow much longer, as a fraction of the baseline median,\n");
+  std::printf("\t\ta runtime has to be to regress. 0.05 by default.\n");
 }
 
 void usageErr(const char *name) {
@@ -296,7 +713,7 @@ void usageErr(const char *name) {
   std::exit(EXIT_FAILURE);
 }
 
-void checkArgs(const RunnerParams &params) {
+void checkArgs(const RunnerParams &params, bool checkMix) {
   assert(params.n);
   assert(params.inserts >= 0.0 and params.inserts <= 1.0);
   assert(params.removals >= 0.0 and params.removals <= 1.0);
@@ -304,11 +721,13 @@ void checkArgs(const RunnerParams &params) {
   assert(params.preload >= 0.0 and params.preload <= 1.0);
   assert(params.minThreads >= 1 and params.minThreads <= params.maxThreads);
   auto total = params.inserts + params.removals + params.lookups;
-  assert(std::fabs(1.0 - total) <= 0.01);
+  // The YCSB workloads bring their own mix.
+  assert(not checkMix or std::fabs(1.0 - total) <= 0.01);
 }
 
 void printResults(const std::vector<RunnerResults> &results,
-                  const RunnerParams &params, bool pretty = false) {
+                  const RunnerParams &params, bool pretty = false,
+                  const std::string &statsFormat = "") {
   if (!params.outDirectory.empty()) {
     std::string filename = "n" + std::to_string(params.n) + "_i" +
                            std::to_string(params.inserts).substr(0, 4) + "_r" +
@@ -316,6 +735,11 @@ void printResults(const std::vector<RunnerResults> &results,
                            std::to_string(params.lookups).substr(0, 4) + "_u" +
                            std::to_string(params.mapLoadFactor).substr(0, 4) +
                            "_" + params.structs;
+    if (params.distribution.type != Distribution::Uniform) {
+      std::ostringstream oss;
+      oss << params.distribution;
+      filename += "_" + oss.str();
+    }
     if (mkdir(params.outDirectory.c_str(), S_IRWXU) != 0) {
       if (errno != 17) {
         // not "File exists" error
@@ -325,38 +749,606 @@ void printResults(const std::vector<RunnerResults> &results,
       }
     }
     std::freopen((params.outDirectory + "/" + filename).c_str(), "w", stdout);
+    if (params.duration > 0.0) {
+      auto path = params.outDirectory + "/" + filename + "_timeseries";
+      if (auto out = std::fopen(path.c_str(), "w")) {
+        printTimeSeries(results, params, out);
+        std::fclose(out);
+      } else {
+        std::fprintf(stderr, "ERROR %d: unable to open %s; %s\n", errno,
+                     path.c_str(), strerror(errno));
+      }
+    }
+    if (not statsFormat.empty()) {
+      auto path =
+          params.outDirectory + "/" + filename + "_stats." + statsFormat;
+      if (auto out = std::fopen(path.c_str(), "w")) {
+        printStats(results, params, statsFormat, out);
+        std::fclose(out);
+      } else {
+        std::fprintf(stderr, "ERROR %d: unable to open %s; %s\n", errno,
+                     path.c_str(), strerror(errno));
+      }
+    }
   }
   if (not pretty) {
     std::cout << "list,cores,minThreads,maxThreads,n,inserts,removals,"
               << "lookups,scalingMode,withAffinity,preload,runtimes...\n";
+    std::cout << "#list,threads,op,count,p50,p99,p99.9,max (nanoseconds)\n";
+    std::cout << "#list,threads,counters,ops,cycles,instructions,"
+              << "branch-misses,llc-misses,dtlb-misses,ipc\n";
+    std::cout << "#list,threads,memory,allocator,peakRss,liveBytes,"
+              << "elements,bytesPerElement,allocations,frees,"
+              << "allocationsPerOp\n";
+    if (LockStats::kEnabled)
+      std::cout << "#list,threads,locks,acquisitions,contended,waitP50,"
+                << "waitP99,waitMax,holdP50,holdP99,holdMax (nanoseconds)\n";
+    if (DefaultListStats::kEnabled)
+      std::cout << "#list,threads,lists,ops,hops,casFailures,restarts,"
+                << "hopsPerOp,casFailuresPerOp,restartsPerOp\n";
+    std::cout << "#list,placement,cpu of each thread...\n";
     std::cout << std::boolalpha;
-    std::copy(results.begin(), results.end(),
-              std::ostream_iterator<RunnerResults>(std::cout, "\n"));
+    for (auto &r : results) {
+      std::cout << r << '\n';
+      printLatencies(r, false);
+      printPerfCounts(r, false);
+      printMemory(r, false);
+      printLocks(r, false);
+      printListStats(r, false);
+      printPlacement(r, false);
+    }
+    if (params.duration > 0.0 and params.outDirectory.empty()) {
+      std::cout << '\n' << std::flush;
+      printTimeSeries(results, params, stdout);
+    }
   } else {
     std::printf("Concurrency stats:\n");
     std::printf("\tcores=%u\n", params.nCores);
     std::printf("\tminThreads=%u\n", params.minThreads);
     std::printf("\tmaxThreads=%u\n", params.maxThreads);
     std::printf("\taffinity=%s\n", params.withAffinity ? "true" : "false");
+    if (not results.empty())
+      printPlacement(results.front(), true);
     std::printf("Use-profile stats:\n");
     std::printf("\tn=%lu\n", params.n);
     std::printf("\tinserts=%.2f\n", params.inserts);
     std::printf("\tremovals=%.2f\n", params.removals);
     std::printf("\tlookups=%.2f\n", params.lookups);
     std::printf("\tpreload=%.2f\n", params.preload);
+    std::cout << "\tdistribution=" << params.distribution << std::endl;
+    std::cout << "\tallocator=" << params.allocator << std::endl;
+    if (params.duration > 0.0)
+      std::printf("\tduration=%.2f\n", params.duration);
+    if (params.rate > 0.0)
+      std::cout << "\trate=" << params.rate << " ops/sec, "
+                << params.arrivals << " arrivals" << std::endl;
     for (auto &r : results) {
       std::printf("%s\n", r.name.c_str());
       auto j = params.minThreads;
-      for (auto first = r.runTimes.begin(); first != r.runTimes.end(); ++first)
-        std::printf("\t%u threads - %.5f seconds\n", j++, *first);
+      for (size_t i = 0; i < r.runTimes.size(); ++i) {
+        std::printf("\t%u threads - %.5f seconds", j++, r.runTimes[i]);
+        if (i < r.repeats.size() and r.repeats[i].size() > 1) {
+          std::vector<double> runTimes;
+          for (auto &sample : r.repeats[i])
+            runTimes.push_back(sample.runTime);
+          auto s = summarize(runTimes);
+          std::printf(" (+/- %.5f, stddev %.5f)", s.ciHigh - s.mean, s.stddev);
+        }
+        if (i < r.timeSeries.size() and not r.timeSeries[i].empty()) {
+          // The last sample of each repeat has the total of that repeat.
+          double ops = 0.0, elapsed = 0.0;
+          auto &series = r.timeSeries[i];
+          for (size_t k = 0; k < series.size(); ++k) {
+            if (k + 1 == series.size() or
+                series[k + 1].repeat != series[k].repeat) {
+              ops += series[k].ops;
+              elapsed += series[k].elapsed;
+            }
+          }
+          std::printf(" - %.0f ops/sec", ops / elapsed);
+        }
+        std::printf("\n");
+      }
+      printLatencies(r, true);
+      printPerfCounts(r, true);
+      printMemory(r, true);
+      printLocks(r, true);
+      printListStats(r, true);
     }
   }
+  if (not statsFormat.empty() and params.outDirectory.empty()) {
+    std::cout << '\n' << std::flush;
+    printStats(results, params, statsFormat, stdout);
+  }
+}
+
+/**
+ * Prints the throughput samples of timed runs as CSV, with the throughput of
+ * each interval since the previous sample.
+ * @param results The results to print the samples of.
+ * @param params The parameters of the run.
+ * @param out Where to print them.
+ */
+void printTimeSeries(const std::vector<RunnerResults> &results,
+                     const RunnerParams &params, std::FILE *out) {
+  std::fprintf(out, "list,threads,repeat,elapsed,ops,opsPerSec\n");
+  for (auto &r : results) {
+    auto threads = params.minThreads;
+    for (auto &series : r.timeSeries) {
+      ThroughputSample prev{0, 0.0, 0};
+      for (auto &sample : series) {
+        if (sample.repeat != prev.repeat)
+          prev = {sample.repeat, 0.0, 0};
+        auto rate = (sample.ops - prev.ops) / (sample.elapsed - prev.elapsed);
+        std::fprintf(out, "%s,%u,%u,%.4f,%lu,%.0f\n", r.name.c_str(), threads,
+                     sample.repeat, sample.elapsed, sample.ops, rate);
+        prev = sample;
+      }
+      ++threads;
+    }
+  }
+}
+
+/**
+ * Prints the memory use of each thread count: the peak RSS of the process,
+ * the bytes the structure held at the end and per element, and the
+ * allocations its operations did. In the CSV format it goes on comment lines
+ * after the runtimes.
+ * @param results The results to print the memory use of.
+ * @param pretty Whether to use the readable format.
+ */
+void printMemory(const RunnerResults &results, bool pretty) {
+  if (results.memory.empty())
+    return;
+  if (pretty)
+    std::printf("\tmemory          peak RSS  live bytes  elements  "
+                "bytes/elem  allocs/op\n");
+  std::ostringstream allocator;
+  allocator << results.params.allocator;
+  auto threads = results.params.minThreads;
+  for (auto &m : results.memory) {
+    if (pretty)
+      std::printf("\t%2u threads %13lu %11ld %9lu %11.1f %10.3f\n", threads,
+                  m.peakRss, m.liveBytes, m.elements, m.BytesPerElement(),
+                  m.AllocationsPerOp());
+    else
+      std::printf("#%s,%u,memory,%s,%lu,%ld,%lu,%.1f,%lu,%lu,%.3f\n",
+                  results.name.c_str(), threads, allocator.str().c_str(),
+                  m.peakRss, m.liveBytes, m.elements, m.BytesPerElement(),
+                  m.allocations, m.frees, m.AllocationsPerOp());
+    ++threads;
+  }
+}
+
+/**
+ * Prints the lock profile of each thread count: how many locks were taken,
+ * how many of them had to be waited for, and the wait and hold times. In the
+ * CSV format it goes on comment lines after the runtimes. Prints nothing
+ * unless lock profiling is built in, or for structures without locks.
+ * @param results The results to print the lock profile of.
+ * @param pretty Whether to use the readable format.
+ */
+void printLocks(const RunnerResults &results, bool pretty) {
+  bool any = false;
+  for (auto &locks : results.locks)
+    any = any or locks.acquisitions;
+  if (not any)
+    return;
+  if (pretty)
+    std::printf("\tlocks (ns)      acquired  contended   wait p50      p99"
+                "      max   hold p50      p99      max\n");
+  const double nsPerTick = CycleClock::NsPerTick();
+  auto threads = results.params.minThreads;
+  for (auto &locks : results.locks) {
+    double times[] = {locks.wait.Percentile(50) * nsPerTick,
+                      locks.wait.Percentile(99) * nsPerTick,
+                      locks.wait.max * nsPerTick,
+                      locks.hold.Percentile(50) * nsPerTick,
+                      locks.hold.Percentile(99) * nsPerTick,
+                      locks.hold.max * nsPerTick};
+    if (pretty)
+      std::printf("\t%2u threads %13lu %10lu %10.0f %8.0f %8.0f %10.0f %8.0f "
+                  "%8.0f\n",
+                  threads, locks.acquisitions, locks.contended, times[0],
+                  times[1], times[2], times[3], times[4], times[5]);
+    else
+      std::printf("#%s,%u,locks,%lu,%lu,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n",
+                  results.name.c_str(), threads, locks.acquisitions,
+                  locks.contended, times[0], times[1], times[2], times[3],
+                  times[4], times[5]);
+    ++threads;
+  }
+}
+
+/**
+ * Prints the list statistics of each thread count: how many nodes the
+ * traversals visited, how many CASes failed and how many traversals restarted,
+ * in total and per operation. In the CSV format they go on comment lines after
+ * the runtimes. Prints nothing unless list statistics are built in, or for
+ * structures that are not lists or maps of lists.
+ * @param results The results to print the list statistics of.
+ * @param pretty Whether to use the readable format.
+ */
+void printListStats(const RunnerResults &results, bool pretty) {
+  bool any = false;
+  for (auto &lists : results.lists)
+    any = any or lists.Any();
+  if (not any)
+    return;
+  if (pretty)
+    std::printf("\tlists                 ops         hops  casFailures"
+                "  restarts  hops/op  cas/op  restarts/op\n");
+  auto threads = results.params.minThreads;
+  for (size_t i = 0; i < results.lists.size(); ++i) {
+    auto &lists = results.lists[i];
+    uint64_t ops = 0;
+    if (i < results.repeats.size())
+      for (auto &repeat : results.repeats[i])
+        ops += repeat.ops;
+    double perOp[] = {ops ? static_cast<double>(lists.hops) / ops : 0.0,
+                      ops ? static_cast<double>(lists.casFailures) / ops : 0.0,
+                      ops ? static_cast<double>(lists.restarts) / ops : 0.0};
+    if (pretty)
+      std::printf("\t%2u threads %14lu %12lu %12lu %9lu %8.2f %7.3f %12.3f\n",
+                  threads, ops, lists.hops, lists.casFailures, lists.restarts,
+                  perOp[0], perOp[1], perOp[2]);
+    else
+      std::printf("#%s,%u,lists,%lu,%lu,%lu,%lu,%.3f,%.4f,%.4f\n",
+                  results.name.c_str(), threads, ops, lists.hops,
+                  lists.casFailures, lists.restarts, perOp[0], perOp[1],
+                  perOp[2]);
+    ++threads;
+  }
+}
+
+/**
+ * Prints the placement of the threads and the CPU each one was pinned to, -1
+ * if it was not. In the CSV format it goes on a comment line after the
+ * runtimes.
+ * @param results The results to print the placement of.
+ * @param pretty Whether to use the readable format.
+ */
+void printPlacement(const RunnerResults &results, bool pretty) {
+  const auto &params = results.params;
+  std::ostringstream oss;
+  oss << params.placement;
+  if (params.placement == Placement::None and params.withAffinity)
+    oss.str("linear");
+  if (pretty)
+    std::printf("\tplacement=%s\n\tcpus=", oss.str().c_str());
+  else
+    std::printf("#%s,%s", results.name.c_str(), oss.str().c_str());
+  for (size_t t = 0; t < params.cpus.size(); ++t)
+    std::printf(pretty and t == 0 ? "%d" : ",%d", params.cpus[t]);
+  std::printf("\n");
+}
+
+/**
+ * Prints the statistics of the repeats of each thread count, as JSON or as
+ * CSV. The runtimes are in seconds, the throughput is the operations of all
+ * repeats over their total runtime, and the efficiency is the throughput per
+ * thread against that of the fewest threads run.
+ * @param results The results to print the statistics of.
+ * @param params The parameters of the run.
+ * @param format "json" or "csv".
+ * @param out Where to print them.
+ */
+void printStats(const std::vector<RunnerResults> &results,
+                const RunnerParams &params, const std::string &format,
+                std::FILE *out) {
+  bool json = format == "json";
+  if (json) {
+    std::ostringstream distribution, placement, arrivals, allocator;
+    distribution << params.distribution;
+    placement << params.placement;
+    arrivals << params.arrivals;
+    allocator << params.allocator;
+    std::fprintf(
+        out,
+        "{\"config\": {\"n\": %zu, \"inserts\": %g, \"removals\": %g, "
+        "\"lookups\": %g, \"preload\": %g, \"loadFactor\": %g, "
+        "\"scaling\": \"%s\", \"distribution\": \"%s\", "
+        "\"repeat\": %u, \"minThreads\": %u, \"maxThreads\": %u, "
+        "\"duration\": %g, \"structs\": \"%s\", \"types\": \"%s\", "
+        "\"affinity\": %s, \"placement\": \"%s\", \"rate\": %g, "
+        "\"arrivals\": \"%s\", \"allocator\": \"%s\", \"cpus\": [",
+        params.n, params.inserts, params.removals, params.lookups,
+        params.preload, params.mapLoadFactor,
+        params.scalingMode == ScalingMode::Memory ? "memory" : "problem",
+        distribution.str().c_str(), params.repeat, params.minThreads,
+        params.maxThreads, params.duration, params.structs.c_str(),
+        params.types.c_str(), params.withAffinity ? "true" : "false",
+        placement.str().c_str(), params.rate, arrivals.str().c_str(),
+        allocator.str().c_str());
+    auto &cpus = results.empty() ? params.cpus : results.front().params.cpus;
+    for (size_t t = 0; t < cpus.size(); ++t)
+      std::fprintf(out, "%s%d", t ? ", " : "", cpus[t]);
+    std::fprintf(out, "]},\n\"results\": [");
+  } else
+    std::fprintf(out, "list,threads,repeats,mean,stddev,min,median,ci95Low,"
+                      "ci95High,opsPerSec,efficiency,runtimes...\n");
+  bool firstRecord = true;
+  for (auto &r : results) {
+    double baseRate = 0.0;
+    auto threads = params.minThreads;
+    for (auto &repeats : r.repeats) {
+      std::vector<double> runTimes;
+      double totalTime = 0.0;
+      uint64_t totalOps = 0;
+      for (auto &sample : repeats) {
+        runTimes.push_back(sample.runTime);
+        totalTime += sample.runTime;
+        totalOps += sample.ops;
+      }
+      auto s = summarize(runTimes);
+      auto rate = totalTime > 0.0 ? totalOps / totalTime : 0.0;
+      if (threads == params.minThreads)
+        baseRate = rate / threads;
+      auto efficiency = baseRate > 0.0 ? rate / threads / baseRate : 0.0;
+      if (json) {
+        std::fprintf(out,
+                     "%s\n  {\"list\": \"%s\", \"threads\": %u, "
+                     "\"repeats\": %zu, \"mean\": %.6f, \"stddev\": %.6f, "
+                     "\"min\": %.6f, \"median\": %.6f, "
+                     "\"ci95\": [%.6f, %.6f], \"opsPerSec\": %.0f, "
+                     "\"efficiency\": %.4f, \"runtimes\": [",
+                     firstRecord ? "" : ",", r.name.c_str(), threads, s.count,
+                     s.mean, s.stddev, s.min, s.median, s.ciLow, s.ciHigh,
+                     rate, efficiency);
+        for (size_t i = 0; i < runTimes.size(); ++i)
+          std::fprintf(out, "%s%.6f", i ? ", " : "", runTimes[i]);
+        std::fprintf(out, "]}");
+      } else {
+        std::fprintf(out, "%s,%u,%zu,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.0f,%.4f",
+                     r.name.c_str(), threads, s.count, s.mean, s.stddev, s.min,
+                     s.median, s.ciLow, s.ciHigh, rate, efficiency);
+        for (auto t : runTimes)
+          std::fprintf(out, ",%.6f", t);
+        std::fprintf(out, "\n");
+      }
+      firstRecord = false;
+      ++threads;
+    }
+  }
+  if (json)
+    std::fprintf(out, "\n]}\n");
+}
+
+/**
+ * Prints how each list and thread count compares to the baseline to stderr.
+ * @param comparisons The comparisons.
+ * @param threshold The regression threshold.
+ * @return True if any of them regressed.
+ */
+bool printComparison(const std::vector<CellComparison> &comparisons,
+                     double threshold) {
+  bool regressed = false;
+  std::fprintf(stderr,
+               "Baseline comparison (Mann-Whitney, p < 0.05, regression "
+               "threshold %.1f%%):\n",
+               threshold * 100.0);
+  for (auto &c : comparisons) {
+    std::fprintf(stderr, "\t%s %u threads - ", c.list.c_str(), c.threads);
+    if (not c.hasBaseline) {
+      std::fprintf(stderr, "no baseline\n");
+      continue;
+    }
+    std::fprintf(stderr, "%.5f -> %.5f seconds - %.3fx, p=%.3f",
+                 c.baselineMedian, c.median, c.speedup, c.p);
+    if (c.regressed)
+      std::fprintf(stderr, " - REGRESSION\n");
+    else if (c.significant)
+      std::fprintf(stderr, " - %s\n", c.speedup > 1.0 ? "faster" : "slower");
+    else
+      std::fprintf(stderr, " - no significant change\n");
+    regressed = regressed or c.regressed;
+  }
+  return regressed;
+}
+
+/**
+ * Prints the latency percentiles of each operation and thread count, in
+ * nanoseconds. In the CSV format they go on comment lines after the runtimes,
+ * so that readers of the runtimes can skip them.
+ * @param results The results to print the latencies of.
+ * @param pretty Whether to use the readable format.
+ */
+void printLatencies(const RunnerResults &results, bool pretty) {
+  if (results.latencies.empty())
+    return;
+  if (pretty)
+    std::printf("\tlatencies (ns)     count      p50      p99    p99.9"
+                "      max\n");
+  const double nsPerTick = CycleClock::NsPerTick();
+  auto threads = results.params.minThreads;
+  for (auto &latencies : results.latencies) {
+    const std::pair<const char *, const LatencyHistogram *> ops[] = {
+        {"insert", &latencies.insert},
+        {"remove", &latencies.remove},
+        {"lookup", &latencies.lookup},
+        {"update", &latencies.update},
+        {"scan", &latencies.scan},
+        {"rmw", &latencies.readModifyWrite}};
+    for (auto &op : ops) {
+      auto &hist = *op.second;
+      if (hist.count == 0)
+        continue;
+      auto p50 = hist.Percentile(50) * nsPerTick;
+      auto p99 = hist.Percentile(99) * nsPerTick;
+      auto p999 = hist.Percentile(99.9) * nsPerTick;
+      auto max = hist.max * nsPerTick;
+      if (pretty)
+        std::printf("\t%2u threads %-6s %9lu %8.0f %8.0f %8.0f %8.0f\n",
+                    threads, op.first, hist.count, p50, p99, p999, max);
+      else
+        std::printf("#%s,%u,%s,%lu,%.0f,%.0f,%.0f,%.0f\n",
+                    results.name.c_str(), threads, op.first, hist.count, p50,
+                    p99, p999, max);
+    }
+    ++threads;
+  }
+}
+
+/**
+ * Prints the hardware counters of each thread count, if any could be read. The
+ * readable format has instructions per cycle and the rest per operation, and
+ * the CSV format has the totals on comment lines, with unavailable counters
+ * left empty.
+ * @param results The results to print the counters of.
+ * @param pretty Whether to use the readable format.
+ */
+void printPerfCounts(const RunnerResults &results, bool pretty) {
+  bool any = false;
+  for (auto &counts : results.perfCounts)
+    any = any or counts.Any();
+  if (not any)
+    return;
+  const PerfEvent events[] = {PerfEvent::Cycles, PerfEvent::Instructions,
+                              PerfEvent::BranchMisses, PerfEvent::LlcMisses,
+                              PerfEvent::DtlbMisses};
+  if (pretty) {
+    std::printf("\tcounters per op      ipc");
+    for (auto event : events)
+      std::printf(" %13s", perfEventName(event));
+    std::printf("\n");
+  }
+  auto threads = results.params.minThreads;
+  for (auto &counts : results.perfCounts) {
+    if (pretty) {
+      std::printf("\t%2u threads       %8.2f", threads, counts.Ipc());
+      for (auto event : events) {
+        if (counts.Available(event))
+          std::printf(" %13.2f", counts.PerOp(event));
+        else
+          std::printf(" %13s", "-");
+      }
+    } else {
+      std::printf("#%s,%u,counters,%lu", results.name.c_str(), threads,
+                  counts.ops);
+      for (auto event : events) {
+        if (counts.Available(event))
+          std::printf(",%lu", counts[event]);
+        else
+          std::printf(",");
+      }
+      std::printf(",%.3f", counts.Ipc());
+    }
+    std::printf("\n");
+    ++threads;
+  }
+}
+
+/**
+ * Runs the false sharing benchmark for a HashMap with packed and with padded
+ * buckets.
+ * @param runner The runner to use.
+ * @param mapName The name of the map.
+ * @param results Where to add the results.
+ */
+template <template <typename, typename> class TMap>
+void runFalseSharing(BenchmarkRunner &runner, const std::string &mapName,
+                     std::vector<RunnerResults> &results) {
+  results.push_back(runner.RunMapAdjacentBuckets<TMap>(mapName + "/packed",
+                                                       BucketLayout::Packed));
+  results.push_back(runner.RunMapAdjacentBuckets<TMap>(mapName + "/padded",
+                                                       BucketLayout::Padded));
+}
+
+/**
+ * @param names The names of the YCSB workloads, separated by commas, or all.
+ * @param prog The name of the program, for the usage message.
+ * @return The workloads, in the order given.
+ */
+std::vector<const YcsbWorkload *> getYcsbWorkloads(const std::string &names,
+                                                   const char *prog) {
+  std::vector<const YcsbWorkload *> workloads;
+  auto words = split(toLower(names) == "all" ? "a,b,c,d,e,f" : names, ',');
+  for (auto &w : words) {
+    auto workload = w.size() == 1 ? findYcsbWorkload(w[0]) : nullptr;
+    if (not workload)
+      usageErr(prog);
+    workloads.push_back(workload);
+  }
+  if (workloads.empty())
+    usageErr(prog);
+  return workloads;
+}
+
+/**
+ * Runs something on every list type given, as run.List<TList>(name, single).
+ * @param typeNames The names of the types.
+ * @param run What to run.
+ */
+template <typename TRun>
+void forEachList(const std::set<std::string> &typeNames, TRun run) {
+  for (auto &name : typeNames) {
+    if (name == "single")
+      run.template List<DlList>("DlList", std::true_type());
+    else if (name == "coarsegrain")
+      run.template List<CoarseGrainList>("CoarseGrainList", std::false_type());
+    else if (name == "finegrain")
+      run.template List<FineGrainList>("FineGrainList", std::false_type());
+    else if (name == "compact")
+      run.template List<CompactFineGrainList>("CompactFineGrainList",
+                                              std::false_type());
+    else if (name == "spinning")
+      run.template List<NonBlockingList>("NonBlockingList", std::false_type());
+    else if (name == "lockfree")
+      run.template List<LockFreeList>("LockFreeList", std::false_type());
+    else if (name == "elimination")
+      run.template List<EliminationList>("EliminationList", std::false_type());
+    else if (name == "lockfreedl")
+      run.template List<LockFreeDlList>("LockFreeDlList", std::false_type());
+    else if (name == "tagged")
+      run.template List<TaggedLockFreeList>("TaggedLockFreeList",
+                                            std::false_type());
+  }
+}
+
+/**
+ * Runs something on every map type given, as run.Map<TMap>(name, single).
+ * @param typeNames The names of the types.
+ * @param run What to run.
+ */
+template <typename TRun>
+void forEachMap(const std::set<std::string> &typeNames, TRun run) {
+  for (auto &name : typeNames) {
+    if (name == "single")
+      run.template Map<DlListMap>("DlListMap", std::true_type());
+    else if (name == "coarsegrain")
+      run.template Map<CoarseGrainListMap>("CoarseGrainListMap",
+                                           std::false_type());
+    else if (name == "finegrain")
+      run.template Map<FineGrainListMap>("FineGrainListMap", std::false_type());
+    else if (name == "compact")
+      run.template Map<CompactFineGrainListMap>("CompactFineGrainListMap",
+                                                std::false_type());
+    else if (name == "spinning")
+      run.template Map<NonBlockingListMap>("NonBlockingListMap",
+                                           std::false_type());
+    else if (name == "lockfree")
+      run.template Map<LockFreeListMap>("LockFreeListMap", std::false_type());
+    else if (name == "elimination")
+      run.template Map<EliminationListMap>("EliminationListMap",
+                                           std::false_type());
+    else if (name == "lockfreedl")
+      run.template Map<LockFreeDlListMap>("LockFreeDlListMap",
+                                          std::false_type());
+    else if (name == "tagged")
+      run.template Map<TaggedLockFreeListMap>("TaggedLockFreeListMap",
+                                              std::false_type());
+    else if (name == "cuckoo")
+      run.template Map<LibCuckooHashMap>("LibCuckooHashMap", std::false_type());
+    else if (name == "tbb")
+      run.template Map<TbbHashMap>("TbbHashMap", std::false_type());
+  }
 }
 
 std::set<std::string> getTypeNames(const std::string &names, const char *prog) {
   static const std::set<std::string> kTypeNames = {
-      "single",   "coarsegrain", "finegrain", "spinning",
-      "lockfree", "cuckoo",      "tbb"};
+      "single",   "coarsegrain", "finegrain",  "compact", "spinning",
+      "lockfree", "elimination", "lockfreedl", "tagged",  "cuckoo",
+      "tbb"};
   auto words = split(names, ',');
   if (words.empty())
     return kTypeNames;
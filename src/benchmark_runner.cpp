@@ -4,15 +4,36 @@
  * Non-template definitions for BenchmarkRunner.
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <functional>
 #include <ostream>
+#include <random>
 #include <thread>
+#include <vector>
 
 #include "benchmark_runner.h"
 #include "util.h"
 
 const unsigned RunnerParams::nCores = std::thread::hardware_concurrency();
 
+namespace {
+
+/**
+ * @return The CPU each worker is to be pinned to, or -1.
+ */
+std::vector<int> placeThreads(const RunnerParams &params) {
+  auto placement = params.placement;
+  if (placement == Placement::None and params.withAffinity)
+    placement = Placement::Linear;
+  if (placement == Placement::None)
+    return {};
+  return CpuTopology::Read().Assign(placement, params.maxThreads);
+}
+
+} // anonymous namespace
+
 std::ostream &operator<<(std::ostream &os, ScalingMode mode) {
   const char *ptr;
   switch (mode) {
@@ -49,7 +70,10 @@ std::ostream &operator<<(std::ostream &os, const RunnerResults &rr) {
  *
  * @param params The parameters to use for running the benchmark.
  */
-BenchmarkRunner::BenchmarkRunner(const RunnerParams &params) : params(params) {
+BenchmarkRunner::BenchmarkRunner(const RunnerParams &params)
+    : params(params), pool(params.maxThreads, placeThreads(params)) {
+  this->params.cpus = pool.cpus;
+  setAllocator(params.allocator);
   PrepareNumbers();
 }
 
@@ -59,6 +83,98 @@ void BenchmarkRunner::PrepareNumbers() {
     n *= params.nCores;
   for (size_t i = 0; i < n; ++i)
     numbers.push_back(i);
+  auto type = params.distribution.type;
+  if (type == Distribution::Zipf or type == Distribution::Latest)
+    zipf = ZipfGenerator(numbers.size(), params.distribution.theta);
+}
+
+/**
+ * Chooses the key of an operation from the distribution in params.
+ * @param cp The chunk of the thread.
+ * @param first The next number the thread would insert, so the ones before it
+ *  in its chunk are the ones it inserted.
+ * @param u A number drawn uniformly from [0, 1).
+ * @return The key.
+ */
+int BenchmarkRunner::ChooseKey(const ChunkParams &cp, size_t first,
+                               double u) const noexcept {
+  const auto &dist = params.distribution;
+  const size_t n = numbers.size();
+  size_t index = 0;
+  switch (dist.type) {
+  case Distribution::Uniform:
+    index = u * (n - 1);
+    break;
+  case Distribution::Zipf:
+    index = zipf(u);
+    break;
+  case Distribution::Hotspot: {
+    size_t nHot = std::max<size_t>(1, dist.hotKeys * n);
+    if (u < dist.hotOps)
+      index = u / dist.hotOps * nHot;
+    else
+      index = nHot + (u - dist.hotOps) / (1.0 - dist.hotOps) * (n - nHot);
+    break;
+  }
+  case Distribution::Latest: {
+    size_t inserted = first - cp.start;
+    index = inserted ? first - 1 - zipf(u) % inserted : zipf(u);
+    break;
+  }
+  }
+  return numbers[std::min(index, n - 1)];
+}
+
+/**
+ * @param cp The chunk of the thread.
+ * @return How many operations to draw for the thread: one per operation of its
+ *  chunk, up to OpStream::kMaxOps, or that many for timed runs.
+ */
+size_t BenchmarkRunner::StreamLength(const ChunkParams &cp) const noexcept {
+  if (RunsForDuration() or cp.chunk > OpStream::kMaxOps)
+    return OpStream::kMaxOps;
+  return cp.chunk;
+}
+
+/**
+ * Draws the operation streams of a run with the insert, remove and lookup mix
+ * of params, each worker drawing its own.
+ * @param nThreads The number of threads of the run.
+ * @return A stream per thread.
+ */
+std::vector<OpStream> BenchmarkRunner::MakeOpStreams(size_t nThreads) {
+  std::vector<OpStream> streams(nThreads);
+  pool.Run(nThreads,
+           [&](size_t t) { streams[t] = MakeOpStream(t, nThreads); });
+  return streams;
+}
+
+/**
+ * Draws the operations of a thread with the insert, remove and lookup mix of
+ * params. Inserts take turns between Insert and InsertUnique at random.
+ * @param threadId The thread.
+ * @param nThreads The number of threads of the run.
+ * @return The stream.
+ */
+OpStream BenchmarkRunner::MakeOpStream(size_t threadId,
+                                       size_t nThreads) const {
+  const auto rThreshold = params.inserts + params.removals;
+  auto genRand = std::bind(std::uniform_real_distribution<float>(),
+                           std::default_random_engine(kSeed * threadId));
+  OpStream stream;
+  auto n = StreamLength(GetChunkParams(threadId, nThreads));
+  stream.entries.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    auto r = genRand();
+    MixOp op = MixOp::Lookup;
+    if (r < params.inserts)
+      op = genRand() < 0.5 ? MixOp::Insert : MixOp::InsertUnique;
+    else if (r < rThreshold)
+      op = MixOp::Remove;
+    stream.entries.push_back(
+        OpStream::Pack(static_cast<unsigned>(op), genRand()));
+  }
+  return stream;
 }
 
 ChunkParams BenchmarkRunner::GetChunkParams(size_t threadId,
@@ -78,3 +194,207 @@ ChunkParams BenchmarkRunner::GetChunkParams(size_t threadId,
   nPreload = params.preload * chunk;
   return {start, startNext, chunk, nPreload};
 }
+
+/**
+ * Runs one repeat on the pool and keeps its runtime and the number of
+ * operations the workers did in it.
+ * @param nThreads The number of threads to run.
+ * @param stats The stats of the workers, which count their operations.
+ * @param repeats Where to add the repeat.
+ * @param task What each worker runs.
+ * @return The runtime of the repeat, in seconds.
+ */
+double BenchmarkRunner::TimeRepeat(size_t nThreads,
+                                   std::vector<WorkerStats> &stats,
+                                   std::vector<RepeatSample> &repeats,
+                                   const WorkerPool::Task &task) {
+  uint64_t opsBefore = 0;
+  for (auto &s : stats)
+    opsBefore += s.ops;
+  runStart = MemorySnapshot::Take();
+  // The locks the workers take are profiled into their stats, and their list
+  // operations counted, if at all.
+  auto runTime = pool.Run(nThreads, [&](size_t t) {
+    LockStats::current = &stats[t].locks;
+    ListCounters::current = &stats[t].lists;
+    task(t);
+    LockStats::current = nullptr;
+    ListCounters::current = nullptr;
+  });
+  runEnd = MemorySnapshot::Take();
+  uint64_t opsAfter = 0;
+  for (auto &s : stats)
+    opsAfter += s.ops;
+  repeats.push_back({runTime, opsAfter - opsBefore});
+  return runTime;
+}
+
+/**
+ * Resets the peak RSS and takes the allocation counts before a structure is
+ * built.
+ * @return The counts.
+ */
+MemorySnapshot BenchmarkRunner::StartMemory() noexcept {
+  resetPeakRss();
+  return MemorySnapshot::Take();
+}
+
+/**
+ * Adds the memory use of the last repeat, whose structure must still be
+ * around.
+ * @param memory Where to add it.
+ * @param built The counts from before the structure was built.
+ * @param elements The number of elements in the structure.
+ * @param repeats The repeats so far, the last one the one to add.
+ * @param otherBytes What is still allocated for something other than the
+ *  structure since it was built, like the preload buffers.
+ */
+void BenchmarkRunner::RecordMemory(MemoryUsage &memory,
+                                   const MemorySnapshot &built,
+                                   size_t elements,
+                                   const std::vector<RepeatSample> &repeats,
+                                   size_t otherBytes) const noexcept {
+  memory.Add(built, runStart, runEnd, elements, repeats.back().ops,
+             otherBytes);
+}
+
+/**
+ * @return The bytes the preload buffers were counted for.
+ */
+size_t BenchmarkRunner::BufferBytes(
+    const std::vector<std::vector<int>> &buffers) noexcept {
+  size_t bytes = allocatedSize(buffers.data());
+  for (auto &buf : buffers)
+    bytes += allocatedSize(buf.data());
+  return bytes;
+}
+
+/**
+ * Starts the schedule of a worker at the start of its region. Each worker
+ * gets an equal share of params.rate, so the load offered stays the same as
+ * the number of threads changes. Does nothing to closed-loop runs.
+ * @param arrivals The schedule of the worker.
+ * @param threadId The worker.
+ * @param nThreads The number of workers of the run.
+ */
+void BenchmarkRunner::StartArrivals(ArrivalSchedule &arrivals, size_t threadId,
+                                    size_t nThreads) {
+  if (params.rate > 0.0)
+    arrivals.Start(params.rate / nThreads, params.arrivals,
+                   kSeed * (threadId + 1));
+}
+
+/**
+ * Starts the sampler of a timed run, which stops the workers once
+ * params.duration is over. Does nothing if the run is not timed.
+ * @param sampler The sampler.
+ * @param repeat The repeat about to run.
+ */
+void BenchmarkRunner::StartSampler(ThroughputSampler &sampler,
+                                   unsigned repeat) {
+  if (RunsForDuration())
+    sampler.Start(repeat, params.duration,
+                  std::chrono::milliseconds(params.sampleInterval));
+}
+
+/**
+ * Waits for the sampler of a timed run and keeps its samples. Does nothing if
+ * the run is not timed.
+ * @param sampler The sampler.
+ * @param timeSeries Where to add the samples.
+ */
+void BenchmarkRunner::JoinSampler(ThroughputSampler &sampler,
+                                  std::vector<ThroughputSample> &timeSeries) {
+  if (not RunsForDuration())
+    return;
+  sampler.Join();
+  timeSeries.insert(timeSeries.end(), sampler.samples.begin(),
+                    sampler.samples.end());
+}
+
+/**
+ * Adds the results of one thread count, once all its repeats have run. The
+ * stats of the workers are merged into the first one's.
+ * @param results Where to add them.
+ * @param runTime The sum of the runtimes of the repeats.
+ * @param repeats The repeats, which are moved into the results.
+ * @param memory The memory use over the repeats.
+ * @param stats The stats of the workers.
+ * @param timeSeries The throughput samples of the repeats, moved into the
+ *  results if the run is timed, or nullptr if the benchmark keeps none.
+ * @param perOp Whether the workers recorded latencies and hardware counters.
+ */
+void BenchmarkRunner::CollectResults(
+    RunnerResults &results, double runTime, std::vector<RepeatSample> &repeats,
+    const MemoryUsage &memory, std::vector<WorkerStats> &stats,
+    std::vector<ThroughputSample> *timeSeries, bool perOp) const {
+  results.runTimes.push_back(runTime / params.repeat);
+  results.repeats.push_back(std::move(repeats));
+  results.memory.push_back(memory);
+  for (size_t t = 1; t < stats.size(); ++t)
+    stats[0].Merge(stats[t]);
+  if (perOp and params.latencies)
+    results.latencies.push_back(stats[0].latencies);
+  if (perOp and params.perfCounters)
+    results.perfCounts.push_back(stats[0].perf);
+  if (LockStats::kEnabled)
+    results.locks.push_back(stats[0].locks);
+  if (DefaultListStats::kEnabled)
+    results.lists.push_back(stats[0].lists);
+  if (timeSeries and RunsForDuration())
+    results.timeSeries.push_back(std::move(*timeSeries));
+}
+
+/**
+ * Draws the operation streams of a YCSB workload, each worker drawing its own.
+ * @param workload The workload.
+ * @param nThreads The number of threads of the run.
+ * @return A stream per thread.
+ */
+std::vector<OpStream>
+BenchmarkRunner::MakeYcsbStreams(const YcsbWorkload &workload,
+                                 size_t nThreads) {
+  std::vector<OpStream> streams(nThreads);
+  pool.Run(nThreads, [&](size_t t) {
+    streams[t] = MakeYcsbStream(workload, t, nThreads);
+  });
+  return streams;
+}
+
+/**
+ * Draws the operations of a thread for a YCSB workload.
+ * @param workload The workload.
+ * @param threadId The thread.
+ * @param nThreads The number of threads of the run.
+ * @return The stream.
+ */
+OpStream BenchmarkRunner::MakeYcsbStream(const YcsbWorkload &workload,
+                                         size_t threadId,
+                                         size_t nThreads) const {
+  auto genRand = std::bind(std::uniform_real_distribution<float>(),
+                           std::default_random_engine(kSeed * threadId));
+  OpStream stream;
+  auto n = StreamLength(GetChunkParams(threadId, nThreads));
+  stream.entries.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    auto op = workload.ChooseOp(genRand());
+    stream.entries.push_back(
+        OpStream::Pack(static_cast<unsigned>(op), genRand()));
+  }
+  return stream;
+}
+
+/**
+ * Chooses the key of a YCSB read, update, scan or read-modify-write.
+ * @param workload The workload.
+ * @param newest The last key inserted so far.
+ * @param u A number drawn uniformly from [0, 1).
+ * @return The key.
+ */
+int BenchmarkRunner::ChooseYcsbKey(const YcsbWorkload &workload, size_t newest,
+                                   double u) const noexcept {
+  auto rank = zipf(u);
+  if (workload.distribution == Distribution::Latest)
+    return rank <= newest ? newest - rank : 0;
+  return fnvHash64(rank) % numbers.size();
+}
@@ -6,15 +6,34 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <ostream>
 #include <random>
 #include <thread>
+#include <utility>
+#include <vector>
 
+#include "allocator.h"
+#include "arrival_schedule.h"
+#include "bucket_array.h"
+#include "key_distribution.h"
+#include "latency_histogram.h"
+#include "list_stats.h"
+#include "lock_profile.h"
+#include "memory_accounting.h"
+#include "op_stream.h"
+#include "perf_counters.h"
+#include "throughput_sampler.h"
+#include "topology.h"
+#include "trace.h"
 #include "util.h"
+#include "worker_pool.h"
+#include "ycsb.h"
 
 enum class ScalingMode { Problem, Memory };
 
@@ -34,6 +53,10 @@ struct RunnerParams {
   float lookups{0.0};
   ScalingMode scalingMode{ScalingMode::Problem};
   bool withAffinity{false};
+  // Where to pin the threads. -a alone pins them with Placement::Linear.
+  Placement placement{Placement::None};
+  // The CPU each thread was pinned to, or -1, filled in by the runner.
+  std::vector<int> cpus;
   float preload{0.0};
   static const unsigned nCores;
   unsigned minThreads{1};
@@ -41,17 +64,58 @@ struct RunnerParams {
   float mapLoadFactor{1};
   std::string outDirectory{""};
   std::string structs;
+  // The --type names, separated by commas, or empty for all of them.
+  std::string types;
   unsigned repeat{1};
+  bool latencies{true};
+  bool perfCounters{true};
+  double duration{0.0};
+  unsigned sampleInterval{50};
+  DistributionParams distribution;
+  // The operations per second of all threads together in open-loop runs, or
+  // 0 to run closed-loop, each thread going on as soon as it can.
+  double rate{0.0};
+  Arrivals arrivals{Arrivals::Poisson};
+  // Where the memory of the structures comes from, for the whole process.
+  Allocator allocator{Allocator::Glibc};
 
   RunnerParams() = default;
   RunnerParams(size_t n, float inserts, float removals, float lookups)
       : n(n), inserts(inserts), removals(removals), lookups(lookups) {}
 };
 
+/**
+ * How long one repeat took and how many operations it did.
+ */
+struct RepeatSample {
+  double runTime;
+  uint64_t ops;
+};
+
 struct RunnerResults {
   std::string name;
   RunnerParams params;
+  // The mean runtime of each thread count.
   std::vector<double> runTimes;
+  // Every repeat of each thread count.
+  std::vector<std::vector<RepeatSample>> repeats;
+  // The latencies of each thread count, merged over threads and repeats. Left
+  // empty by benchmarks that do not record any.
+  std::vector<OpLatencies> latencies;
+  // The hardware counters of each thread count, summed over threads and
+  // repeats, unless they are off.
+  std::vector<PerfCounts> perfCounts;
+  // The memory use of each thread count.
+  std::vector<MemoryUsage> memory;
+  // The lock profile of each thread count, summed over threads and repeats,
+  // only in builds with lock profiling.
+  std::vector<LockStats> locks;
+  // The list statistics of each thread count, summed over threads and
+  // repeats, only in builds with list statistics.
+  std::vector<ListCounters> lists;
+  // The throughput samples of each thread count over all repeats, only for
+  // timed runs.
+  std::vector<std::vector<ThroughputSample>> timeSeries;
 
   RunnerResults() = default;
   RunnerResults(const std::string &name, const RunnerParams &params)
@@ -60,31 +124,90 @@ struct RunnerResults {
 
 std::ostream &operator<<(std::ostream &os, const RunnerResults &results);
 
+/**
+ * What a worker thread measures over its runs, and when its operations are
+ * due in open-loop runs.
+ */
+struct WorkerStats {
+  uint64_t ops{0};
+  OpLatencies latencies;
+  PerfCounts perf;
+  LockStats locks;
+  ListCounters lists;
+  ArrivalSchedule arrivals;
+
+  void Merge(const WorkerStats &other) noexcept {
+    ops += other.ops;
+    latencies.Merge(other.latencies);
+    perf.Merge(other.perf);
+    locks.Merge(other.locks);
+    lists.Merge(other.lists);
+  }
+};
+
 struct BenchmarkRunner {
   static constexpr size_t kSeed = 117;
   static constexpr float kTolerance = 0.01;
   RunnerParams params;
   std::vector<int> numbers;
+  ZipfGenerator zipf;
+  WorkerPool pool;
+  // The allocation counts at the start and the end of the last repeat.
+  MemorySnapshot runStart;
+  MemorySnapshot runEnd;
 
   void PrepareNumbers();
   ChunkParams GetChunkParams(size_t threadId, size_t nThreads) const noexcept;
+  bool IsSkewed() const noexcept {
+    return params.distribution.type != Distribution::Uniform;
+  }
+  int ChooseKey(const ChunkParams &cp, size_t first, double u) const noexcept;
+  size_t StreamLength(const ChunkParams &cp) const noexcept;
+  std::vector<OpStream> MakeOpStreams(size_t nThreads);
+  OpStream MakeOpStream(size_t threadId, size_t nThreads) const;
 
   BenchmarkRunner(const RunnerParams &params);
 
+  template <typename TFunc>
+  void Timed(WorkerStats &stats, LatencyHistogram &hist, TFunc fn);
+  void StartArrivals(ArrivalSchedule &arrivals, size_t threadId,
+                     size_t nThreads);
+
+  bool RunsForDuration() const noexcept { return params.duration > 0.0; }
+  double TimeRepeat(size_t nThreads, std::vector<WorkerStats> &stats,
+                    std::vector<RepeatSample> &repeats,
+                    const WorkerPool::Task &task);
+  MemorySnapshot StartMemory() noexcept;
+  void RecordMemory(MemoryUsage &memory, const MemorySnapshot &built,
+                    size_t elements, const std::vector<RepeatSample> &repeats,
+                    size_t otherBytes = 0) const noexcept;
+  static size_t
+  BufferBytes(const std::vector<std::vector<int>> &buffers) noexcept;
+  void StartSampler(ThroughputSampler &sampler, unsigned repeat);
+  void JoinSampler(ThroughputSampler &sampler,
+                   std::vector<ThroughputSample> &timeSeries);
+  void CollectResults(RunnerResults &results, double runTime,
+                      std::vector<RepeatSample> &repeats,
+                      const MemoryUsage &memory,
+                      std::vector<WorkerStats> &stats,
+                      std::vector<ThroughputSample> *timeSeries = nullptr,
+                      bool perOp = true) const;
+
   // List functions
 
   template <typename TList>
   std::vector<std::vector<int>> PreloadList(TList &lst, size_t nThreads);
 
-  template <template <typename> class TList>
+  template <template <typename...> class TList>
   RunnerResults RunListSingle(const std::string &listName);
 
-  template <template <typename> class TList>
+  template <template <typename...> class TList>
   RunnerResults RunList(const std::string &listName);
 
   template <typename TList>
   void RunList(size_t threadId, size_t nThreads, TList &lst,
-               std::vector<int> &buf);
+               std::vector<int> &buf, OpStream &stream, WorkerStats &stats,
+               ThroughputSampler *sampler);
 
   // Hashmap functions
 
@@ -99,15 +222,115 @@ struct BenchmarkRunner {
 
   template <typename TMap>
   void RunMap(size_t threadId, size_t nThreads, TMap &hashMap,
-              std::vector<int> &buf);
+              std::vector<int> &buf, OpStream &stream, WorkerStats &stats,
+              ThroughputSampler *sampler);
+
+  template <template <typename, typename> class TMap>
+  RunnerResults RunMapAdjacentBuckets(const std::string &mapName,
+                                      BucketLayout layout);
+
+  template <typename TMap>
+  void RunMapAdjacentBuckets(size_t threadId, size_t nThreads, TMap &hashMap,
+                             WorkerStats &stats);
+
+  // Bulk build functions
+
+  template <template <typename...> class TList>
+  RunnerResults RunListBuild(const std::string &listName, bool single = false);
+
+  template <typename TList>
+  void BuildList(size_t threadId, size_t nThreads, TList &lst,
+                 WorkerStats &stats);
+
+  template <template <typename, typename> class TMap>
+  RunnerResults RunMapBuild(const std::string &mapName, bool single = false);
+
+  template <typename TMap>
+  void BuildMap(size_t threadId, size_t nThreads, TMap &hashMap,
+                WorkerStats &stats);
+
+  // YCSB functions
+
+  template <template <typename, typename> class TMap>
+  RunnerResults RunYcsb(const std::string &mapName,
+                        const YcsbWorkload &workload, bool single = false);
+
+  template <typename TMap>
+  void RunYcsb(size_t threadId, size_t nThreads, TMap &hashMap,
+               const YcsbWorkload &workload, std::atomic<size_t> &nextKey,
+               OpStream &stream, WorkerStats &stats,
+               ThroughputSampler *sampler);
+
+  std::vector<OpStream> MakeYcsbStreams(const YcsbWorkload &workload,
+                                        size_t nThreads);
+  OpStream MakeYcsbStream(const YcsbWorkload &workload, size_t threadId,
+                          size_t nThreads) const;
+  int ChooseYcsbKey(const YcsbWorkload &workload, size_t newest,
+                    double u) const noexcept;
+
+  // Trace replay functions
+
+  template <template <typename...> class TList>
+  RunnerResults RunListReplay(const std::string &listName,
+                              const TraceFile &trace, bool single = false);
+
+  template <typename TList>
+  void ReplayList(size_t threadId, size_t nThreads, TList &lst,
+                  const TraceFile &trace, WorkerStats &stats,
+                  ThroughputSampler *sampler);
+
+  template <template <typename, typename> class TMap>
+  RunnerResults RunMapReplay(const std::string &mapName,
+                             const TraceFile &trace, bool single = false);
+
+  template <typename TMap>
+  void ReplayMap(size_t threadId, size_t nThreads, TMap &hashMap,
+                 const TraceFile &trace, WorkerStats &stats,
+                 ThroughputSampler *sampler);
 };
 
+/**
+ * Runs an operation, recording how long it took unless latencies are off. In
+ * open-loop runs the operation waits until it is due first, and its latency
+ * is counted from then.
+ * @param stats The stats of the worker.
+ * @param hist The histogram to record the latency in.
+ * @param fn The operation.
+ */
+template <typename TFunc>
+void BenchmarkRunner::Timed(WorkerStats &stats, LatencyHistogram &hist,
+                            TFunc fn) {
+  if (stats.arrivals.IsOpen()) {
+    auto due = stats.arrivals.Wait();
+    fn();
+    if (params.latencies)
+      hist.Record(CycleClock::Now() - due);
+    return;
+  }
+  if (not params.latencies) {
+    fn();
+    return;
+  }
+  auto ticksStart = CycleClock::Now();
+  fn();
+  hist.Record(CycleClock::Now() - ticksStart);
+}
+
+/**
+ * Preloads a list with the first part of the chunk of each worker. The
+ * workers of the timed run do it in parallel, each its own chunk, so the
+ * nodes and the buffers come from the allocator caches and the memory of the
+ * threads that go on to use them.
+ * @param lst The list to preload.
+ * @param nThreads The number of workers of the run.
+ * @return The buffer of each worker, holding the numbers it preloaded first.
+ */
 template <typename TList>
 std::vector<std::vector<int>> BenchmarkRunner::PreloadList(TList &lst,
                                                            size_t nThreads) {
-  std::vector<std::vector<int>> buffers;
-  for (size_t i = 0; i < nThreads; ++i) {
-    auto cp = GetChunkParams(i, nThreads);
+  std::vector<std::vector<int>> buffers(nThreads);
+  pool.Run(nThreads, [&](size_t t) {
+    auto cp = GetChunkParams(t, nThreads);
     std::vector<int> buf(cp.chunk);
     size_t k = 0;
     auto last = std::min(cp.startNext, cp.start + cp.nPreload);
@@ -116,108 +339,163 @@ std::vector<std::vector<int>> BenchmarkRunner::PreloadList(TList &lst,
       lst.Insert(num);
       buf[k++] = num;
     }
-    buffers.emplace_back(std::move(buf));
-  }
+    buffers[t] = std::move(buf);
+  });
   return buffers;
 }
 
-template <template <typename> class TList>
+template <template <typename...> class TList>
 RunnerResults BenchmarkRunner::RunListSingle(const std::string &listName) {
-  using namespace std::chrono;
   using ListType = TList<int>;
   double runTime = 0.0;
+  std::vector<WorkerStats> stats(1);
+  std::vector<RepeatSample> repeats;
+  MemoryUsage memory;
+  std::vector<ThroughputSample> timeSeries;
+  auto streams = MakeOpStreams(1);
   for (unsigned r = 0; r < params.repeat; ++r) {
+    ThroughputSampler sampler(1);
+    auto built = StartMemory();
     ListType lst;
     auto buffers = PreloadList(lst, 1);
     assert(buffers.size() == 1);
-    auto timeStart = steady_clock::now();
-    RunList(0, 1, lst, buffers[0]);
-    auto dur = steady_clock::now() - timeStart;
-    runTime += duration_cast<duration<double>>(dur).count();
+    auto samplerPtr = RunsForDuration() ? &sampler : nullptr;
+    StartSampler(sampler, r);
+    runTime += TimeRepeat(1, stats, repeats, [&](size_t) {
+      RunList(0, 1, lst, buffers[0], streams[0], stats[0], samplerPtr);
+    });
+    JoinSampler(sampler, timeSeries);
+    RecordMemory(memory, built, lst.Size(), repeats, BufferBytes(buffers));
   }
   RunnerResults results(listName, params);
-  results.runTimes.push_back(runTime / params.repeat);
+  CollectResults(results, runTime, repeats, memory, stats, &timeSeries);
   return results;
 }
 
-template <template <typename> class TList>
+template <template <typename...> class TList>
 RunnerResults BenchmarkRunner::RunList(const std::string &listName) {
-  using namespace std::chrono;
   using ListType = TList<int>;
   RunnerResults results(listName, params);
-  std::thread threads[params.maxThreads];
   for (size_t c = params.minThreads; c <= params.maxThreads; ++c) {
     double runTime = 0.0;
+    std::vector<WorkerStats> stats(c);
+    std::vector<RepeatSample> repeats;
+    MemoryUsage memory;
+    std::vector<ThroughputSample> timeSeries;
+    auto streams = MakeOpStreams(c);
     for (unsigned r = 0; r < params.repeat; ++r) {
+      ThroughputSampler sampler(c);
+      auto built = StartMemory();
       ListType lst;
       auto buffers = PreloadList(lst, c);
-      auto timeStart = steady_clock::now();
-      for (size_t t = 1; t < c; ++t) {
-        threads[t] = std::thread(&BenchmarkRunner::RunList<ListType>, this, t,
-                                 c, std::ref(lst), std::ref(buffers[t]));
-      }
-      RunList(0, c, lst, buffers[0]);
-      for (size_t t = 1; t < c; ++t)
-        threads[t].join();
-      auto dur = steady_clock::now() - timeStart;
-      runTime += duration_cast<duration<double>>(dur).count();
+      auto samplerPtr = RunsForDuration() ? &sampler : nullptr;
+      StartSampler(sampler, r);
+      runTime += TimeRepeat(c, stats, repeats, [&](size_t t) {
+        RunList(t, c, lst, buffers[t], streams[t], stats[t], samplerPtr);
+      });
+      JoinSampler(sampler, timeSeries);
+      RecordMemory(memory, built, lst.Size(), repeats, BufferBytes(buffers));
     }
-    results.runTimes.push_back(runTime / params.repeat);
+    CollectResults(results, runTime, repeats, memory, stats, &timeSeries);
   }
   return results;
 }
 
 template <typename TList>
 void BenchmarkRunner::RunList(size_t threadId, size_t nThreads, TList &lst,
-                              std::vector<int> &buf) {
-  if (params.withAffinity)
-    setCoreAffinity(threadId);
-
-  const auto rThreshold = params.inserts + params.removals;
+                              std::vector<int> &buf, OpStream &stream,
+                              WorkerStats &stats, ThroughputSampler *sampler) {
   auto cp = GetChunkParams(threadId, nThreads);
+  // buf holds the numbers in the list first, and then the ones removed from
+  // it, which timed runs insert again once they run out of new numbers.
   size_t nCount = cp.nPreload;
-  auto genRand = std::bind(std::uniform_real_distribution<float>(),
-                           std::default_random_engine(kSeed * threadId));
+  size_t nUsed = nCount;
   auto first = cp.start + cp.nPreload;
-  for (size_t ops = 0; ops < cp.chunk;) {
-    auto r = genRand();
-    if (r < params.inserts and first < cp.startNext) {
-      auto num = numbers[first++];
-      buf[nCount++] = num;
+  auto counter = sampler ? &sampler->counters[threadId].ops : nullptr;
+  const bool skewed = IsSkewed();
+  PerfCounterGroup perf(params.perfCounters);
+  perf.Start();
+  pool.StartClock(threadId);
+  StartArrivals(stats.arrivals, threadId, nThreads);
+  size_t ops = 0;
+  stream.pos = 0;
+  while (sampler ? not sampler->Stopped() : ops < cp.chunk) {
+    auto entry = stream.Next();
+    auto op = static_cast<MixOp>(OpStream::Op(entry));
+    bool insert = op == MixOp::Insert or op == MixOp::InsertUnique;
+    if (insert and
+        (first < cp.startNext or (sampler and (skewed or nCount < nUsed)))) {
+      int num;
+      bool drawn = false;
+      if (first < cp.startNext) {
+        num = numbers[first++];
+        buf[nUsed++] = buf[nCount];
+        buf[nCount++] = num;
+      } else if (skewed) {
+        num = ChooseKey(cp, first, OpStream::Fraction(entry));
+        drawn = true;
+      } else {
+        num = buf[nCount++];
+      }
       ++ops;
 
-      // Take turns inserting via Insert and InsertUnique
-      if (genRand() < 0.5)
-        lst.Insert(num);
+      // Take turns inserting via Insert and InsertUnique. Keys drawn from the
+      // distribution may be in the list already, so they are always unique.
+      if (op == MixOp::Insert and not drawn)
+        Timed(stats, stats.latencies.insert, [&] { lst.Insert(num); });
       else
-        lst.InsertUnique(num);
-    } else if (r < rThreshold) {
-      if (nCount) {
-        size_t index = genRand() * (nCount - 1);
-        lst.Remove(buf[index]);
-        buf[index] = buf[nCount--];
+        Timed(stats, stats.latencies.insert, [&] { lst.InsertUnique(num); });
+    } else if (op != MixOp::Lookup) {
+      // Inserts with nothing left to insert turn into removes.
+      if (skewed) {
+        // The key may not be in the list anymore, or belong to another thread.
+        auto key = ChooseKey(cp, first, OpStream::Fraction(entry));
+        Timed(stats, stats.latencies.remove, [&] { lst.Remove(key); });
+        ++ops;
+      } else if (nCount) {
+        size_t index = OpStream::Index(entry, nCount - 1);
+        Timed(stats, stats.latencies.remove, [&] { lst.Remove(buf[index]); });
+        std::swap(buf[index], buf[--nCount]);
         ++ops;
       }
     } else {
-      if (nCount) {
+      if (skewed) {
+        auto key = ChooseKey(cp, first, OpStream::Fraction(entry));
+        Timed(stats, stats.latencies.lookup, [&] { lst.Contains(key); });
+        ++ops;
+      } else if (nCount) {
         // Generate an index at random
-        size_t index = genRand() * (nCount - 1);
-        lst.Contains(buf[index]);
+        size_t index = OpStream::Index(entry, nCount - 1);
+        Timed(stats, stats.latencies.lookup, [&] { lst.Contains(buf[index]); });
         ++ops;
       }
     }
+    if (counter)
+      counter->store(ops, std::memory_order_relaxed);
     // Make sure we don't get stuck in an infinite loop.
-    if (first >= cp.startNext and nCount == 0 and ops < cp.chunk)
+    if (not sampler and first >= cp.startNext and nCount == 0 and
+        ops < cp.chunk)
       break;
   }
+  pool.StopClock(threadId);
+  auto counts = perf.Stop();
+  counts.ops = ops;
+  stats.perf.Merge(counts);
+  stats.ops += ops;
 }
 
+/**
+ * Preloads a map in parallel, in the same way as PreloadList().
+ * @param hashMap The map to preload.
+ * @param nThreads The number of workers of the run.
+ * @return The buffer of each worker, holding the keys it preloaded first.
+ */
 template <typename TMap>
 std::vector<std::vector<int>> BenchmarkRunner::PreloadMap(TMap &hashMap,
                                                           size_t nThreads) {
-  std::vector<std::vector<int>> buffers;
-  for (size_t i = 0; i < nThreads; ++i) {
-    auto cp = GetChunkParams(i, nThreads);
+  std::vector<std::vector<int>> buffers(nThreads);
+  pool.Run(nThreads, [&](size_t t) {
+    auto cp = GetChunkParams(t, nThreads);
     std::vector<int> buf(cp.chunk);
     size_t k = 0;
     auto last = std::min(cp.startNext, cp.start + cp.nPreload);
@@ -226,95 +504,594 @@ std::vector<std::vector<int>> BenchmarkRunner::PreloadMap(TMap &hashMap,
       hashMap.Insert(num, num);
       buf[k++] = num;
     }
-    buffers.emplace_back(std::move(buf));
-  }
+    buffers[t] = std::move(buf);
+  });
   return buffers;
 }
 
 template <template <typename, typename> class TMap>
 RunnerResults BenchmarkRunner::RunMapSingle(const std::string &mapName) {
-  using namespace std::chrono;
   using MapType = TMap<int, int>;
   double runTime = 0.0;
+  std::vector<WorkerStats> stats(1);
+  std::vector<RepeatSample> repeats;
+  MemoryUsage memory;
+  std::vector<ThroughputSample> timeSeries;
+  auto streams = MakeOpStreams(1);
   for (unsigned r = 0; r < params.repeat; ++r) {
+    ThroughputSampler sampler(1);
+    auto built = StartMemory();
     MapType hashMap((int)(params.n / params.mapLoadFactor));
     auto buffers = PreloadMap(hashMap, 1);
     assert(buffers.size() == 1);
-    auto timeStart = steady_clock::now();
-    RunMap(0, 1, hashMap, buffers[0]);
-    auto dur = steady_clock::now() - timeStart;
-    runTime += duration_cast<duration<double>>(dur).count();
+    auto samplerPtr = RunsForDuration() ? &sampler : nullptr;
+    StartSampler(sampler, r);
+    runTime += TimeRepeat(1, stats, repeats, [&](size_t) {
+      RunMap(0, 1, hashMap, buffers[0], streams[0], stats[0], samplerPtr);
+    });
+    JoinSampler(sampler, timeSeries);
+    RecordMemory(memory, built, hashMap.Size(), repeats,
+                 BufferBytes(buffers));
   }
   RunnerResults results(mapName, params);
-  results.runTimes.push_back(runTime / params.repeat);
+  CollectResults(results, runTime, repeats, memory, stats, &timeSeries);
   return results;
 }
 
 template <template <typename, typename> class TMap>
 RunnerResults BenchmarkRunner::RunMap(const std::string &mapName) {
-  using namespace std::chrono;
   using MapType = TMap<int, int>;
   RunnerResults results(mapName, params);
-  std::thread threads[params.maxThreads];
   for (size_t c = params.minThreads; c <= params.maxThreads; ++c) {
     double runTime = 0.0;
+    std::vector<WorkerStats> stats(c);
+    std::vector<RepeatSample> repeats;
+    MemoryUsage memory;
+    std::vector<ThroughputSample> timeSeries;
+    auto streams = MakeOpStreams(c);
     for (unsigned r = 0; r < params.repeat; ++r) {
+      ThroughputSampler sampler(c);
+      auto built = StartMemory();
       MapType hashMap(params.scalingMode == ScalingMode::Problem
                           ? (int)(params.n / params.mapLoadFactor)
                           : (int)((params.n * c) / params.mapLoadFactor));
       auto buffers = PreloadMap(hashMap, c);
-      auto timeStart = steady_clock::now();
-      for (size_t t = 1; t < c; ++t) {
-        threads[t] = std::thread(&BenchmarkRunner::RunMap<MapType>, this, t, c,
-                                 std::ref(hashMap), std::ref(buffers[t]));
-      }
-      RunMap(0, c, hashMap, buffers[0]);
-      for (size_t t = 1; t < c; ++t)
-        threads[t].join();
-      auto dur = steady_clock::now() - timeStart;
-      runTime += duration_cast<duration<double>>(dur).count();
+      auto samplerPtr = RunsForDuration() ? &sampler : nullptr;
+      StartSampler(sampler, r);
+      runTime += TimeRepeat(c, stats, repeats, [&](size_t t) {
+        RunMap(t, c, hashMap, buffers[t], streams[t], stats[t], samplerPtr);
+      });
+      JoinSampler(sampler, timeSeries);
+      RecordMemory(memory, built, hashMap.Size(), repeats,
+                   BufferBytes(buffers));
     }
-    results.runTimes.push_back(runTime / params.repeat);
+    CollectResults(results, runTime, repeats, memory, stats, &timeSeries);
   }
   return results;
 }
 
 template <typename TMap>
 void BenchmarkRunner::RunMap(size_t threadId, size_t nThreads, TMap &hashMap,
-                             std::vector<int> &buf) {
-  if (params.withAffinity)
-    setCoreAffinity(threadId);
-
-  const auto rThreshold = params.inserts + params.removals;
+                             std::vector<int> &buf, OpStream &stream,
+                             WorkerStats &stats, ThroughputSampler *sampler) {
   auto cp = GetChunkParams(threadId, nThreads);
+  // buf holds the keys in the map first, and then the ones removed from it,
+  // which timed runs insert again once they run out of new keys.
   size_t nCount = cp.nPreload;
-  auto genRand = std::bind(std::uniform_real_distribution<float>(),
-                           std::default_random_engine(kSeed * threadId));
+  size_t nUsed = nCount;
   auto first = cp.start + cp.nPreload;
-  for (size_t ops = 0; ops < cp.chunk;) {
-    auto r = genRand();
-    if (r < params.inserts and first < cp.startNext) {
-      auto num = numbers[first++];
-      buf[nCount++] = num;
-      hashMap.Insert(num, num);
+  auto counter = sampler ? &sampler->counters[threadId].ops : nullptr;
+  const bool skewed = IsSkewed();
+  PerfCounterGroup perf(params.perfCounters);
+  perf.Start();
+  pool.StartClock(threadId);
+  StartArrivals(stats.arrivals, threadId, nThreads);
+  size_t ops = 0;
+  stream.pos = 0;
+  while (sampler ? not sampler->Stopped() : ops < cp.chunk) {
+    auto entry = stream.Next();
+    auto op = static_cast<MixOp>(OpStream::Op(entry));
+    bool insert = op == MixOp::Insert or op == MixOp::InsertUnique;
+    if (insert and
+        (first < cp.startNext or (sampler and (skewed or nCount < nUsed)))) {
+      int num;
+      if (first < cp.startNext) {
+        num = numbers[first++];
+        buf[nUsed++] = buf[nCount];
+        buf[nCount++] = num;
+      } else if (skewed) {
+        num = ChooseKey(cp, first, OpStream::Fraction(entry));
+      } else {
+        num = buf[nCount++];
+      }
+      Timed(stats, stats.latencies.insert, [&] { hashMap.Insert(num, num); });
       ++ops;
-    } else if (r < rThreshold) {
-      if (nCount) {
-        size_t index = genRand() * (nCount - 1);
-        hashMap.Remove(buf[index]);
-        buf[index] = buf[nCount--];
+    } else if (op != MixOp::Lookup) {
+      // Inserts with nothing left to insert turn into removes.
+      if (skewed) {
+        // The key may not be in the map anymore, or belong to another thread.
+        auto key = ChooseKey(cp, first, OpStream::Fraction(entry));
+        Timed(stats, stats.latencies.remove, [&] { hashMap.Remove(key); });
+        ++ops;
+      } else if (nCount) {
+        size_t index = OpStream::Index(entry, nCount - 1);
+        Timed(stats, stats.latencies.remove,
+              [&] { hashMap.Remove(buf[index]); });
+        std::swap(buf[index], buf[--nCount]);
         ++ops;
       }
     } else {
-      if (nCount) {
+      if (skewed) {
+        auto key = ChooseKey(cp, first, OpStream::Fraction(entry));
+        Timed(stats, stats.latencies.lookup, [&] { hashMap.Has(key); });
+        ++ops;
+      } else if (nCount) {
         // Generate an index at random
-        size_t index = genRand() * (nCount - 1);
-        hashMap.Has(buf[index]);
+        size_t index = OpStream::Index(entry, nCount - 1);
+        Timed(stats, stats.latencies.lookup, [&] { hashMap.Has(buf[index]); });
         ++ops;
       }
     }
+    if (counter)
+      counter->store(ops, std::memory_order_relaxed);
     // Make sure we don't get stuck in an infinite loop.
-    if (first >= cp.startNext and nCount == 0 and ops < cp.chunk)
+    if (not sampler and first >= cp.startNext and nCount == 0 and
+        ops < cp.chunk)
       break;
   }
+  pool.StopClock(threadId);
+  auto counts = perf.Stop();
+  counts.ops = ops;
+  stats.perf.Merge(counts);
+  stats.ops += ops;
+}
+
+/**
+ * Runs the false sharing benchmark on a HashMap with one bucket per thread.
+ * Each thread only touches its own bucket, so nothing is shared between the
+ * threads except the cache lines that adjacent buckets have in common, and the
+ * difference between the packed and padded layouts is the cost of false
+ * sharing.
+ * @param mapName The name to report the results under.
+ * @param layout How the buckets are laid out in memory.
+ */
+template <template <typename, typename> class TMap>
+RunnerResults
+BenchmarkRunner::RunMapAdjacentBuckets(const std::string &mapName,
+                                       BucketLayout layout) {
+  using MapType = TMap<int, int>;
+  RunnerResults results(mapName, params);
+  for (size_t c = params.minThreads; c <= params.maxThreads; ++c) {
+    double runTime = 0.0;
+    std::vector<WorkerStats> stats(c);
+    std::vector<RepeatSample> repeats;
+    MemoryUsage memory;
+    for (unsigned r = 0; r < params.repeat; ++r) {
+      auto built = StartMemory();
+      MapType hashMap(c, layout);
+      runTime += TimeRepeat(c, stats, repeats, [&](size_t t) {
+        RunMapAdjacentBuckets(t, c, hashMap, stats[t]);
+      });
+      // The workers go around the map's count of its elements.
+      RecordMemory(memory, built, 0, repeats);
+    }
+    // The workers record no latencies or hardware counters.
+    CollectResults(results, runTime, repeats, memory, stats, nullptr, false);
+  }
+  return results;
+}
+
+template <typename TMap>
+void BenchmarkRunner::RunMapAdjacentBuckets(size_t threadId, size_t nThreads,
+                                            TMap &hashMap, WorkerStats &stats) {
+  using Element = typename TMap::Element;
+  // The bucket is used directly, since going through the map would also hit
+  // its shared size counter.
+  auto &bucket = hashMap.buckets[threadId];
+  auto cp = GetChunkParams(threadId, nThreads);
+  for (size_t ops = 0; ops < cp.chunk; ++ops) {
+    int key = static_cast<int>(ops / 2);
+    if (ops % 2 == 0)
+      bucket.InsertUnique(Element(key, key));
+    else
+      bucket.Remove(Element(key));
+  }
+  stats.ops += cp.chunk;
+}
+
+/**
+ * Times building a list from empty: the workers insert every number of their
+ * chunks at once, with no preloading and no other operations.
+ * @param listName The name of the list.
+ * @param single Whether the list is single threaded, so only runs on one.
+ * @return The results, one per thread count.
+ */
+template <template <typename...> class TList>
+RunnerResults BenchmarkRunner::RunListBuild(const std::string &listName,
+                                            bool single) {
+  using ListType = TList<int>;
+  RunnerResults results(listName + "/build", params);
+  const size_t minThreads = single ? 1 : params.minThreads;
+  const size_t maxThreads = single ? 1 : params.maxThreads;
+  for (size_t c = minThreads; c <= maxThreads; ++c) {
+    double runTime = 0.0;
+    std::vector<WorkerStats> stats(c);
+    std::vector<RepeatSample> repeats;
+    MemoryUsage memory;
+    for (unsigned r = 0; r < params.repeat; ++r) {
+      auto built = StartMemory();
+      ListType lst;
+      runTime += TimeRepeat(c, stats, repeats,
+                            [&](size_t t) { BuildList(t, c, lst, stats[t]); });
+      RecordMemory(memory, built, lst.Size(), repeats);
+    }
+    CollectResults(results, runTime, repeats, memory, stats);
+  }
+  return results;
+}
+
+/**
+ * Inserts every number of the chunk of a worker at the front of a list.
+ * @param threadId The worker.
+ * @param nThreads The number of workers of the run.
+ * @param lst The list being built.
+ * @param stats The stats of the worker.
+ */
+template <typename TList>
+void BenchmarkRunner::BuildList(size_t threadId, size_t nThreads, TList &lst,
+                                WorkerStats &stats) {
+  auto cp = GetChunkParams(threadId, nThreads);
+  PerfCounterGroup perf(params.perfCounters);
+  perf.Start();
+  pool.StartClock(threadId);
+  for (auto j = cp.start; j < cp.startNext; ++j) {
+    auto num = numbers[j];
+    Timed(stats, stats.latencies.insert, [&] { lst.Insert(num); });
+  }
+  pool.StopClock(threadId);
+  auto counts = perf.Stop();
+  counts.ops = cp.chunk;
+  stats.perf.Merge(counts);
+  stats.ops += cp.chunk;
+}
+
+/**
+ * Times building a map from empty, in the same way as RunListBuild().
+ * @param mapName The name of the map.
+ * @param single Whether the map is single threaded, so only runs on one.
+ * @return The results, one per thread count.
+ */
+template <template <typename, typename> class TMap>
+RunnerResults BenchmarkRunner::RunMapBuild(const std::string &mapName,
+                                           bool single) {
+  using MapType = TMap<int, int>;
+  RunnerResults results(mapName + "/build", params);
+  const size_t minThreads = single ? 1 : params.minThreads;
+  const size_t maxThreads = single ? 1 : params.maxThreads;
+  for (size_t c = minThreads; c <= maxThreads; ++c) {
+    double runTime = 0.0;
+    std::vector<WorkerStats> stats(c);
+    std::vector<RepeatSample> repeats;
+    MemoryUsage memory;
+    for (unsigned r = 0; r < params.repeat; ++r) {
+      auto built = StartMemory();
+      MapType hashMap(params.scalingMode == ScalingMode::Problem
+                          ? (int)(params.n / params.mapLoadFactor)
+                          : (int)((params.n * c) / params.mapLoadFactor));
+      runTime += TimeRepeat(c, stats, repeats, [&](size_t t) {
+        BuildMap(t, c, hashMap, stats[t]);
+      });
+      RecordMemory(memory, built, hashMap.Size(), repeats);
+    }
+    CollectResults(results, runTime, repeats, memory, stats);
+  }
+  return results;
+}
+
+/**
+ * Inserts every number of the chunk of a worker into a map, as its own value.
+ * @param threadId The worker.
+ * @param nThreads The number of workers of the run.
+ * @param hashMap The map being built.
+ * @param stats The stats of the worker.
+ */
+template <typename TMap>
+void BenchmarkRunner::BuildMap(size_t threadId, size_t nThreads, TMap &hashMap,
+                               WorkerStats &stats) {
+  auto cp = GetChunkParams(threadId, nThreads);
+  PerfCounterGroup perf(params.perfCounters);
+  perf.Start();
+  pool.StartClock(threadId);
+  for (auto j = cp.start; j < cp.startNext; ++j) {
+    auto num = numbers[j];
+    Timed(stats, stats.latencies.insert, [&] { hashMap.Insert(num, num); });
+  }
+  pool.StopClock(threadId);
+  auto counts = perf.Stop();
+  counts.ops = cp.chunk;
+  stats.perf.Merge(counts);
+  stats.ops += cp.chunk;
+}
+
+/**
+ * Runs a YCSB workload on a map. All the numbers are loaded into the map
+ * before the clock starts, and the inserts of the workload add keys after
+ * them. The preload fraction does not apply.
+ * @param mapName The name to report the results under.
+ * @param workload The workload.
+ * @param single Whether the map is only safe to use from one thread, in which
+ *  case only one thread is run.
+ */
+template <template <typename, typename> class TMap>
+RunnerResults BenchmarkRunner::RunYcsb(const std::string &mapName,
+                                       const YcsbWorkload &workload,
+                                       bool single) {
+  using MapType = TMap<int, int>;
+  if (zipf.n != numbers.size() or zipf.theta != YcsbWorkload::kTheta)
+    zipf = ZipfGenerator(numbers.size(), YcsbWorkload::kTheta);
+  RunnerResults results(mapName + "/ycsb-" + workload.name, params);
+  const size_t minThreads = single ? 1 : params.minThreads;
+  const size_t maxThreads = single ? 1 : params.maxThreads;
+  for (size_t c = minThreads; c <= maxThreads; ++c) {
+    double runTime = 0.0;
+    std::vector<WorkerStats> stats(c);
+    std::vector<RepeatSample> repeats;
+    MemoryUsage memory;
+    std::vector<ThroughputSample> timeSeries;
+    auto streams = MakeYcsbStreams(workload, c);
+    for (unsigned r = 0; r < params.repeat; ++r) {
+      ThroughputSampler sampler(c);
+      auto built = StartMemory();
+      MapType hashMap((int)(numbers.size() / params.mapLoadFactor));
+      // The workers load an even share of the numbers each, as the preloads
+      // of the other runs do.
+      pool.Run(c, [&](size_t t) {
+        auto last = numbers.size() * (t + 1) / c;
+        for (auto j = numbers.size() * t / c; j < last; ++j)
+          hashMap.Insert(numbers[j], numbers[j]);
+      });
+      std::atomic<size_t> nextKey{numbers.size()};
+      auto samplerPtr = RunsForDuration() ? &sampler : nullptr;
+      StartSampler(sampler, r);
+      runTime += TimeRepeat(c, stats, repeats, [&](size_t t) {
+        RunYcsb(t, c, hashMap, workload, nextKey, streams[t], stats[t],
+                samplerPtr);
+      });
+      JoinSampler(sampler, timeSeries);
+      RecordMemory(memory, built, hashMap.Size(), repeats);
+    }
+    CollectResults(results, runTime, repeats, memory, stats, &timeSeries);
+  }
+  return results;
+}
+
+template <typename TMap>
+void BenchmarkRunner::RunYcsb(size_t threadId, size_t nThreads, TMap &hashMap,
+                              const YcsbWorkload &workload,
+                              std::atomic<size_t> &nextKey,
+                              OpStream &stream, WorkerStats &stats,
+                              ThroughputSampler *sampler) {
+  auto cp = GetChunkParams(threadId, nThreads);
+  auto counter = sampler ? &sampler->counters[threadId].ops : nullptr;
+  PerfCounterGroup perf(params.perfCounters);
+  perf.Start();
+  pool.StartClock(threadId);
+  StartArrivals(stats.arrivals, threadId, nThreads);
+  size_t ops = 0;
+  stream.pos = 0;
+  for (; sampler ? not sampler->Stopped() : ops < cp.chunk; ++ops) {
+    auto entry = stream.Next();
+    auto op = static_cast<YcsbOp>(OpStream::Op(entry));
+    if (op == YcsbOp::Insert) {
+      int key = nextKey.fetch_add(1, std::memory_order_relaxed);
+      Timed(stats, stats.latencies.insert, [&] { hashMap.Insert(key, key); });
+    } else {
+      auto newest = nextKey.load(std::memory_order_relaxed) - 1;
+      int key = ChooseYcsbKey(workload, newest, OpStream::Fraction(entry));
+      int value;
+      switch (op) {
+      case YcsbOp::Read:
+        Timed(stats, stats.latencies.lookup, [&] { hashMap.Find(key, value); });
+        break;
+      case YcsbOp::Update:
+        Timed(stats, stats.latencies.update, [&] { hashMap.Update(key, key); });
+        break;
+      case YcsbOp::Scan: {
+        // Hash maps have no order to scan in, so a scan reads the keys that
+        // follow the first one.
+        int length =
+            1 + (entry & OpStream::kFractionMask) % workload.maxScanLength;
+        Timed(stats, stats.latencies.scan, [&] {
+          for (int k = key; k < key + length; ++k)
+            hashMap.Find(k, value);
+        });
+        break;
+      }
+      case YcsbOp::ReadModifyWrite:
+        Timed(stats, stats.latencies.readModifyWrite, [&] {
+          if (hashMap.Find(key, value))
+            hashMap.Update(key, value + 1);
+        });
+        break;
+      default:
+        break;
+      }
+    }
+    if (counter)
+      counter->store(ops + 1, std::memory_order_relaxed);
+  }
+  pool.StopClock(threadId);
+  auto counts = perf.Stop();
+  counts.ops = ops;
+  stats.perf.Merge(counts);
+  stats.ops += ops;
+}
+
+/**
+ * Replays a trace on a list, starting from an empty one. The records are split
+ * into a contiguous part per thread, and the time between records is ignored,
+ * so each thread replays its part as fast as it can. Updates only look the key
+ * up, since lists have no values.
+ * @param listName The name to report the results under.
+ * @param trace The trace.
+ * @param single Whether the list is only safe to use from one thread, in which
+ *  case only one thread is run.
+ */
+template <template <typename...> class TList>
+RunnerResults BenchmarkRunner::RunListReplay(const std::string &listName,
+                                             const TraceFile &trace,
+                                             bool single) {
+  using ListType = TList<int>;
+  RunnerResults results(listName + "/replay", params);
+  const size_t minThreads = single ? 1 : params.minThreads;
+  const size_t maxThreads = single ? 1 : params.maxThreads;
+  for (size_t c = minThreads; c <= maxThreads; ++c) {
+    double runTime = 0.0;
+    std::vector<WorkerStats> stats(c);
+    std::vector<RepeatSample> repeats;
+    MemoryUsage memory;
+    std::vector<ThroughputSample> timeSeries;
+    for (unsigned r = 0; r < params.repeat; ++r) {
+      ThroughputSampler sampler(c);
+      auto built = StartMemory();
+      ListType lst;
+      auto samplerPtr = RunsForDuration() ? &sampler : nullptr;
+      StartSampler(sampler, r);
+      runTime += TimeRepeat(c, stats, repeats, [&](size_t t) {
+        ReplayList(t, c, lst, trace, stats[t], samplerPtr);
+      });
+      JoinSampler(sampler, timeSeries);
+      RecordMemory(memory, built, lst.Size(), repeats);
+    }
+    CollectResults(results, runTime, repeats, memory, stats, &timeSeries);
+  }
+  return results;
+}
+
+template <typename TList>
+void BenchmarkRunner::ReplayList(size_t threadId, size_t nThreads, TList &lst,
+                                 const TraceFile &trace, WorkerStats &stats,
+                                 ThroughputSampler *sampler) {
+  auto slice = trace.Slice(threadId, nThreads);
+  auto counter = sampler ? &sampler->counters[threadId].ops : nullptr;
+  PerfCounterGroup perf(params.perfCounters);
+  perf.Start();
+  pool.StartClock(threadId);
+  StartArrivals(stats.arrivals, threadId, nThreads);
+  size_t ops = 0;
+  // Timed runs start over from the first record of the part.
+  for (size_t i = 0;
+       slice.second and (sampler ? not sampler->Stopped() : ops < slice.second);
+       ++ops) {
+    auto &record = slice.first[i];
+    if (++i == slice.second)
+      i = 0;
+    int key = record.key;
+    switch (record.op) {
+    case TraceOp::Insert:
+      Timed(stats, stats.latencies.insert, [&] { lst.InsertUnique(key); });
+      break;
+    case TraceOp::Remove:
+      Timed(stats, stats.latencies.remove, [&] { lst.Remove(key); });
+      break;
+    case TraceOp::Lookup:
+      Timed(stats, stats.latencies.lookup, [&] { lst.Contains(key); });
+      break;
+    case TraceOp::Update:
+      Timed(stats, stats.latencies.update, [&] { lst.Contains(key); });
+      break;
+    }
+    if (counter)
+      counter->store(ops + 1, std::memory_order_relaxed);
+  }
+  pool.StopClock(threadId);
+  auto counts = perf.Stop();
+  counts.ops = ops;
+  stats.perf.Merge(counts);
+  stats.ops += ops;
+}
+
+/**
+ * Replays a trace on a map, starting from an empty one sized for n keys. The
+ * records are split into a contiguous part per thread, and the time between
+ * records is ignored, so each thread replays its part as fast as it can.
+ * @param mapName The name to report the results under.
+ * @param trace The trace.
+ * @param single Whether the map is only safe to use from one thread, in which
+ *  case only one thread is run.
+ */
+template <template <typename, typename> class TMap>
+RunnerResults BenchmarkRunner::RunMapReplay(const std::string &mapName,
+                                            const TraceFile &trace,
+                                            bool single) {
+  using MapType = TMap<int, int>;
+  RunnerResults results(mapName + "/replay", params);
+  const size_t minThreads = single ? 1 : params.minThreads;
+  const size_t maxThreads = single ? 1 : params.maxThreads;
+  for (size_t c = minThreads; c <= maxThreads; ++c) {
+    double runTime = 0.0;
+    std::vector<WorkerStats> stats(c);
+    std::vector<RepeatSample> repeats;
+    MemoryUsage memory;
+    std::vector<ThroughputSample> timeSeries;
+    for (unsigned r = 0; r < params.repeat; ++r) {
+      ThroughputSampler sampler(c);
+      auto built = StartMemory();
+      MapType hashMap((int)(params.n / params.mapLoadFactor));
+      auto samplerPtr = RunsForDuration() ? &sampler : nullptr;
+      StartSampler(sampler, r);
+      runTime += TimeRepeat(c, stats, repeats, [&](size_t t) {
+        ReplayMap(t, c, hashMap, trace, stats[t], samplerPtr);
+      });
+      JoinSampler(sampler, timeSeries);
+      RecordMemory(memory, built, hashMap.Size(), repeats);
+    }
+    CollectResults(results, runTime, repeats, memory, stats, &timeSeries);
+  }
+  return results;
+}
+
+template <typename TMap>
+void BenchmarkRunner::ReplayMap(size_t threadId, size_t nThreads,
+                                TMap &hashMap, const TraceFile &trace,
+                                WorkerStats &stats,
+                                ThroughputSampler *sampler) {
+  auto slice = trace.Slice(threadId, nThreads);
+  auto counter = sampler ? &sampler->counters[threadId].ops : nullptr;
+  PerfCounterGroup perf(params.perfCounters);
+  perf.Start();
+  pool.StartClock(threadId);
+  StartArrivals(stats.arrivals, threadId, nThreads);
+  size_t ops = 0;
+  // Timed runs start over from the first record of the part.
+  for (size_t i = 0;
+       slice.second and (sampler ? not sampler->Stopped() : ops < slice.second);
+       ++ops) {
+    auto &record = slice.first[i];
+    if (++i == slice.second)
+      i = 0;
+    int key = record.key;
+    int value;
+    switch (record.op) {
+    case TraceOp::Insert:
+      Timed(stats, stats.latencies.insert, [&] { hashMap.Insert(key, key); });
+      break;
+    case TraceOp::Remove:
+      Timed(stats, stats.latencies.remove, [&] { hashMap.Remove(key); });
+      break;
+    case TraceOp::Lookup:
+      Timed(stats, stats.latencies.lookup, [&] { hashMap.Find(key, value); });
+      break;
+    case TraceOp::Update:
+      Timed(stats, stats.latencies.update, [&] { hashMap.Update(key, key); });
+      break;
+    }
+    if (counter)
+      counter->store(ops + 1, std::memory_order_relaxed);
+  }
+  pool.StopClock(threadId);
+  auto counts = perf.Stop();
+  counts.ops = ops;
+  stats.perf.Merge(counts);
+  stats.ops += ops;
 }
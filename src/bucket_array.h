@@ -0,0 +1,81 @@
+/**
+ * @file bucket_array.h
+ *
+ * A fixed-size array of buckets that can give each bucket its own cache lines.
+ */
+
+#pragma once
+
+#include <new>
+
+#include "allocator.h"
+#include "cache_line.h"
+#include "memory_accounting.h"
+
+/**
+ * How the buckets of a BucketArray are laid out in memory:
+ * - Packed: next to each other, as in a plain array.
+ * - Padded: each bucket starts on a cache line of its own, so writers to
+ *   adjacent buckets do not invalidate each other's lines.
+ */
+enum class BucketLayout { Packed, Padded };
+
+/**
+ * A fixed-size array of default-constructed buckets. The array is allocated
+ * with allocateAligned rather than new, which in C++11 does not honor
+ * alignments larger than the default, so padded buckets really are cache line
+ * aligned. It is counted in the memory accounting by hand for the same reason.
+ */
+template <typename T> struct BucketArray {
+  char *data{nullptr};
+  std::size_t size;
+  std::size_t stride;
+
+  /**
+   * Allocates and default-constructs the buckets.
+   * @param size The number of buckets.
+   * @param layout How the buckets are laid out.
+   */
+  BucketArray(std::size_t size, BucketLayout layout = BucketLayout::Packed)
+      : size(size), stride(layout == BucketLayout::Padded
+                               ? roundUpToCacheLine(sizeof(T))
+                               : sizeof(T)) {
+    std::size_t align =
+        layout == BucketLayout::Padded ? kCacheLineSize : sizeof(void *);
+    if (alignof(T) > align)
+      align = alignof(T);
+    void *p = allocateAligned(size * stride, align);
+    if (not p)
+      throw std::bad_alloc();
+    data = static_cast<char *>(p);
+    countAllocation(allocatedSize(data));
+    std::size_t i = 0;
+    try {
+      for (; i < size; ++i)
+        new (data + i * stride) T();
+    } catch (...) {
+      while (i)
+        (*this)[--i].~T();
+      countFree(allocatedSize(data));
+      deallocate(data);
+      throw;
+    }
+  }
+
+  ~BucketArray() {
+    for (std::size_t i = 0; i < size; ++i)
+      (*this)[i].~T();
+    countFree(allocatedSize(data));
+    deallocate(data);
+  }
+
+  BucketArray(const BucketArray &) = delete;
+  BucketArray &operator=(const BucketArray &) = delete;
+
+  T &operator[](std::size_t i) noexcept {
+    return *reinterpret_cast<T *>(data + i * stride);
+  }
+  const T &operator[](std::size_t i) const noexcept {
+    return *reinterpret_cast<const T *>(data + i * stride);
+  }
+};
@@ -0,0 +1,29 @@
+/**
+ * @file cache_line.h
+ *
+ * Cache line size and padding used to keep hot fields apart.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+/** The cache line size assumed for padding, 64 bytes on current x86 and ARM. */
+constexpr std::size_t kCacheLineSize = 64;
+
+/**
+ * A full cache line of padding. The lists and maps are allocated with plain
+ * new, so they are not cache line aligned, and only a full line between two
+ * fields guarantees they never share one.
+ */
+struct CacheLinePad {
+  char bytes[kCacheLineSize];
+};
+
+/**
+ * @param size A size in bytes.
+ * @return size rounded up to a multiple of kCacheLineSize.
+ */
+constexpr std::size_t roundUpToCacheLine(std::size_t size) noexcept {
+  return (size + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+}
@@ -10,16 +10,24 @@
 #include <ostream>
 
 #include "dllist.h"
+#include "list_stats.h"
+#include "lock_profile.h"
 
 /**
  * A simple doubly linked list with very basic operations:
  * - inserting at the front of the list
  * - removing anywhere from the list
  * - and finding elements
+ * - bulk inserts, removals and lookups done under a single lock acquisition
+ * - iterating over the elements with ForEach(), which holds the lock. The
+ *   iterators inherited from DlList do not lock, so mtx has to be held while
+ *   they are used.
  */
-template <typename T> struct CoarseGrainList : DlList<T> {
-  using LockGuard = std::lock_guard<std::mutex>;
-  mutable std::mutex mtx;
+template <typename T, typename TStats = DefaultListStats>
+struct CoarseGrainList : DlList<T, TStats> {
+  using Mutex = Profiled<std::mutex>;
+  using LockGuard = std::lock_guard<Mutex>;
+  mutable Mutex mtx;
 
   DlNode<T> *Insert(T value) override;
   bool InsertUnique(T value) override;
@@ -28,15 +36,23 @@ template <typename T> struct CoarseGrainList : DlList<T> {
   bool Find(T &value) const noexcept override;
   unsigned Size() const noexcept override;
   bool Empty() const noexcept override;
+
+  template <typename TIter> unsigned InsertRange(TIter first, TIter last);
+  template <typename TPred> unsigned RemoveIf(TPred pred) noexcept;
+  template <typename TSet> unsigned RemoveAll(const TSet &values) noexcept;
+  template <typename TIter>
+  bool ContainsAll(TIter first, TIter last) const;
+  template <typename TFunc> void ForEach(TFunc fn) const;
 };
 
 /**
  * Inserts an element into the list at the front of the list.
  * @param value The value to insert into the list.
  */
-template <typename T> DlNode<T> *CoarseGrainList<T>::Insert(T value) {
+template <typename T, typename TStats>
+DlNode<T> *CoarseGrainList<T, TStats>::Insert(T value) {
   LockGuard lck(mtx);
-  return DlList<T>::Insert(value);
+  return DlList<T, TStats>::Insert(value);
 }
 
 /**
@@ -44,47 +60,114 @@ template <typename T> DlNode<T> *CoarseGrainList<T>::Insert(T value) {
  * @param value The value to insert into the list.
  * @return True if the value was inserted, false otherwise.
  */
-template <typename T> bool CoarseGrainList<T>::InsertUnique(T value) {
+template <typename T, typename TStats>
+bool CoarseGrainList<T, TStats>::InsertUnique(T value) {
   LockGuard lck(mtx);
-  return DlList<T>::InsertUnique(value);
+  return DlList<T, TStats>::InsertUnique(value);
 }
 
 /**
  * Removes an element from the list if the element is found.
  * @param value The value to remove from the list.
  */
-template <typename T> bool CoarseGrainList<T>::Remove(T value) noexcept {
+template <typename T, typename TStats>
+bool CoarseGrainList<T, TStats>::Remove(T value) noexcept {
   LockGuard lck(mtx);
-  return DlList<T>::Remove(value);
+  return DlList<T, TStats>::Remove(value);
 }
 
 /**
  * Removes an element from the list if the element is found.
  * @param value The value to remove from the list.
  */
-template <typename T>
-bool CoarseGrainList<T>::Contains(T value) const noexcept {
+template <typename T, typename TStats>
+bool CoarseGrainList<T, TStats>::Contains(T value) const noexcept {
   LockGuard lck(mtx);
-  return DlList<T>::Contains(value);
+  return DlList<T, TStats>::Contains(value);
 }
 
-template <typename T> bool CoarseGrainList<T>::Find(T &value) const noexcept {
+template <typename T, typename TStats>
+bool CoarseGrainList<T, TStats>::Find(T &value) const noexcept {
   LockGuard lck(mtx);
-  return DlList<T>::Find(value);
+  return DlList<T, TStats>::Find(value);
 }
 
 /**
  * @return The number of elements in the list.
  */
-template <typename T> unsigned CoarseGrainList<T>::Size() const noexcept {
-  return DlList<T>::Size();
+template <typename T, typename TStats>
+unsigned CoarseGrainList<T, TStats>::Size() const noexcept {
+  return DlList<T, TStats>::Size();
 }
 
 /**
  * @return True if the list is empty, false otherwise.
  */
-template <typename T> bool CoarseGrainList<T>::Empty() const noexcept {
-  return DlList<T>::Empty();
+template <typename T, typename TStats>
+bool CoarseGrainList<T, TStats>::Empty() const noexcept {
+  return DlList<T, TStats>::Empty();
+}
+
+/**
+ * Inserts a range of values at the front of the list, as if Insert() was
+ * called on each of them in order.
+ * @param first Iterator to the first value to insert.
+ * @param last Iterator past the last value to insert.
+ * @return The number of values inserted.
+ */
+template <typename T, typename TStats>
+template <typename TIter>
+unsigned CoarseGrainList<T, TStats>::InsertRange(TIter first, TIter last) {
+  LockGuard lck(mtx);
+  return DlList<T, TStats>::InsertRange(first, last);
+}
+
+/**
+ * Removes every element that satisfies a predicate.
+ * @param pred The predicate, called with a const reference to each value.
+ * @return The number of elements removed.
+ */
+template <typename T, typename TStats>
+template <typename TPred>
+unsigned CoarseGrainList<T, TStats>::RemoveIf(TPred pred) noexcept {
+  LockGuard lck(mtx);
+  return DlList<T, TStats>::RemoveIf(pred);
+}
+
+/**
+ * Removes every element whose value is in a set.
+ * @param values The values to remove. Only needs a count() member.
+ * @return The number of elements removed.
+ */
+template <typename T, typename TStats>
+template <typename TSet>
+unsigned CoarseGrainList<T, TStats>::RemoveAll(const TSet &values) noexcept {
+  LockGuard lck(mtx);
+  return DlList<T, TStats>::RemoveAll(values);
+}
+
+/**
+ * Checks if all the values of a sorted range are in the list.
+ * @param first Iterator to the first value of a sorted random-access range.
+ * @param last Iterator past the last value of the range.
+ * @return True if every value of the range is in the list.
+ */
+template <typename T, typename TStats>
+template <typename TIter>
+bool CoarseGrainList<T, TStats>::ContainsAll(TIter first, TIter last) const {
+  LockGuard lck(mtx);
+  return DlList<T, TStats>::ContainsAll(first, last);
+}
+
+/**
+ * Calls a function on every value in the list while the list is locked.
+ * @param fn The function, called with a const reference to each value.
+ */
+template <typename T, typename TStats>
+template <typename TFunc>
+void CoarseGrainList<T, TStats>::ForEach(TFunc fn) const {
+  LockGuard lck(mtx);
+  DlList<T, TStats>::ForEach(fn);
 }
 
 /**
@@ -94,11 +177,12 @@ template <typename T> bool CoarseGrainList<T>::Empty() const noexcept {
  * @return A reference to the output stream.
  * @details The format is: (value1,value2,..,valueN).
  */
-template <typename T>
-std::ostream &operator<<(std::ostream &os, const CoarseGrainList<T> &lst) {
-  using LockGuard = typename CoarseGrainList<T>::LockGuard;
+template <typename T, typename TStats>
+std::ostream &operator<<(std::ostream &os,
+                         const CoarseGrainList<T, TStats> &lst) {
+  using LockGuard = typename CoarseGrainList<T, TStats>::LockGuard;
   LockGuard lck(lst.mtx);
-  return os << *dynamic_cast<const DlList<T> *>(&lst);
+  return os << *dynamic_cast<const DlList<T, TStats> *>(&lst);
 }
 
 /**
@@ -108,15 +192,16 @@ std::ostream &operator<<(std::ostream &os, const CoarseGrainList<T> &lst) {
  * @return True if the lists have the same number of elements and all the
  *  elements are the same. Empty lists are considered equal.
  */
-template <typename T>
-bool operator==(const CoarseGrainList<T> &lhs, const CoarseGrainList<T> &rhs) {
+template <typename T, typename TStats>
+bool operator==(const CoarseGrainList<T, TStats> &lhs,
+                const CoarseGrainList<T, TStats> &rhs) {
   if (&lhs.mtx == &rhs.mtx)
     return true;
-  using LockGuard = typename CoarseGrainList<T>::LockGuard;
+  using LockGuard = typename CoarseGrainList<T, TStats>::LockGuard;
   std::lock(lhs.mtx, rhs.mtx);
   LockGuard lck1(lhs.mtx, std::adopt_lock);
   LockGuard lck2(rhs.mtx, std::adopt_lock);
-  using Base = const DlList<T> *;
+  using Base = const DlList<T, TStats> *;
   return *dynamic_cast<Base>(&lhs) == *dynamic_cast<Base>(&rhs);
 }
 
@@ -126,7 +211,8 @@ bool operator==(const CoarseGrainList<T> &lhs, const CoarseGrainList<T> &rhs) {
  * @param rhs The list on right side.
  * @return True if the lists are not the same, false otherwise.
  */
-template <typename T>
-bool operator!=(const CoarseGrainList<T> &lhs, const CoarseGrainList<T> &rhs) {
+template <typename T, typename TStats>
+bool operator!=(const CoarseGrainList<T, TStats> &lhs,
+                const CoarseGrainList<T, TStats> &rhs) {
   return not(lhs == rhs);
 }
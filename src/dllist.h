@@ -6,17 +6,55 @@
 
 #pragma once
 
+#include <cstddef>
+#include <iterator>
 #include <ostream>
 
 #include "dlnode.h"
+#include "list_stats.h"
+#include "sorted_range.h"
 
 /**
  * A simple doubly linked list with very basic operations:
  * - inserting at the front of the list
  * - removing anywhere from the list
  * - and finding elements
+ * - bulk inserts, removals and lookups done in a single traversal
+ * - iterating over the elements
  */
-template <typename T> struct DlList {
+template <typename T, typename TStats = DefaultListStats> struct DlList {
+  /**
+   * A forward iterator over the values of the list. Like the list itself, it
+   * is not safe to use while the list is being modified.
+   */
+  struct const_iterator {
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    const DlNode<T> *node;
+
+    reference operator*() const noexcept { return node->value; }
+    pointer operator->() const noexcept { return &node->value; }
+    const_iterator &operator++() noexcept {
+      node = node->next;
+      return *this;
+    }
+    const_iterator operator++(int) noexcept {
+      auto it = *this;
+      node = node->next;
+      return it;
+    }
+    bool operator==(const const_iterator &it) const noexcept {
+      return node == it.node;
+    }
+    bool operator!=(const const_iterator &it) const noexcept {
+      return node != it.node;
+    }
+  };
+
   DlNode<T> *head{nullptr};
   unsigned size{0};
 
@@ -28,12 +66,22 @@ template <typename T> struct DlList {
   virtual bool Find(T &value) const noexcept;
   virtual unsigned Size() const noexcept;
   virtual bool Empty() const noexcept;
+
+  template <typename TIter> unsigned InsertRange(TIter first, TIter last);
+  template <typename TPred> unsigned RemoveIf(TPred pred) noexcept;
+  template <typename TSet> unsigned RemoveAll(const TSet &values) noexcept;
+  template <typename TIter>
+  bool ContainsAll(TIter first, TIter last) const;
+
+  const_iterator begin() const noexcept { return {head}; }
+  const_iterator end() const noexcept { return {nullptr}; }
+  template <typename TFunc> void ForEach(TFunc fn) const;
 };
 
 /**
  * Destroys the list.
  */
-template <typename T> DlList<T>::~DlList() {
+template <typename T, typename TStats> DlList<T, TStats>::~DlList() {
   auto node = head;
   while (node) {
     auto prev = node;
@@ -46,7 +94,8 @@ template <typename T> DlList<T>::~DlList() {
  * Inserts an element into the list at the front of the list.
  * @param value The value to insert into the list.
  */
-template <typename T> DlNode<T> *DlList<T>::Insert(T value) {
+template <typename T, typename TStats>
+DlNode<T> *DlList<T, TStats>::Insert(T value) {
   // The list is empty
   if (not head) {
     head = new DlNode<T>(std::move(value));
@@ -66,7 +115,8 @@ template <typename T> DlNode<T> *DlList<T>::Insert(T value) {
  * @param value The value to insert into the list.
  * @return True if the value was inserted, false otherwise.
  */
-template <typename T> bool DlList<T>::InsertUnique(T value) {
+template <typename T, typename TStats>
+bool DlList<T, TStats>::InsertUnique(T value) {
   if (not head) {
     head = new DlNode<T>(std::move(value));
     ++size;
@@ -75,6 +125,7 @@ template <typename T> bool DlList<T>::InsertUnique(T value) {
 
   auto node = head;
   for (; node; node = node->next) {
+    TStats::Hop();
     if (node->value == value)
       return false;
     if (not node->next)
@@ -90,13 +141,15 @@ template <typename T> bool DlList<T>::InsertUnique(T value) {
  * Removes an element from the list if the element is found.
  * @param value The value to remove from the list.
  */
-template <typename T> bool DlList<T>::Remove(T value) noexcept {
+template <typename T, typename TStats>
+bool DlList<T, TStats>::Remove(T value) noexcept {
   // The list is empty
   if (not head)
     return false;
 
   auto node = head;
   while (node) {
+    TStats::Hop();
     if (node->value == value) {
       if (head == node) {
         head = node->next;
@@ -124,9 +177,11 @@ template <typename T> bool DlList<T>::Remove(T value) noexcept {
  * Removes an element from the list if the element is found.
  * @param value The value to remove from the list.
  */
-template <typename T> bool DlList<T>::Contains(T value) const noexcept {
+template <typename T, typename TStats>
+bool DlList<T, TStats>::Contains(T value) const noexcept {
   auto node = head;
   while (node) {
+    TStats::Hop();
     if (value == node->value)
       return true;
     node = node->next;
@@ -134,9 +189,11 @@ template <typename T> bool DlList<T>::Contains(T value) const noexcept {
   return false;
 }
 
-template <typename T> bool DlList<T>::Find(T &value) const noexcept {
+template <typename T, typename TStats>
+bool DlList<T, TStats>::Find(T &value) const noexcept {
   auto node = head;
   while (node) {
+    TStats::Hop();
     if (value == node->value) {
       value = node->value;
       return true;
@@ -149,15 +206,107 @@ template <typename T> bool DlList<T>::Find(T &value) const noexcept {
 /**
  * @return The number of elements in the list.
  */
-template <typename T> unsigned DlList<T>::Size() const noexcept { return size; }
+template <typename T, typename TStats>
+unsigned DlList<T, TStats>::Size() const noexcept { return size; }
 
 /**
  * @return True if the list is empty, false otherwise.
  */
-template <typename T> bool DlList<T>::Empty() const noexcept {
+template <typename T, typename TStats>
+bool DlList<T, TStats>::Empty() const noexcept {
   return size == 0u;
 }
 
+/**
+ * Inserts a range of values at the front of the list, as if Insert() was
+ * called on each of them in order.
+ * @param first Iterator to the first value to insert.
+ * @param last Iterator past the last value to insert.
+ * @return The number of values inserted.
+ */
+template <typename T, typename TStats>
+template <typename TIter>
+unsigned DlList<T, TStats>::InsertRange(TIter first, TIter last) {
+  unsigned n = 0;
+  for (; first != last; ++first, ++n) {
+    auto node = new DlNode<T>(*first, nullptr, head);
+    if (head)
+      head->prev = node;
+    head = node;
+  }
+  size += n;
+  return n;
+}
+
+/**
+ * Removes every element that satisfies a predicate.
+ * @param pred The predicate, called with a const reference to each value.
+ * @return The number of elements removed.
+ */
+template <typename T, typename TStats>
+template <typename TPred>
+unsigned DlList<T, TStats>::RemoveIf(TPred pred) noexcept {
+  unsigned removed = 0;
+  auto node = head;
+  while (node) {
+    TStats::Hop();
+    auto next = node->next;
+    if (pred(node->value)) {
+      if (node->prev)
+        node->prev->next = next;
+      else
+        head = next;
+      if (next)
+        next->prev = node->prev;
+      delete node;
+      ++removed;
+    }
+    node = next;
+  }
+  size -= removed;
+  return removed;
+}
+
+/**
+ * Removes every element whose value is in a set.
+ * @param values The values to remove. Only needs a count() member.
+ * @return The number of elements removed.
+ */
+template <typename T, typename TStats>
+template <typename TSet>
+unsigned DlList<T, TStats>::RemoveAll(const TSet &values) noexcept {
+  return RemoveIf(
+      [&values](const T &value) { return values.count(value) != 0; });
+}
+
+/**
+ * Checks if all the values of a sorted range are in the list.
+ * @param first Iterator to the first value of a sorted random-access range.
+ * @param last Iterator past the last value of the range.
+ * @return True if every value of the range is in the list.
+ */
+template <typename T, typename TStats>
+template <typename TIter>
+bool DlList<T, TStats>::ContainsAll(TIter first, TIter last) const {
+  SortedRangeMatcher<TIter> matcher(first, last);
+  for (auto node = head; node and not matcher.Done(); node = node->next) {
+    TStats::Hop();
+    matcher.Visit(node->value);
+  }
+  return matcher.Done();
+}
+
+/**
+ * Calls a function on every value in the list.
+ * @param fn The function, called with a const reference to each value.
+ */
+template <typename T, typename TStats>
+template <typename TFunc>
+void DlList<T, TStats>::ForEach(TFunc fn) const {
+  for (auto &value : *this)
+    fn(value);
+}
+
 /**
  * Output stream operator for DlList.
  * @param os The output stream.
@@ -165,8 +314,8 @@ template <typename T> bool DlList<T>::Empty() const noexcept {
  * @return A reference to the output stream.
  * @details The format is: (value1,value2,..,valueN).
  */
-template <typename T>
-std::ostream &operator<<(std::ostream &os, const DlList<T> &dlList) {
+template <typename T, typename TStats>
+std::ostream &operator<<(std::ostream &os, const DlList<T, TStats> &dlList) {
   os << "(";
   auto node = dlList.head;
   if (node) {
@@ -188,8 +337,9 @@ std::ostream &operator<<(std::ostream &os, const DlList<T> &dlList) {
  * @return True if the lists have the same number of elements and all the
  *  elements are the same. Empty lists are considered equal.
  */
-template <typename T>
-bool operator==(const DlList<T> &lList, const DlList<T> &rList) {
+template <typename T, typename TStats>
+bool operator==(const DlList<T, TStats> &lList,
+                const DlList<T, TStats> &rList) {
   if (lList.size != rList.size)
     return false;
   auto node1 = lList.head;
@@ -209,7 +359,8 @@ bool operator==(const DlList<T> &lList, const DlList<T> &rList) {
  * @param rList The DlList on right side.
  * @return True if the lists are not the same, false otherwise.
  */
-template <typename T>
-bool operator!=(const DlList<T> &lList, const DlList<T> &rList) {
+template <typename T, typename TStats>
+bool operator!=(const DlList<T, TStats> &lList,
+                const DlList<T, TStats> &rList) {
   return not(lList == rList);
 }
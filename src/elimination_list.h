@@ -0,0 +1,191 @@
+/**
+ * @file elimination_list.h
+ *
+ * A lockfree linked list with an elimination-backoff layer in front of it.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include "lockfree_list.h"
+
+/**
+ * A small elimination array where an Insert and a Remove of the same value can
+ * meet and cancel each other out without touching the list.
+ *
+ * @details Each slot goes through the states Empty -> Busy -> Waiting while
+ *  the owner publishes its value, and Waiting -> Claimed -> Matched (or back to
+ *  Waiting) while a complementary operation inspects it. The owner is the only
+ *  one that moves a slot back to Empty.
+ */
+template <typename T> struct EliminationArray {
+  enum State : int {
+    kEmpty,
+    kBusy,
+    kInsertWaiting,
+    kRemoveWaiting,
+    kClaimed,
+    kMatched
+  };
+
+  struct Slot {
+    std::atomic_int state{kEmpty};
+    T value{};
+  };
+
+  static constexpr unsigned kNumSlots = 4;
+  static constexpr unsigned kSpins = 128;
+  Slot slots[kNumSlots];
+
+  bool Visit(T value, bool isInsert, bool wait) noexcept;
+  static unsigned NextIndex() noexcept;
+};
+
+/**
+ * Tries to exchange an operation with a complementary one in the array.
+ * @param value The value being inserted or removed.
+ * @param isInsert True for an Insert, false for a Remove.
+ * @param wait If true and no complementary operation is waiting, publishes
+ *  the operation and spins for a short while waiting for a partner.
+ * @return True if the operation was eliminated, false otherwise.
+ */
+template <typename T>
+bool EliminationArray<T>::Visit(T value, bool isInsert, bool wait) noexcept {
+  const int mine = isInsert ? kInsertWaiting : kRemoveWaiting;
+  const int other = isInsert ? kRemoveWaiting : kInsertWaiting;
+  auto &slot = slots[NextIndex() % kNumSlots];
+
+  int state = slot.state.load();
+  if (state == other) {
+    if (not slot.state.compare_exchange_strong(state, kClaimed))
+      return false;
+    if (value == slot.value) {
+      slot.state.store(kMatched);
+      return true;
+    }
+    slot.state.store(other);
+    return false;
+  }
+
+  if (not wait or state != kEmpty or
+      not slot.state.compare_exchange_strong(state, kBusy))
+    return false;
+
+  slot.value = value;
+  slot.state.store(mine);
+  for (unsigned i = 0; i < kSpins; ++i) {
+    if (slot.state.load() == kMatched) {
+      slot.state.store(kEmpty);
+      return true;
+    }
+  }
+
+  // Withdraw the offer, unless somebody is looking at it right now.
+  while (1) {
+    state = mine;
+    if (slot.state.compare_exchange_strong(state, kEmpty))
+      return false;
+    while ((state = slot.state.load()) == kClaimed)
+      ;
+    if (state == kMatched) {
+      slot.state.store(kEmpty);
+      return true;
+    }
+  }
+}
+
+/**
+ * @return A per-thread pseudo-random index used to spread threads over slots.
+ */
+template <typename T> unsigned EliminationArray<T>::NextIndex() noexcept {
+  static thread_local unsigned seed =
+      std::hash<std::thread::id>()(std::this_thread::get_id()) | 1u;
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+/**
+ * A LockFreeList where a thread that fails a CAS while inserting at the head,
+ * or while marking a node for removal, first tries to meet a complementary
+ * operation in an elimination array before it retries. An Insert(v) and a
+ * Remove(v) that meet are linearized back to back, and neither touches the
+ * list.
+ */
+template <typename T, typename TStats = DefaultListStats>
+struct EliminationList : LockFreeList<T, TStats> {
+  EliminationArray<T> elimination;
+
+  bool Insert(T value) override;
+  bool Remove(T value) noexcept override;
+};
+
+/**
+ * Inserts an element into the list at the front of the list.
+ * @param value The value to insert into the list.
+ */
+template <typename T, typename TStats>
+bool EliminationList<T, TStats>::Insert(T value) {
+  auto head = this->head;
+  LockFreeNode<T> *new_node = new LockFreeNode<T>(value);
+  LockFreeNode<T> *first = head->next.load(std::memory_order_relaxed);
+  new_node->next.store(first, std::memory_order_relaxed);
+  while (!head->next.compare_exchange_weak(first, new_node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    TStats::CasFailure();
+    if (elimination.Visit(value, true, true)) {
+      delete new_node;
+      return true;
+    }
+    new_node->next.store(first, std::memory_order_relaxed);
+  }
+  this->size.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+/**
+ * Removes an element from the list if the element is found.
+ * @param value The value to remove from the list.
+ * @return True if the value was found, false otherwise.
+ * @details If the value is not in the list, a concurrent Insert of the same
+ *  value waiting in the elimination array is still allowed to match.
+ */
+template <typename T, typename TStats>
+bool EliminationList<T, TStats>::Remove(T value) noexcept {
+  using List = LockFreeList<T, TStats>;
+  LockFreeNode<T> *right_node, *left_node, *right_node_next;
+  while (1) {
+    right_node = this->search(value, &left_node);
+    if ((right_node == this->tail) || (right_node->value != value)) {
+      return elimination.Visit(value, false, false);
+    }
+    right_node_next = right_node->next.load(std::memory_order_acquire);
+    if (!List::is_marked(right_node_next)) {
+      // logically delete node
+      if (right_node->next.compare_exchange_weak(
+              right_node_next, List::get_marked(right_node_next),
+              std::memory_order_relaxed, std::memory_order_relaxed)) {
+        this->size.fetch_sub(1, std::memory_order_relaxed);
+        break;
+      }
+      TStats::CasFailure();
+    }
+    if (elimination.Visit(value, false, true))
+      return true;
+    TStats::Restart();
+  }
+  // physically delete node
+  if (!left_node->next.compare_exchange_weak(right_node, right_node_next,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+    TStats::CasFailure();
+    TStats::Restart();
+    this->search(value, &left_node);
+  }
+  return true;
+}
@@ -7,13 +7,23 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
+#include <iterator>
 #include <mutex>
+#include <ostream>
 
-template <typename T> struct FineGrainNode {
+#include "futex_lock.h"
+#include "list_stats.h"
+#include "lock_profile.h"
+#include "scan_reclaimer.h"
+#include "sorted_range.h"
+
+template <typename T, typename TLock = std::mutex> struct FineGrainNode {
   T value{};
+  // Next to the value, so that a small value and a compact lock share a word.
+  mutable TLock mtx{};
   FineGrainNode *prev{nullptr};
   FineGrainNode *next{nullptr};
-  mutable std::mutex mtx{};
 
   /**
    * Initializes node with a specific value.
@@ -45,28 +55,140 @@ template <typename T> struct FineGrainNode {
  * - inserting at the front of the list
  * - removing from anywhere in the list
  * - and finding elements
+ * - bulk inserts, removals and lookups done in a single hand-over-hand
+ *   traversal
+ * - iterating over the elements
+ *
+ * TLock is the lock type used by the list and by every node. FineGrainList uses
+ * std::mutex, and CompactFineGrainList uses the four byte FutexLock, which
+ * makes a node holding an int 24 bytes instead of 64. Both are Profiled, so
+ * their locks are profiled in builds with lock profiling.
  */
-template <typename T> struct FineGrainList {
-  using LockGuard = std::lock_guard<std::mutex>;
-  FineGrainNode<T> *head{nullptr};
+template <typename T, typename TLock, typename TStats = DefaultListStats>
+struct BasicFineGrainList {
+  using NodeType = FineGrainNode<T, TLock>;
+
+  /**
+   * A single-pass iterator that copies the value and the next link of a node
+   * while it holds the node's mutex, and lets go of it before the value is
+   * used. No lock is held between increments, so writers are never blocked by
+   * a scan for longer than the copy, and the iterating thread may modify the
+   * list. The iteration is a scan of the list's ScanReclaimer, so the node it
+   * points to is not freed under it even if it is removed. It is weakly
+   * consistent: every element that is in the list for the whole iteration is
+   * seen exactly once, and elements inserted or removed concurrently may or
+   * may not be seen.
+   */
+  struct const_iterator {
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    const BasicFineGrainList *list;
+    NodeType *node;
+    NodeType *next;
+    T value;
+
+    const_iterator() noexcept : list(nullptr), node(nullptr), next(nullptr) {}
+    /**
+     * Starts at a node, in a scan that has been started on the list.
+     * @param list The list.
+     * @param node The first node, or nullptr to end the scan at once.
+     */
+    const_iterator(const BasicFineGrainList *list, NodeType *node)
+        : list(list), node(nullptr), next(node) {
+      try {
+        ++*this;
+      } catch (...) {
+        list->reclaimer.EndScan();
+        throw;
+      }
+    }
+    const_iterator(const_iterator &&it) noexcept
+        : list(it.list), node(it.node), next(it.next),
+          value(std::move(it.value)) {
+      it.node = nullptr;
+    }
+    const_iterator &operator=(const_iterator &&it) noexcept {
+      if (this != &it) {
+        if (node)
+          list->reclaimer.EndScan();
+        list = it.list;
+        node = it.node;
+        next = it.next;
+        value = std::move(it.value);
+        it.node = nullptr;
+      }
+      return *this;
+    }
+    const_iterator(const const_iterator &it) = delete;
+    const_iterator &operator=(const const_iterator &it) = delete;
+    ~const_iterator() {
+      if (node)
+        list->reclaimer.EndScan();
+    }
+
+    reference operator*() const noexcept { return value; }
+    pointer operator->() const noexcept { return &value; }
+    const_iterator &operator++() {
+      node = next;
+      if (not node) {
+        list->reclaimer.EndScan();
+        return *this;
+      }
+      LockGuard lck(node->mtx);
+      value = node->value;
+      next = node->next;
+      return *this;
+    }
+    bool operator==(const const_iterator &it) const noexcept {
+      return node == it.node;
+    }
+    bool operator!=(const const_iterator &it) const noexcept {
+      return node != it.node;
+    }
+  };
+
+  using LockGuard = std::lock_guard<TLock>;
+  NodeType *head{nullptr};
   std::atomic_uint size{0};
-  mutable std::mutex mtx{};
+  mutable TLock mtx{};
+  mutable ScanReclaimer<NodeType> reclaimer;
 
-  ~FineGrainList();
-  FineGrainNode<T> *Insert(T value);
+  ~BasicFineGrainList();
+  NodeType *Insert(T value);
   bool InsertUnique(T value);
   bool Remove(T value) noexcept;
   bool Contains(T value) const noexcept;
   bool Find(T &value) const noexcept;
   unsigned Size() const noexcept;
   bool Empty() const noexcept;
+
+  template <typename TIter> unsigned InsertRange(TIter first, TIter last);
+  template <typename TPred> unsigned RemoveIf(TPred pred) noexcept;
+  template <typename TSet> unsigned RemoveAll(const TSet &values) noexcept;
+  template <typename TIter>
+  bool ContainsAll(TIter first, TIter last) const;
+
+  const_iterator begin() const;
+  const_iterator end() const noexcept { return const_iterator(); }
+  template <typename TFunc> void ForEach(TFunc fn) const;
 };
 
+template <typename T, typename TStats = DefaultListStats>
+using FineGrainList = BasicFineGrainList<T, Profiled<std::mutex>, TStats>;
+template <typename T, typename TStats = DefaultListStats>
+using CompactFineGrainList =
+    BasicFineGrainList<T, Profiled<FutexLock>, TStats>;
+
 /**
  * Destroys the list. Since the list is being destroyed, we just lock the whole
  * list to prevent other threads from getting access to any part of the list.
  */
-template <typename T> FineGrainList<T>::~FineGrainList() {
+template <typename T, typename TLock, typename TStats>
+BasicFineGrainList<T, TLock, TStats>::~BasicFineGrainList() {
   LockGuard lck(mtx);
   auto node = head;
   while (node) {
@@ -81,16 +203,17 @@ template <typename T> FineGrainList<T>::~FineGrainList() {
  * Inserts an element into the list at the front of the list.
  * @param value The value to insert into the list.
  */
-template <typename T> FineGrainNode<T> *FineGrainList<T>::Insert(T value) {
+template <typename T, typename TLock, typename TStats>
+FineGrainNode<T, TLock> *BasicFineGrainList<T, TLock, TStats>::Insert(T value) {
   LockGuard lck(mtx);
   // The list is empty
   if (not head) {
-    head = new FineGrainNode<T>(value);
+    head = new NodeType(value);
     ++size;
     return head;
   } else {
     LockGuard headLck(head->mtx);
-    auto node = new FineGrainNode<T>(value, nullptr, head);
+    auto node = new NodeType(value, nullptr, head);
     head->prev = node;
     head = node;
     ++size;
@@ -103,12 +226,13 @@ template <typename T> FineGrainNode<T> *FineGrainList<T>::Insert(T value) {
  * @param value The value to insert into the list.
  * @return True if the value was inserted, false otherwise.
  */
-template <typename T> bool FineGrainList<T>::InsertUnique(T value) {
+template <typename T, typename TLock, typename TStats>
+bool BasicFineGrainList<T, TLock, TStats>::InsertUnique(T value) {
   mtx.lock();
 
   if (not head) {
     try {
-      head = new FineGrainNode<T>(value);
+      head = new NodeType(value);
     } catch (...) {
       mtx.unlock();
       return false;
@@ -120,11 +244,13 @@ template <typename T> bool FineGrainList<T>::InsertUnique(T value) {
 
   auto prev = head;
   prev->mtx.lock();
+  TStats::Hop();
   auto curr = prev->next;
   mtx.unlock();
 
   while (curr) {
     curr->mtx.lock();
+    TStats::Hop();
     if (prev->value == value) {
       curr->mtx.unlock();
       prev->mtx.unlock();
@@ -142,7 +268,7 @@ template <typename T> bool FineGrainList<T>::InsertUnique(T value) {
   }
 
   try {
-    prev->next = new FineGrainNode<T>(std::move(value), prev, nullptr);
+    prev->next = new NodeType(std::move(value), prev, nullptr);
   } catch (...) {
     prev->mtx.unlock();
     return false;
@@ -157,7 +283,8 @@ template <typename T> bool FineGrainList<T>::InsertUnique(T value) {
  * Removes an element from the list if the element is found.
  * @param value The value to remove from the list.
  */
-template <typename T> bool FineGrainList<T>::Remove(T value) noexcept {
+template <typename T, typename TLock, typename TStats>
+bool BasicFineGrainList<T, TLock, TStats>::Remove(T value) noexcept {
   mtx.lock();
   // The list is empty
   if (not head) {
@@ -166,10 +293,11 @@ template <typename T> bool FineGrainList<T>::Remove(T value) noexcept {
   }
 
   head->mtx.lock();
+  TStats::Hop();
   if (value == head->value and not head->next) {
     // The head matches and list only has one item
     head->mtx.unlock();
-    delete head;
+    reclaimer.Retire(head);
     --size;
     head = nullptr;
     mtx.unlock();
@@ -181,7 +309,7 @@ template <typename T> bool FineGrainList<T>::Remove(T value) noexcept {
     if (head)
       head->prev = nullptr;
     node->mtx.unlock();
-    delete node;
+    reclaimer.Retire(node);
     --size;
     mtx.unlock();
     return true;
@@ -194,6 +322,7 @@ template <typename T> bool FineGrainList<T>::Remove(T value) noexcept {
 
   while (curr) {
     curr->mtx.lock();
+    TStats::Hop();
     if (curr->value == value)
       break;
     auto prevmtx = &prev->mtx;
@@ -213,7 +342,7 @@ template <typename T> bool FineGrainList<T>::Remove(T value) noexcept {
       curr->next->prev = prev;
     curr->mtx.unlock();
     prev->mtx.unlock();
-    delete curr;
+    reclaimer.Retire(curr);
     --size;
     return true;
   }
@@ -223,7 +352,8 @@ template <typename T> bool FineGrainList<T>::Remove(T value) noexcept {
  * Removes an element from the list if the element is found.
  * @param value The value to remove from the list.
  */
-template <typename T> bool FineGrainList<T>::Contains(T value) const noexcept {
+template <typename T, typename TLock, typename TStats>
+bool BasicFineGrainList<T, TLock, TStats>::Contains(T value) const noexcept {
   mtx.lock();
 
   if (not head) {
@@ -232,6 +362,7 @@ template <typename T> bool FineGrainList<T>::Contains(T value) const noexcept {
   }
 
   head->mtx.lock();
+  TStats::Hop();
   if (value == head->value) {
     head->mtx.unlock();
     mtx.unlock();
@@ -244,6 +375,7 @@ template <typename T> bool FineGrainList<T>::Contains(T value) const noexcept {
 
   while (curr) {
     curr->mtx.lock();
+    TStats::Hop();
     if (value == curr->value) {
       curr->mtx.unlock();
       prev->mtx.unlock();
@@ -260,7 +392,8 @@ template <typename T> bool FineGrainList<T>::Contains(T value) const noexcept {
   return false;
 }
 
-template <typename T> bool FineGrainList<T>::Find(T &value) const noexcept {
+template <typename T, typename TLock, typename TStats>
+bool BasicFineGrainList<T, TLock, TStats>::Find(T &value) const noexcept {
   mtx.lock();
 
   if (not head) {
@@ -269,6 +402,7 @@ template <typename T> bool FineGrainList<T>::Find(T &value) const noexcept {
   }
 
   head->mtx.lock();
+  TStats::Hop();
   if (value == head->value) {
     value = head->value;
     head->mtx.unlock();
@@ -282,6 +416,7 @@ template <typename T> bool FineGrainList<T>::Find(T &value) const noexcept {
 
   while (curr) {
     curr->mtx.lock();
+    TStats::Hop();
     if (value == curr->value) {
       value = curr->value;
       curr->mtx.unlock();
@@ -302,57 +437,237 @@ template <typename T> bool FineGrainList<T>::Find(T &value) const noexcept {
 /**
  * @return The number of elements in the list.
  */
-template <typename T> unsigned FineGrainList<T>::Size() const noexcept {
+template <typename T, typename TLock, typename TStats>
+unsigned BasicFineGrainList<T, TLock, TStats>::Size() const noexcept {
   return size.load();
 }
 
 /**
  * @return True if the list is empty, false otherwise.
  */
-template <typename T> bool FineGrainList<T>::Empty() const noexcept {
+template <typename T, typename TLock, typename TStats>
+bool BasicFineGrainList<T, TLock, TStats>::Empty() const noexcept {
   return size.load() == 0u;
 }
 
 /**
- * Output stream operator for FineGrainList.
- * @param os The output stream.
- * @param lst The list to be inserted into the output stream.
- * @return A reference to the output stream.
- * @details The format is: (value1,value2,..,valueN).
+ * Inserts a range of values at the front of the list, as if Insert() was
+ * called on each of them in order.
+ * @param first Iterator to the first value to insert.
+ * @param last Iterator past the last value to insert.
+ * @return The number of values inserted.
+ * @details The new nodes are linked to each other before any lock is taken,
+ *  and then spliced in front of the head at once.
  */
-template <typename T>
-std::ostream &operator<<(std::ostream &os, const FineGrainList<T> &lst) {
-  os << '(';
+template <typename T, typename TLock, typename TStats>
+template <typename TIter>
+unsigned BasicFineGrainList<T, TLock, TStats>::InsertRange(TIter first,
+                                                           TIter last) {
+  FineGrainNode<T, TLock> *chainHead = nullptr, *chainTail = nullptr;
+  unsigned n = 0;
+  try {
+    for (; first != last; ++first, ++n) {
+      auto node = new NodeType(*first, nullptr, chainHead);
+      if (chainHead)
+        chainHead->prev = node;
+      else
+        chainTail = node;
+      chainHead = node;
+    }
+  } catch (...) {
+    while (chainHead) {
+      auto node = chainHead;
+      chainHead = chainHead->next;
+      delete node;
+    }
+    throw;
+  }
+
+  if (not n)
+    return 0;
+
+  LockGuard lck(mtx);
+  if (head) {
+    LockGuard headLck(head->mtx);
+    chainTail->next = head;
+    head->prev = chainTail;
+    head = chainHead;
+  } else {
+    head = chainHead;
+  }
+  size += n;
+  return n;
+}
+
+/**
+ * Removes every element that satisfies a predicate.
+ * @param pred The predicate, called with a const reference to each value.
+ * @return The number of elements removed.
+ * @details Matching nodes at the head are removed while the list lock is held,
+ *  and the rest of the list is traversed hand-over-hand, unlinking matching
+ *  nodes while the locks of the node and its predecessor are held.
+ */
+template <typename T, typename TLock, typename TStats>
+template <typename TPred>
+unsigned BasicFineGrainList<T, TLock, TStats>::RemoveIf(TPred pred) noexcept {
+  unsigned removed = 0;
+  mtx.lock();
+
+  while (head) {
+    head->mtx.lock();
+    TStats::Hop();
+    if (not pred(head->value))
+      break;
+    auto node = head;
+    head = head->next;
+    if (head)
+      head->prev = nullptr;
+    node->mtx.unlock();
+    reclaimer.Retire(node);
+    --size;
+    ++removed;
+  }
+
+  if (not head) {
+    mtx.unlock();
+    return removed;
+  }
 
-  lst.mtx.lock();
+  auto prev = head;
+  auto curr = head->next;
+  mtx.unlock();
 
-  if (not lst.head) {
-    lst.mtx.unlock();
-    return os << ')';
+  while (curr) {
+    curr->mtx.lock();
+    TStats::Hop();
+    if (pred(curr->value)) {
+      auto next = curr->next;
+      prev->next = next;
+      if (next)
+        next->prev = prev;
+      curr->mtx.unlock();
+      reclaimer.Retire(curr);
+      --size;
+      ++removed;
+      curr = next;
+    } else {
+      auto prevmtx = &prev->mtx;
+      prev = curr;
+      curr = curr->next;
+      prevmtx->unlock();
+    }
   }
 
-  auto prev = lst.head;
   prev->mtx.unlock();
+  return removed;
+}
 
-  os << prev->value;
+/**
+ * Removes every element whose value is in a set.
+ * @param values The values to remove. Only needs a count() member.
+ * @return The number of elements removed.
+ */
+template <typename T, typename TLock, typename TStats>
+template <typename TSet>
+unsigned
+BasicFineGrainList<T, TLock, TStats>::RemoveAll(const TSet &values) noexcept {
+  return RemoveIf(
+      [&values](const T &value) { return values.count(value) != 0; });
+}
 
-  auto curr = prev->next;
-  lst.mtx.unlock();
+/**
+ * Checks if all the values of a sorted range are in the list.
+ * @param first Iterator to the first value of a sorted random-access range.
+ * @param last Iterator past the last value of the range.
+ * @return True if every value of the range is in the list.
+ */
+template <typename T, typename TLock, typename TStats>
+template <typename TIter>
+bool BasicFineGrainList<T, TLock, TStats>::ContainsAll(
+    TIter first, TIter last) const {
+  SortedRangeMatcher<TIter> matcher(first, last);
+  if (matcher.Done())
+    return true;
+
+  mtx.lock();
+
+  if (not head) {
+    mtx.unlock();
+    return false;
+  }
+
+  head->mtx.lock();
+  TStats::Hop();
+  auto prev = head;
+  auto curr = head->next;
+  mtx.unlock();
+
+  if (matcher.Visit(prev->value)) {
+    prev->mtx.unlock();
+    return true;
+  }
 
   while (curr) {
     curr->mtx.lock();
-    os << ',' << curr->value;
+    TStats::Hop();
     auto prevmtx = &prev->mtx;
     prev = curr;
     curr = curr->next;
     prevmtx->unlock();
+    if (matcher.Visit(prev->value))
+      break;
   }
 
   prev->mtx.unlock();
+  return matcher.Done();
+}
+
+/**
+ * @return An iterator to the first element of the list, which starts a scan
+ *  that lasts until the iterator reaches the end or is destroyed.
+ */
+template <typename T, typename TLock, typename TStats>
+typename BasicFineGrainList<T, TLock, TStats>::const_iterator
+BasicFineGrainList<T, TLock, TStats>::begin() const {
+  reclaimer.StartScan();
+  mtx.lock();
+  auto node = head;
+  mtx.unlock();
+  return const_iterator(this, node);
+}
 
-  os << ')';
+/**
+ * Calls a function on every value in the list. See const_iterator for the
+ * consistency guarantees.
+ * @param fn The function, called with a const reference to each value.
+ */
+template <typename T, typename TLock, typename TStats>
+template <typename TFunc>
+void BasicFineGrainList<T, TLock, TStats>::ForEach(TFunc fn) const {
+  for (auto &value : *this)
+    fn(value);
+}
 
-  return os;
+/**
+ * Output stream operator for FineGrainList.
+ * @param os The output stream.
+ * @param lst The list to be inserted into the output stream.
+ * @return A reference to the output stream.
+ * @details The format is: (value1,value2,..,valueN).
+ */
+template <typename T, typename TLock, typename TStats>
+std::ostream &operator<<(std::ostream &os,
+                         const BasicFineGrainList<T, TLock, TStats> &lst) {
+  os << '(';
+  auto first = lst.begin();
+  auto last = lst.end();
+  if (first != last) {
+    os << *first;
+    ++first;
+  }
+  for (; first != last; ++first)
+    os << ',' << *first;
+  return os << ')';
 }
 
 /**
@@ -370,8 +685,9 @@ std::ostream &operator<<(std::ostream &os, const FineGrainList<T> &lst) {
  *  end, the thread doing the equality check might think that the lists are
  *  equal, even though it might not be true anymore.
  */
-template <typename T>
-bool operator==(const FineGrainList<T> &lhs, const FineGrainList<T> &rhs) {
+template <typename T, typename TLock, typename TStats>
+bool operator==(const BasicFineGrainList<T, TLock, TStats> &lhs,
+                const BasicFineGrainList<T, TLock, TStats> &rhs) {
   if (lhs.size.load() != rhs.size.load())
     return false;
 
@@ -428,7 +744,8 @@ bool operator==(const FineGrainList<T> &lhs, const FineGrainList<T> &rhs) {
  * @param rhs The list on right side.
  * @return True if the lists are not the same, false otherwise.
  */
-template <typename T>
-bool operator!=(const FineGrainList<T> &lhs, const FineGrainList<T> &rhs) {
+template <typename T, typename TLock, typename TStats>
+bool operator!=(const BasicFineGrainList<T, TLock, TStats> &lhs,
+                const BasicFineGrainList<T, TLock, TStats> &rhs) {
   return not(lhs == rhs);
 }
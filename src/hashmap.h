@@ -6,18 +6,29 @@
 
 #pragma once
 
-#include <memory>
+#include <atomic>
 #include <ostream>
 
+#include "bucket_array.h"
+#include "cache_line.h"
 #include "dllist.h"
+#include "list_stats.h"
 
 /**
  * A simple hashmap with very basic operations:
  * - insert (key, value)
  * - remove (key)
  * - has (key)
+ * - iterating over all (key, value) pairs with ForEach()
+ *
+ * The buckets are packed next to each other by default. With
+ * BucketLayout::Padded each bucket gets its own cache lines, which trades
+ * memory for no false sharing between writers to adjacent buckets. TStats is
+ * handed to the bucket lists, so their traversals are counted in the same
+ * ListCounters.
  */
-template <typename K, typename V, template <typename> class TList>
+template <typename K, typename V, template <typename...> class TList,
+          typename TStats = DefaultListStats>
 struct HashMap {
   struct Element {
     K key{};
@@ -41,28 +52,35 @@ struct HashMap {
   };
 
   constexpr static int NUM_BUCKETS = 1000;
-  std::unique_ptr<TList<Element>[]> buckets;
+  BucketArray<TList<Element, TStats>> buckets;
   const size_t nBuckets;
-  unsigned size{0};
   std::hash<K> hasher{};
+  // Written by every insert and remove, so kept off the line of the fields
+  // above, which every operation reads.
+  CacheLinePad pad;
+  std::atomic_uint size{0};
 
   /**
    * Constructs the HashMap with the default number of buckets, 1000.
    */
-  HashMap() : buckets(new TList<Element>[NUM_BUCKETS]), nBuckets(NUM_BUCKETS) {}
+  HashMap() : buckets(NUM_BUCKETS), nBuckets(NUM_BUCKETS) {}
 
   /**
    * Constructs a HashMap with a specified number of buckets.
    * @param nBuckets The number of buckets for the HashMap.
+   * @param layout How the buckets are laid out in memory.
    */
-  HashMap(size_t nBuckets)
-      : buckets(new TList<Element>[nBuckets]), nBuckets(nBuckets) {}
+  HashMap(size_t nBuckets, BucketLayout layout = BucketLayout::Packed)
+      : buckets(nBuckets, layout), nBuckets(nBuckets) {}
 
   bool Insert(K key, V value);
   bool Remove(K key);
   bool Has(K key) const noexcept;
+  bool Find(K key, V &value) const;
+  bool Update(K key, V value);
   unsigned Size() const noexcept;
   V operator[](K key);
+  template <typename TFunc> void ForEach(TFunc fn) const;
 };
 
 /**
@@ -71,8 +89,9 @@ struct HashMap {
  * @param value The value for the key.
  * @return True if the (key, value) pair were inserted into the map.
  */
-template <typename K, typename V, template <typename> class TList>
-bool HashMap<K, V, TList>::Insert(K key, V value) {
+template <typename K, typename V, template <typename...> class TList,
+          typename TStats>
+bool HashMap<K, V, TList, TStats>::Insert(K key, V value) {
   auto &lst = buckets[hasher(key) % nBuckets];
   if (lst.InsertUnique(Element(key, value))) {
     ++size;
@@ -86,8 +105,9 @@ bool HashMap<K, V, TList>::Insert(K key, V value) {
  * @param key The key to look for.
  * @return True if the key is removed from the map, false otherwise.
  */
-template <typename K, typename V, template <typename> class TList>
-bool HashMap<K, V, TList>::Remove(K key) {
+template <typename K, typename V, template <typename...> class TList,
+          typename TStats>
+bool HashMap<K, V, TList, TStats>::Remove(K key) {
   auto &lst = buckets[hasher(key) % nBuckets];
   if (lst.Remove(Element(key))) {
     --size;
@@ -101,16 +121,54 @@ bool HashMap<K, V, TList>::Remove(K key) {
  * @param key The key to look for.
  * @return True if the hash map contains the key, false otherwise.
  */
-template <typename K, typename V, template <typename> class TList>
-bool HashMap<K, V, TList>::Has(K key) const noexcept {
+template <typename K, typename V, template <typename...> class TList,
+          typename TStats>
+bool HashMap<K, V, TList, TStats>::Has(K key) const noexcept {
   return buckets[hasher(key) % nBuckets].Contains(Element(key));
 }
 
+/**
+ * Looks up the value of a key.
+ * @param key The key to look for.
+ * @param value Set to the value of the key if it is found.
+ * @return True if the hash map contains the key, false otherwise.
+ */
+template <typename K, typename V, template <typename...> class TList,
+          typename TStats>
+bool HashMap<K, V, TList, TStats>::Find(K key, V &value) const {
+  Element e(key);
+  if (not buckets[hasher(key) % nBuckets].Find(e))
+    return false;
+  value = e.value;
+  return true;
+}
+
+/**
+ * Replaces the value of a key that is in the map. The buckets can only insert
+ * and remove whole elements, so the old element is removed and a new one is
+ * inserted, and a concurrent lookup may miss the key in between.
+ * @param key The key to look for.
+ * @param value The new value for the key.
+ * @return True if the key was in the map, false otherwise.
+ */
+template <typename K, typename V, template <typename...> class TList,
+          typename TStats>
+bool HashMap<K, V, TList, TStats>::Update(K key, V value) {
+  auto &lst = buckets[hasher(key) % nBuckets];
+  if (not lst.Remove(Element(key)))
+    return false;
+  // Someone else may have inserted the key again in between, and counted it.
+  if (not lst.InsertUnique(Element(key, value)))
+    --size;
+  return true;
+}
+
 /**
  * @return The number of elements in the HashMap.
  */
-template <typename K, typename V, template <typename> class TList>
-unsigned HashMap<K, V, TList>::Size() const noexcept {
+template <typename K, typename V, template <typename...> class TList,
+          typename TStats>
+unsigned HashMap<K, V, TList, TStats>::Size() const noexcept {
   return size;
 }
 
@@ -119,8 +177,9 @@ unsigned HashMap<K, V, TList>::Size() const noexcept {
  * @param key The key to look for.
  * @return Reference to the value, null if there is no such key
  */
-template <typename K, typename V, template <typename> class TList>
-V HashMap<K, V, TList>::operator[](K key) {
+template <typename K, typename V, template <typename...> class TList,
+          typename TStats>
+V HashMap<K, V, TList, TStats>::operator[](K key) {
   Element e(key);
   auto bucket = hasher(key) % nBuckets;
   bool flag = buckets[bucket].Find(e);
@@ -135,14 +194,32 @@ V HashMap<K, V, TList>::operator[](K key) {
   }
 }
 
+/**
+ * Calls a function on every (key, value) pair in the HashMap, one bucket at a
+ * time. It has the same consistency guarantees as iterating over the bucket
+ * lists, so pairs inserted or removed while it runs may or may not be seen.
+ * fn may write to the map, except with buckets that hold a lock for the whole
+ * of their ForEach(), such as CoarseGrainList.
+ * @param fn The function, called as fn(key, value) with const references.
+ */
+template <typename K, typename V, template <typename...> class TList,
+          typename TStats>
+template <typename TFunc>
+void HashMap<K, V, TList, TStats>::ForEach(TFunc fn) const {
+  for (size_t i = 0; i < nBuckets; ++i)
+    buckets[i].ForEach([&fn](const Element &e) { fn(e.key, e.value); });
+}
+
 /**
  * Output stream operator for HashMap.
  * @param os The output stream.
  * @param hm The HashMap to be inserted into the output stream.
  * @return A reference to the output stream.
  */
-template <typename K, typename V, template <typename> class TList>
-std::ostream &operator<<(std::ostream &os, const HashMap<K, V, TList> &hm) {
+template <typename K, typename V, template <typename...> class TList,
+          typename TStats>
+std::ostream &operator<<(std::ostream &os,
+                         const HashMap<K, V, TList, TStats> &hm) {
   os << "{ ";
   for (unsigned i = 0; i < hm.nBuckets; i++) {
     os << "Bucket[" << i << "] -> " << hm.buckets[i] << '\n';
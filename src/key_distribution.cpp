@@ -0,0 +1,102 @@
+/**
+ * @file key_distribution.cpp
+ *
+ * Definitions for the key distributions.
+ */
+
+#include <cmath>
+#include <exception>
+#include <ostream>
+#include <string>
+
+#include "key_distribution.h"
+#include "util.h"
+
+constexpr double DistributionParams::kDefaultTheta;
+
+std::ostream &operator<<(std::ostream &os, const DistributionParams &dp) {
+  switch (dp.type) {
+  case Distribution::Uniform:
+    return os << "uniform";
+  case Distribution::Zipf:
+    return os << "zipf:" << dp.theta;
+  case Distribution::Hotspot:
+    return os << "hotspot:" << dp.hotOps << ',' << dp.hotKeys;
+  case Distribution::Latest:
+    return os << "latest:" << dp.theta;
+  default:
+    return os << "unknown";
+  }
+}
+
+/**
+ * Parses a distribution given as uniform, zipf[:theta], hotspot:x,y, where a
+ * fraction x of the operations go to a fraction y of the keys, or
+ * latest[:theta]. theta must be in (0, 1) and is 0.99 if not given.
+ * @param s The string to parse.
+ * @param dp Set to the distribution parsed.
+ * @return True if s is a valid distribution, false otherwise.
+ */
+bool parseDistribution(const std::string &s, DistributionParams &dp) {
+  auto colon = s.find(':');
+  auto name = toLower(s.substr(0, colon));
+  auto args = split(colon == std::string::npos ? "" : s.substr(colon + 1), ',');
+  dp = DistributionParams();
+  try {
+    if (name == "uniform" and args.empty()) {
+      dp.type = Distribution::Uniform;
+    } else if ((name == "zipf" or name == "latest") and args.size() <= 1) {
+      dp.type = name == "zipf" ? Distribution::Zipf : Distribution::Latest;
+      if (not args.empty())
+        dp.theta = std::stod(args[0]);
+      return dp.theta > 0.0 and dp.theta < 1.0;
+    } else if (name == "hotspot" and args.size() == 2) {
+      dp.type = Distribution::Hotspot;
+      dp.hotOps = std::stod(args[0]);
+      dp.hotKeys = std::stod(args[1]);
+      return dp.hotOps >= 0.0 and dp.hotOps <= 1.0 and dp.hotKeys > 0.0 and
+             dp.hotKeys < 1.0;
+    } else {
+      return false;
+    }
+  } catch (const std::exception &) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Sets up the generator.
+ * @param n The number of ranks.
+ * @param theta The skew, in (0, 1).
+ */
+ZipfGenerator::ZipfGenerator(std::size_t n, double theta)
+    : n(n), theta(theta), alpha(1.0 / (1.0 - theta)), zetan(Zeta(n, theta)),
+      eta((1.0 - std::pow(2.0 / n, 1.0 - theta)) /
+          (1.0 - Zeta(2, theta) / zetan)),
+      halfPowTheta(std::pow(0.5, theta)) {}
+
+/**
+ * @param u A number drawn uniformly from [0, 1).
+ * @return A rank in [0, n), 0 being the most likely.
+ */
+std::size_t ZipfGenerator::operator()(double u) const noexcept {
+  double uz = u * zetan;
+  if (uz < 1.0)
+    return 0;
+  if (uz < 1.0 + halfPowTheta)
+    return 1;
+  auto rank =
+      static_cast<std::size_t>(n * std::pow(eta * u - eta + 1.0, alpha));
+  return rank < n ? rank : n - 1;
+}
+
+/**
+ * @return The generalized harmonic number sum(1 / i^theta) for i in [1, n].
+ */
+double ZipfGenerator::Zeta(std::size_t n, double theta) noexcept {
+  double sum = 0.0;
+  for (std::size_t i = 1; i <= n; ++i)
+    sum += 1.0 / std::pow(static_cast<double>(i), theta);
+  return sum;
+}
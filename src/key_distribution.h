@@ -0,0 +1,57 @@
+/**
+ * @file key_distribution.h
+ *
+ * Distributions for the keys the benchmark operates on.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+/**
+ * How the keys of removals and lookups are chosen:
+ * - Uniform: each thread picks uniformly among the keys it inserted.
+ * - Zipf: keys are drawn from the whole key space, with key i being picked
+ *   with probability proportional to 1 / (i + 1)^theta.
+ * - Hotspot: a fraction of the operations go to a fraction of the key space,
+ *   its first keys, and the rest go uniformly to the other keys.
+ * - Latest: each thread picks among the keys it inserted last, with the
+ *   distance back from its newest key following a Zipfian distribution.
+ */
+enum class Distribution { Uniform, Zipf, Hotspot, Latest };
+
+struct DistributionParams {
+  static constexpr double kDefaultTheta = 0.99;
+  Distribution type{Distribution::Uniform};
+  double theta{kDefaultTheta};
+  double hotOps{0.0};
+  double hotKeys{0.0};
+};
+
+std::ostream &operator<<(std::ostream &os, const DistributionParams &dp);
+
+bool parseDistribution(const std::string &s, DistributionParams &dp);
+
+/**
+ * Draws ranks in [0, n) from a Zipfian distribution, with the method of Gray
+ * et al. in "Quickly Generating Billion-Record Synthetic Databases". Setting
+ * it up takes O(n), but then every draw is a single pow(), so it can run in
+ * the measured loop.
+ */
+struct ZipfGenerator {
+  std::size_t n{0};
+  double theta{0.0};
+  double alpha{0.0};
+  double zetan{0.0};
+  double eta{0.0};
+  double halfPowTheta{0.0};
+
+  ZipfGenerator() = default;
+  ZipfGenerator(std::size_t n, double theta);
+
+  std::size_t operator()(double u) const noexcept;
+
+  static double Zeta(std::size_t n, double theta) noexcept;
+};
@@ -0,0 +1,83 @@
+/**
+ * @file latency_histogram.cpp
+ *
+ * Non-inline definitions for CycleClock and LatencyHistogram.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "latency_histogram.h"
+
+constexpr unsigned LatencyHistogram::kSubBucketBits;
+constexpr unsigned LatencyHistogram::kSubBuckets;
+constexpr unsigned LatencyHistogram::kBuckets;
+
+/**
+ * @return The length of a tick of Now() in nanoseconds. Measured against
+ *  steady_clock the first time it is called, which takes about 10 ms.
+ */
+double CycleClock::NsPerTick() {
+#if defined(__x86_64__) || defined(__i386__)
+  static const double nsPerTick = [] {
+    using namespace std::chrono;
+    auto timeStart = steady_clock::now();
+    auto ticksStart = Now();
+    std::this_thread::sleep_for(milliseconds(10));
+    auto ticks = Now() - ticksStart;
+    auto dur = duration_cast<nanoseconds>(steady_clock::now() - timeStart);
+    return static_cast<double>(dur.count()) / ticks;
+  }();
+  return nsPerTick;
+#else
+  return 1.0;
+#endif
+}
+
+/**
+ * Adds every value recorded in another histogram to this one.
+ * @param other The histogram to add.
+ */
+void LatencyHistogram::Merge(const LatencyHistogram &other) noexcept {
+  for (unsigned i = 0; i < kBuckets; ++i)
+    counts[i] += other.counts[i];
+  count += other.count;
+  if (other.max > max)
+    max = other.max;
+}
+
+/**
+ * @param percentile A percentile between 0 and 100.
+ * @return The highest value that falls in the same bucket as the value at the
+ *  given percentile, but never more than the largest value recorded. 0 if
+ *  nothing was recorded.
+ */
+uint64_t LatencyHistogram::Percentile(double percentile) const noexcept {
+  if (count == 0)
+    return 0;
+  auto rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * count));
+  if (rank == 0)
+    rank = 1;
+  uint64_t seen = 0;
+  for (unsigned i = 0; i < kBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank)
+      return std::min(BucketHighest(i), max);
+  }
+  return max;
+}
+
+/**
+ * @param index A bucket index.
+ * @return The largest value counted in that bucket.
+ */
+uint64_t LatencyHistogram::BucketHighest(unsigned index) noexcept {
+  if (index < kSubBuckets)
+    return index;
+  unsigned shift = index / kSubBuckets - 1;
+  uint64_t lowest = static_cast<uint64_t>(index % kSubBuckets + kSubBuckets)
+                    << shift;
+  return lowest + ((uint64_t{1} << shift) - 1);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file latency_histogram.h
+ *
+ * A cycle counter and a log-bucketed histogram for per-operation latencies.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * The cheapest clock there is. On x86 it reads the time stamp counter, which
+ * ticks at a constant rate on anything recent, and elsewhere it falls back to
+ * steady_clock in nanoseconds. rdtsc is not serializing, so an operation that
+ * takes a few cycles may be measured a little short, which is fine for tail
+ * latencies of operations that take hundreds of cycles at least.
+ */
+struct CycleClock {
+  static uint64_t Now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  static double NsPerTick();
+};
+
+/**
+ * A histogram of latencies in the style of HdrHistogram. Values below
+ * kSubBuckets get a bucket each, and every power of two above that is split
+ * into kSubBuckets linear buckets, so each value is counted with a relative
+ * error of at most 1 / kSubBuckets over the whole 64-bit range. Recording is
+ * a few shifts and an increment, with no allocation, so every worker thread
+ * keeps its own histograms and they are merged once the run is over.
+ */
+struct LatencyHistogram {
+  static constexpr unsigned kSubBucketBits = 5;
+  static constexpr unsigned kSubBuckets = 1u << kSubBucketBits;
+  static constexpr unsigned kBuckets = (65 - kSubBucketBits) * kSubBuckets;
+
+  std::array<uint64_t, kBuckets> counts{};
+  uint64_t count{0};
+  uint64_t max{0};
+
+  void Record(uint64_t value) noexcept {
+    ++counts[BucketIndex(value)];
+    ++count;
+    if (value > max)
+      max = value;
+  }
+
+  void Merge(const LatencyHistogram &other) noexcept;
+  uint64_t Percentile(double percentile) const noexcept;
+
+  static unsigned BucketIndex(uint64_t value) noexcept {
+    if (value < kSubBuckets)
+      return value;
+    unsigned exponent = 63 - __builtin_clzll(value);
+    unsigned shift = exponent - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + (value >> shift) - kSubBuckets;
+  }
+
+  static uint64_t BucketHighest(unsigned index) noexcept;
+};
+
+/**
+ * The latencies of one run, by operation. Updates, scans and read-modify-writes
+ * are only done by the YCSB workloads.
+ */
+struct OpLatencies {
+  LatencyHistogram insert;
+  LatencyHistogram remove;
+  LatencyHistogram lookup;
+  LatencyHistogram update;
+  LatencyHistogram scan;
+  LatencyHistogram readModifyWrite;
+
+  void Merge(const OpLatencies &other) noexcept {
+    insert.Merge(other.insert);
+    remove.Merge(other.remove);
+    lookup.Merge(other.lookup);
+    update.Merge(other.update);
+    scan.Merge(other.scan);
+    readModifyWrite.Merge(other.readModifyWrite);
+  }
+};
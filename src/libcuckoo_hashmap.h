@@ -7,6 +7,7 @@
 #pragma once
 
 #include <ostream>
+#include <utility>
 
 #include <libcuckoo/cuckoohash_map.hh>
 
@@ -35,8 +36,11 @@ template <typename K, typename V> struct LibCuckooHashMap {
   bool Insert(K key, V value);
   bool Remove(K key);
   bool Has(K key) const noexcept;
+  bool Find(K key, V &value) const;
+  bool Update(K key, V value);
   unsigned Size() const noexcept;
   V operator[](K key);
+  template <typename TFunc> void ForEach(TFunc fn) const;
 };
 
 /**
@@ -69,6 +73,28 @@ bool LibCuckooHashMap<K, V>::Has(K key) const noexcept {
   return table.contains(key);
 }
 
+/**
+ * Looks up the value of a key.
+ * @param key The key to look for.
+ * @param value Set to the value of the key if it is found.
+ * @return True if the hash map contains the key, false otherwise.
+ */
+template <typename K, typename V>
+bool LibCuckooHashMap<K, V>::Find(K key, V &value) const {
+  return table.find(key, value);
+}
+
+/**
+ * Replaces the value of a key that is in the map.
+ * @param key The key to look for.
+ * @param value The new value for the key.
+ * @return True if the key was in the map, false otherwise.
+ */
+template <typename K, typename V>
+bool LibCuckooHashMap<K, V>::Update(K key, V value) {
+  return table.update(key, std::move(value));
+}
+
 /**
  * @return The number of elements in the LibCuckooHashMap.
  */
@@ -91,3 +117,17 @@ template <typename K, typename V> V LibCuckooHashMap<K, V>::operator[](K key) {
     return value;
   }
 }
+
+/**
+ * Calls a function on every (key, value) pair in the LibCuckooHashMap. The
+ * whole table is locked while it runs, so this blocks all writers.
+ * @param fn The function, called as fn(key, value) with const references.
+ */
+template <typename K, typename V>
+template <typename TFunc>
+void LibCuckooHashMap<K, V>::ForEach(TFunc fn) const {
+  // Locking the table does not modify its contents.
+  auto lt = const_cast<cuckoohash_map<K, V> &>(table).lock_table();
+  for (const auto &kv : lt)
+    fn(kv.first, kv.second);
+}
@@ -0,0 +1,12 @@
+/**
+ * @file list_stats.cpp
+ *
+ * Definitions for the list statistics policies.
+ */
+
+#include "list_stats.h"
+
+constexpr bool NoListStats::kEnabled;
+constexpr bool CountingListStats::kEnabled;
+
+thread_local ListCounters *ListCounters::current = nullptr;
@@ -0,0 +1,76 @@
+/**
+ * @file list_stats.h
+ *
+ * The statistics policies of the lists and maps. A list calls the static
+ * functions of its TStats policy as it traverses and retries, and the policy
+ * decides what to do with them: NoListStats does nothing, so the calls compile
+ * away, and CountingListStats counts them in ListCounters::current. The
+ * lists take DefaultListStats unless told otherwise, which is NoListStats
+ * unless SYNCH_LIST_STATS is defined, as the LIST_STATS cmake option does.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * What the list operations of a thread did, while it has them counted by
+ * pointing current to them:
+ * - hops: the nodes traversals went past or looked at
+ * - casFailures: the compare-and-swaps that failed
+ * - restarts: the traversals that had to start over from the head
+ * The benchmark divides them by the operations it ran.
+ */
+struct ListCounters {
+  static thread_local ListCounters *current;
+
+  uint64_t hops{0};
+  uint64_t casFailures{0};
+  uint64_t restarts{0};
+
+  void Merge(const ListCounters &other) noexcept {
+    hops += other.hops;
+    casFailures += other.casFailures;
+    restarts += other.restarts;
+  }
+
+  bool Any() const noexcept { return hops or casFailures or restarts; }
+};
+
+/**
+ * The policy that keeps no statistics.
+ */
+struct NoListStats {
+  static constexpr bool kEnabled = false;
+
+  static void Hop() noexcept {}
+  static void CasFailure() noexcept {}
+  static void Restart() noexcept {}
+};
+
+/**
+ * The policy that counts in the counters of the calling thread, if it has
+ * any.
+ */
+struct CountingListStats {
+  static constexpr bool kEnabled = true;
+
+  static void Hop() noexcept {
+    if (auto counters = ListCounters::current)
+      ++counters->hops;
+  }
+  static void CasFailure() noexcept {
+    if (auto counters = ListCounters::current)
+      ++counters->casFailures;
+  }
+  static void Restart() noexcept {
+    if (auto counters = ListCounters::current)
+      ++counters->restarts;
+  }
+};
+
+#ifdef SYNCH_LIST_STATS
+using DefaultListStats = CountingListStats;
+#else
+using DefaultListStats = NoListStats;
+#endif
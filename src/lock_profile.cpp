@@ -0,0 +1,18 @@
+/**
+ * @file lock_profile.cpp
+ *
+ * Definitions for LockStats.
+ */
+
+#include "lock_profile.h"
+
+constexpr bool LockStats::kEnabled;
+
+thread_local LockStats *LockStats::current = nullptr;
+
+void LockStats::Merge(const LockStats &other) noexcept {
+  acquisitions += other.acquisitions;
+  contended += other.contended;
+  wait.Merge(other.wait);
+  hold.Merge(other.hold);
+}
@@ -0,0 +1,133 @@
+/**
+ * @file lock_profile.h
+ *
+ * Opt-in profiling of the locks of the lock-based lists: how often they are
+ * taken, how often a thread had to wait for one, and how long they are waited
+ * for and held. It is only built in with SYNCH_LOCK_PROFILING defined, which
+ * the LOCK_PROFILING cmake option does. Without it Profiled<TLock> is TLock
+ * itself, so the lists are exactly as they would be without profiling.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "latency_histogram.h"
+
+/**
+ * What the locks taken by a thread went through, while it has them recorded
+ * by pointing current to them. Waits are only those of contended
+ * acquisitions, and holds only those of exclusive ones, since readers share
+ * the lock. Times are in CycleClock ticks.
+ */
+struct LockStats {
+#ifdef SYNCH_LOCK_PROFILING
+  static constexpr bool kEnabled = true;
+#else
+  static constexpr bool kEnabled = false;
+#endif
+
+  static thread_local LockStats *current;
+
+  uint64_t acquisitions{0};
+  uint64_t contended{0};
+  LatencyHistogram wait;
+  LatencyHistogram hold;
+
+  void Merge(const LockStats &other) noexcept;
+
+  /**
+   * Counts an acquisition by the calling thread.
+   * @param waitStart When it started waiting, or 0 if it did not have to.
+   * @return When the lock was acquired, or 0 if nothing is recorded.
+   */
+  static uint64_t Acquired(uint64_t waitStart) noexcept {
+    auto stats = current;
+    if (not stats)
+      return 0;
+    auto now = CycleClock::Now();
+    ++stats->acquisitions;
+    if (waitStart) {
+      ++stats->contended;
+      stats->wait.Record(now - waitStart);
+    }
+    return now;
+  }
+
+  /**
+   * Counts the release of an exclusive hold by the calling thread.
+   * @param acquired What Acquired() returned for it.
+   */
+  static void Released(uint64_t acquired) noexcept {
+    auto stats = current;
+    if (stats and acquired)
+      stats->hold.Record(CycleClock::Now() - acquired);
+  }
+};
+
+/**
+ * A lock that records its acquisitions in LockStats::current. Each
+ * acquisition is tried once first, and only if that fails is it contended and
+ * its wait timed. It wraps both Lockable locks, like std::mutex and
+ * FutexLock, and RwLock; only the functions TLock has can be used.
+ */
+template <typename TLock> struct ProfiledLock {
+  TLock inner{};
+  // When the exclusive holder acquired the lock, only used by it.
+  uint64_t acquired{0};
+
+  void lock() {
+    if (inner.try_lock()) {
+      acquired = LockStats::Acquired(0);
+      return;
+    }
+    auto start = CycleClock::Now();
+    inner.lock();
+    acquired = LockStats::Acquired(start);
+  }
+
+  bool try_lock() {
+    if (not inner.try_lock())
+      return false;
+    acquired = LockStats::Acquired(0);
+    return true;
+  }
+
+  void unlock() {
+    LockStats::Released(acquired);
+    inner.unlock();
+  }
+
+  void ReadLock() noexcept {
+    if (inner.TryReadLock()) {
+      LockStats::Acquired(0);
+      return;
+    }
+    auto start = CycleClock::Now();
+    inner.ReadLock();
+    LockStats::Acquired(start);
+  }
+
+  void ReadUnlock() noexcept { inner.ReadUnlock(); }
+
+  void WriteLock() noexcept {
+    if (inner.TryWriteLock()) {
+      acquired = LockStats::Acquired(0);
+      return;
+    }
+    auto start = CycleClock::Now();
+    inner.WriteLock();
+    acquired = LockStats::Acquired(start);
+  }
+
+  void WriteUnlock() noexcept {
+    LockStats::Released(acquired);
+    inner.WriteUnlock();
+  }
+};
+
+#ifdef SYNCH_LOCK_PROFILING
+template <typename TLock> using Profiled = ProfiledLock<TLock>;
+#else
+template <typename TLock> using Profiled = TLock;
+#endif
@@ -0,0 +1,608 @@
+/**
+ * @file lockfree_dllist.h
+ *
+ * A lockfree doubly linked list, after Sundell and Tsigas.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <ostream>
+
+#include "list_stats.h"
+
+template <typename T> struct LockFreeDlNode {
+  T value;
+  std::atomic<LockFreeDlNode *> prev;
+  std::atomic<LockFreeDlNode *> next;
+  // Link in the list of removed nodes, which are freed with the list.
+  LockFreeDlNode *retiredNext;
+
+  /**
+   * Default ctor. Initalizes everything to default or nullptr.
+   */
+  LockFreeDlNode()
+      : value(), prev(nullptr), next(nullptr), retiredNext(nullptr) {}
+
+  /**
+   * Initializes node with specific value, and sets prev/next to nullptr.
+   * @param value The value to initialize the node with.
+   */
+  LockFreeDlNode(T value)
+      : value(value), prev(nullptr), next(nullptr), retiredNext(nullptr) {}
+};
+
+/**
+ * A lockfree doubly linked list, following "Lock-free deques and doubly linked
+ * lists" by Sundell and Tsigas. Both links of a node carry a deletion mark in
+ * their low bit, like LockFreeList. A node is deleted by first marking its next
+ * link and then its prev link, after which any thread that runs into it helps
+ * to unlink it. The prev links are only hints that are fixed lazily by
+ * CorrectPrev(), which makes it possible to walk backwards without locks.
+ *
+ * The set-like operations used by the benchmark are:
+ * - Insert(): inserts a value at the front of the list
+ * - InsertUnique(): appends a value only if it is not in the list already.
+ *   It is only unique with respect to other calls to InsertUnique().
+ * - Remove(): remove a value from the list
+ * - Contains(): Checks if a value is in the list
+ * - Size(): Returns the size of the list
+ *
+ * A Cursor gives bidirectional traversal, and InsertBefore(), InsertAfter()
+ * and Remove() at the position of the cursor. For read-only scans there is
+ * also a forward const_iterator and ForEach(), which do not help with deletes.
+ *
+ * Removed nodes are kept in a retired list and freed when the list is
+ * destroyed, so a node a thread holds a pointer to is never freed under it.
+ * There is no reclamation while the list is alive: its memory grows with
+ * every Remove(), and a --duration run with removals grows without bound.
+ * The memory the benchmark reports for it counts the retired nodes, so its
+ * bytes per element go up with the removals of the run. The benchmark builds
+ * a new list for every repeat, which frees them between repeats.
+ */
+template <typename T, typename TStats = DefaultListStats>
+struct LockFreeDlList {
+  using NodeType = LockFreeDlNode<T>;
+
+  /**
+   * A bidirectional cursor into the list. A cursor starts at the head sentinel,
+   * so Next() has to be called once to move to the first element.
+   */
+  struct Cursor {
+    LockFreeDlList *list;
+    NodeType *node;
+
+    bool Next() noexcept { return list->Next(node); }
+    bool Prev() noexcept { return list->Prev(node); }
+    const T &Value() const noexcept { return node->value; }
+    bool InsertBefore(T value) { return list->InsertBefore(node, value); }
+    bool InsertAfter(T value) { return list->InsertAfter(node, value); }
+    bool Remove() noexcept { return list->Delete(node); }
+    bool AtHead() const noexcept { return node == list->head; }
+    bool AtTail() const noexcept { return node == list->tail; }
+  };
+
+  /**
+   * A forward iterator that skips deleted nodes without writing to the list.
+   * The iteration is weakly consistent: every element that is in the list for
+   * the whole iteration is seen exactly once, and elements inserted or removed
+   * concurrently may or may not be seen.
+   */
+  struct const_iterator {
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    NodeType *node;
+    NodeType *tail;
+
+    reference operator*() const noexcept { return node->value; }
+    pointer operator->() const noexcept { return &node->value; }
+    const_iterator &operator++() noexcept {
+      node = skip_deleted(get_unmarked(node->next.load()), tail);
+      return *this;
+    }
+    const_iterator operator++(int) noexcept {
+      auto it = *this;
+      ++*this;
+      return it;
+    }
+    bool operator==(const const_iterator &it) const noexcept {
+      return node == it.node;
+    }
+    bool operator!=(const const_iterator &it) const noexcept {
+      return node != it.node;
+    }
+  };
+
+  NodeType *head;
+  NodeType *tail;
+  std::atomic_uint size{0};
+  std::atomic<NodeType *> retired{nullptr};
+
+  LockFreeDlList();
+  ~LockFreeDlList();
+  bool Insert(T value);
+  bool InsertUnique(T value);
+  bool Remove(T value) noexcept;
+  bool Contains(T value) const noexcept;
+  bool Find(T &value) const noexcept;
+  unsigned Size() const noexcept;
+  bool Empty() const noexcept;
+  Cursor Begin() noexcept;
+  Cursor End() noexcept;
+  const_iterator begin() const noexcept;
+  const_iterator end() const noexcept { return {tail, tail}; }
+  template <typename TFunc> void ForEach(TFunc fn) const;
+
+  bool InsertBefore(NodeType *&cursor, T value);
+  bool InsertAfter(NodeType *&cursor, T value);
+  bool Delete(NodeType *node) noexcept;
+  bool Next(NodeType *&cursor) const noexcept;
+  bool Prev(NodeType *&cursor) const noexcept;
+  NodeType *CorrectPrev(NodeType *prev, NodeType *node) const noexcept;
+  void Retire(NodeType *node) noexcept;
+
+  static bool is_marked(NodeType *);
+  static NodeType *get_marked(NodeType *);
+  static NodeType *get_unmarked(NodeType *);
+  static void set_mark(std::atomic<NodeType *> &link) noexcept;
+  static NodeType *skip_deleted(NodeType *node, NodeType *tail) noexcept;
+};
+
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::is_marked(NodeType *addr) {
+  return 0x1 & (long)addr;
+}
+
+template <typename T, typename TStats>
+LockFreeDlNode<T> *LockFreeDlList<T, TStats>::get_marked(NodeType *addr) {
+  return (NodeType *)((long)addr | 0x01);
+}
+
+template <typename T, typename TStats>
+LockFreeDlNode<T> *LockFreeDlList<T, TStats>::get_unmarked(NodeType *addr) {
+  return (NodeType *)((long)addr & ~0x01);
+}
+
+/**
+ * Sets the deletion mark on a link, keeping the pointer it holds.
+ * @param link The link to mark.
+ */
+template <typename T, typename TStats>
+void LockFreeDlList<T, TStats>::set_mark(
+    std::atomic<NodeType *> &link) noexcept {
+  auto addr = link.load();
+  while (!is_marked(addr) &&
+         !link.compare_exchange_weak(addr, get_marked(addr)))
+    ;
+}
+
+/**
+ * @param node A node in the list.
+ * @param tail The tail of the list.
+ * @return The first node from node onwards that is not deleted, or tail if
+ *  there is none.
+ */
+template <typename T, typename TStats>
+LockFreeDlNode<T> *
+LockFreeDlList<T, TStats>::skip_deleted(NodeType *node,
+                                        NodeType *tail) noexcept {
+  while (node != tail && is_marked(node->next.load()))
+    node = get_unmarked(node->next.load());
+  return node;
+}
+
+/**
+ * Initializes the list.
+ */
+template <typename T, typename TStats>
+LockFreeDlList<T, TStats>::LockFreeDlList() {
+  head = new NodeType();
+  tail = new NodeType();
+  head->next = tail;
+  tail->prev = head;
+}
+
+/**
+ * Destroys the list. Nodes that are still linked but marked as deleted are
+ * also in the retired list, so they are only freed from there.
+ */
+template <typename T, typename TStats>
+LockFreeDlList<T, TStats>::~LockFreeDlList() {
+  auto node = head;
+  while (node) {
+    auto next = node->next.load();
+    if (!is_marked(next))
+      delete node;
+    node = get_unmarked(next);
+  }
+  node = retired.load();
+  while (node) {
+    auto next = node->retiredNext;
+    delete node;
+    node = next;
+  }
+}
+
+/**
+ * Moves the cursor to the next node that is not deleted, helping to unlink
+ * deleted nodes along the way.
+ * @param cursor The node to move from.
+ * @return True if the cursor moved to an element, false if it reached the tail.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::Next(NodeType *&cursor) const noexcept {
+  while (1) {
+    if (cursor == tail)
+      return false;
+    auto next = get_unmarked(cursor->next.load());
+    auto deleted = is_marked(next->next.load());
+    if (deleted && cursor->next.load() != get_marked(next)) {
+      set_mark(next->prev);
+      auto expected = next;
+      if (!cursor->next.compare_exchange_strong(
+              expected, get_unmarked(next->next.load())))
+        TStats::CasFailure();
+      continue;
+    }
+    TStats::Hop();
+    cursor = next;
+    if (!deleted && next != tail)
+      return true;
+  }
+}
+
+/**
+ * Moves the cursor to the previous node that is not deleted.
+ * @param cursor The node to move from.
+ * @return True if the cursor moved to an element, false if it reached the head.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::Prev(NodeType *&cursor) const noexcept {
+  while (1) {
+    if (cursor == head)
+      return false;
+    auto prev = get_unmarked(cursor->prev.load());
+    if (prev->next.load() == cursor && !is_marked(cursor->next.load())) {
+      cursor = prev;
+      if (prev != head)
+        return true;
+    } else if (is_marked(cursor->next.load())) {
+      Next(cursor);
+    } else {
+      CorrectPrev(prev, cursor);
+    }
+  }
+}
+
+/**
+ * Makes the prev link of a node point to its actual predecessor, unlinking any
+ * deleted nodes found between the two.
+ * @param prev A node that was at some point before node in the list.
+ * @param node The node whose prev link is fixed.
+ * @return The last predecessor seen of node.
+ */
+template <typename T, typename TStats>
+LockFreeDlNode<T> *
+LockFreeDlList<T, TStats>::CorrectPrev(NodeType *prev,
+                                       NodeType *node) const noexcept {
+  NodeType *lastlink = nullptr;
+  while (1) {
+    auto link1 = node->prev.load();
+    if (is_marked(link1))
+      break;
+    auto prev2 = prev->next.load();
+    if (is_marked(prev2)) {
+      // prev is being deleted
+      if (lastlink) {
+        set_mark(prev->prev);
+        auto expected = prev;
+        lastlink->next.compare_exchange_strong(expected, get_unmarked(prev2));
+        prev = lastlink;
+        lastlink = nullptr;
+        continue;
+      }
+      prev = get_unmarked(prev->prev.load());
+      continue;
+    }
+    if (prev2 != node) {
+      if (!prev2)
+        break;
+      lastlink = prev;
+      prev = prev2;
+      continue;
+    }
+    if (node->prev.compare_exchange_strong(link1, prev)) {
+      if (is_marked(prev->prev.load()))
+        continue;
+      break;
+    }
+    TStats::CasFailure();
+  }
+  return prev;
+}
+
+/**
+ * Inserts a value before the node at the cursor, and moves the cursor to the
+ * new node.
+ * @param cursor The node to insert before.
+ * @param value The value to insert into the list.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::InsertBefore(NodeType *&cursor, T value) {
+  if (cursor == head)
+    return InsertAfter(cursor, value);
+  auto node = new NodeType(value);
+  NodeType *prev;
+  while (1) {
+    while (is_marked(cursor->next.load()))
+      Next(cursor);
+    prev = get_unmarked(cursor->prev.load());
+    node->prev = prev;
+    node->next = cursor;
+    auto expected = cursor;
+    if (prev->next.compare_exchange_strong(expected, node))
+      break;
+    TStats::CasFailure();
+    if (is_marked(cursor->next.load()))
+      continue;
+    CorrectPrev(prev, cursor);
+  }
+  auto next = cursor;
+  cursor = node;
+  CorrectPrev(prev, next);
+  size++;
+  return true;
+}
+
+/**
+ * Inserts a value after the node at the cursor, and moves the cursor to the
+ * new node.
+ * @param cursor The node to insert after.
+ * @param value The value to insert into the list.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::InsertAfter(NodeType *&cursor, T value) {
+  if (cursor == tail)
+    return InsertBefore(cursor, value);
+  auto node = new NodeType(value);
+  auto prev = cursor;
+  NodeType *next;
+  while (1) {
+    next = get_unmarked(prev->next.load());
+    node->prev = prev;
+    node->next = next;
+    auto expected = next;
+    if (cursor->next.compare_exchange_strong(expected, node))
+      break;
+    TStats::CasFailure();
+    if (is_marked(cursor->next.load())) {
+      delete node;
+      return InsertBefore(cursor, value);
+    }
+  }
+  cursor = node;
+  CorrectPrev(prev, next);
+  size++;
+  return true;
+}
+
+/**
+ * Deletes a node from the list.
+ * @param node The node to delete.
+ * @return True if this call deleted the node, false if it was a sentinel or
+ *  somebody else deleted it first.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::Delete(NodeType *node) noexcept {
+  if (node == head || node == tail)
+    return false;
+  while (1) {
+    auto link1 = node->next.load();
+    if (is_marked(link1))
+      return false;
+    if (node->next.compare_exchange_weak(link1, get_marked(link1))) {
+      NodeType *link2;
+      while (1) {
+        link2 = node->prev.load();
+        if (is_marked(link2) ||
+            node->prev.compare_exchange_weak(link2, get_marked(link2)))
+          break;
+      }
+      CorrectPrev(get_unmarked(link2), link1);
+      size--;
+      Retire(node);
+      return true;
+    }
+    TStats::CasFailure();
+  }
+}
+
+/**
+ * Adds a deleted node to the list of nodes that are freed with the list.
+ * @param node The deleted node.
+ */
+template <typename T, typename TStats>
+void LockFreeDlList<T, TStats>::Retire(NodeType *node) noexcept {
+  node->retiredNext = retired.load();
+  while (!retired.compare_exchange_weak(node->retiredNext, node))
+    ;
+}
+
+/**
+ * Inserts an element into the list at the front of the list.
+ * @param value The value to insert into the list.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::Insert(T value) {
+  auto cursor = head;
+  return InsertAfter(cursor, value);
+}
+
+/**
+ * Appends an item only if the list does not cotain the item.
+ * @param value The value to insert into the list.
+ * @return True if the value was inserted, false otherwise.
+ * @details The node is linked in with a CAS on the next link of the last node,
+ *  expecting the tail. If anything was appended or the last node was deleted
+ *  since the list was scanned, the CAS fails and the scan starts over.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::InsertUnique(T value) {
+  NodeType *node = nullptr;
+  while (1) {
+    auto last = head;
+    auto cursor = head;
+    while (Next(cursor)) {
+      if (value == cursor->value) {
+        delete node;
+        return false;
+      }
+      last = cursor;
+    }
+    if (!node)
+      node = new NodeType(value);
+    node->prev = last;
+    node->next = tail;
+    auto expected = tail;
+    if (last->next.compare_exchange_strong(expected, node)) {
+      CorrectPrev(last, tail);
+      size++;
+      return true;
+    }
+    TStats::CasFailure();
+    TStats::Restart();
+  }
+}
+
+/**
+ * Removes an element from the list if the element is found.
+ * @param value The value to remove from the list.
+ * @return True if the value was found, false otherwise.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::Remove(T value) noexcept {
+  auto cursor = head;
+  while (Next(cursor)) {
+    if (value == cursor->value && Delete(cursor))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Checks if an element exists in the list
+ * @param value The value to look for in the list.
+ * @return True if the value was found, false otherwise.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::Contains(T value) const noexcept {
+  auto node = get_unmarked(head->next.load());
+  while (node != tail) {
+    TStats::Hop();
+    if (value == node->value && !is_marked(node->next.load()))
+      return true;
+    node = get_unmarked(node->next.load());
+  }
+  return false;
+}
+
+/**
+ * Checks if an element exists in the list
+ * @param value The value to look for in the list.
+ * @return True if the value was found, false otherwise.
+ * Overwrites value with the values of the element found.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::Find(T &value) const noexcept {
+  auto node = get_unmarked(head->next.load());
+  while (node != tail) {
+    TStats::Hop();
+    if (value == node->value && !is_marked(node->next.load())) {
+      value = node->value;
+      return true;
+    }
+    node = get_unmarked(node->next.load());
+  }
+  return false;
+}
+
+/**
+ * @return The number of elements in the list.
+ */
+template <typename T, typename TStats>
+unsigned LockFreeDlList<T, TStats>::Size() const noexcept {
+  return size;
+}
+
+/**
+ * @return True if the list is empty, false otherwise.
+ */
+template <typename T, typename TStats>
+bool LockFreeDlList<T, TStats>::Empty() const noexcept {
+  return size == 0u;
+}
+
+/**
+ * @return A cursor positioned at the head sentinel.
+ */
+template <typename T, typename TStats>
+typename LockFreeDlList<T, TStats>::Cursor
+LockFreeDlList<T, TStats>::Begin() noexcept {
+  return {this, head};
+}
+
+/**
+ * @return A cursor positioned at the tail sentinel.
+ */
+template <typename T, typename TStats>
+typename LockFreeDlList<T, TStats>::Cursor
+LockFreeDlList<T, TStats>::End() noexcept {
+  return {this, tail};
+}
+
+/**
+ * @return An iterator to the first element of the list that is not deleted.
+ */
+template <typename T, typename TStats>
+typename LockFreeDlList<T, TStats>::const_iterator
+LockFreeDlList<T, TStats>::begin() const noexcept {
+  return {skip_deleted(get_unmarked(head->next.load()), tail), tail};
+}
+
+/**
+ * Calls a function on every value in the list. See const_iterator for the
+ * consistency guarantees.
+ * @param fn The function, called with a const reference to each value.
+ */
+template <typename T, typename TStats>
+template <typename TFunc>
+void LockFreeDlList<T, TStats>::ForEach(TFunc fn) const {
+  for (auto &value : *this)
+    fn(value);
+}
+
+/**
+ * Output stream operator.
+ * @param os The output stream.
+ * @param lst The list to be inserted into the output stream.
+ * @return A reference to the output stream.
+ * @details The format is: (value1,value2,..,valueN).
+ */
+template <typename T, typename TStats>
+std::ostream &operator<<(std::ostream &os,
+                         const LockFreeDlList<T, TStats> &lst) {
+  os << '(';
+  auto first = lst.begin();
+  auto last = lst.end();
+  if (first != last)
+    os << *first++;
+  for (; first != last; ++first)
+    os << ',' << *first;
+  return os << ')';
+}
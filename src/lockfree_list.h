@@ -7,9 +7,14 @@
 #pragma once
 
 #include <atomic>
-#include <mutex>
+#include <cstddef>
+#include <iterator>
 #include <ostream>
 
+#include "cache_line.h"
+#include "list_stats.h"
+#include "sorted_range.h"
+
 template <typename T> struct LockFreeNode {
   T value;
   std::atomic<LockFreeNode *> prev;
@@ -51,14 +56,64 @@ template <typename T> struct LockFreeNode {
  * - Remove(): remove a value from the list
  * - Contains(): Checks if a value is in the list
  * - Size(): Returns the size of the list
+ * - InsertRange(), RemoveIf(), RemoveAll() and ContainsAll(): bulk operations
+ *   done in a single traversal
+ * - begin()/end() and ForEach(): lockfree iteration over the elements
+ *
+ * Memory orders: a node is published by the CAS that links it in, which is a
+ * release, and every load of a next pointer is an acquire, so a thread that
+ * reaches a node sees its value. Unlinking CASes are releases too, since the
+ * thread that unlinks passes on nodes it reached through its own acquires.
+ * Stores to nodes that are not published yet are relaxed, and so is size,
+ * which is only a statistic and orders nothing. On x86 this turns the seq_cst
+ * stores into plain moves; the CASes stay locked instructions.
  */
-template <typename T> struct LockFreeList {
+template <typename T, typename TStats = DefaultListStats> struct LockFreeList {
+  /**
+   * A forward iterator that skips logically deleted nodes without taking any
+   * locks. Removed nodes are never freed while the list is alive, so it stays
+   * valid under concurrent writers. The iteration is weakly consistent: every
+   * element that is in the list for the whole iteration is seen exactly once,
+   * and elements inserted or removed concurrently may or may not be seen.
+   * Elements are inserted at the front, so inserts that start after the
+   * iteration are never seen.
+   */
+  struct const_iterator {
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    LockFreeNode<T> *node;
+    LockFreeNode<T> *tail;
+
+    reference operator*() const noexcept { return node->value; }
+    pointer operator->() const noexcept { return &node->value; }
+    const_iterator &operator++() noexcept {
+      node = skip_deleted(
+          get_unmarked(node->next.load(std::memory_order_acquire)), tail);
+      return *this;
+    }
+    const_iterator operator++(int) noexcept {
+      auto it = *this;
+      ++*this;
+      return it;
+    }
+    bool operator==(const const_iterator &it) const noexcept {
+      return node == it.node;
+    }
+    bool operator!=(const const_iterator &it) const noexcept {
+      return node != it.node;
+    }
+  };
+
   LockFreeNode<T> *head;
   LockFreeNode<T> *tail;
+  // head and tail are read by every operation, while size is written by every
+  // insert and remove.
+  CacheLinePad pad;
   std::atomic_uint size{0};
-  // for printing the list
-  using LockGuard = std::lock_guard<std::mutex>;
-  mutable std::mutex mtx;
 
   LockFreeList();
   ~LockFreeList();
@@ -70,33 +125,61 @@ template <typename T> struct LockFreeList {
   virtual unsigned Size() const noexcept;
   virtual bool Empty() const noexcept;
 
+  template <typename TIter> unsigned InsertRange(TIter first, TIter last);
+  template <typename TPred> unsigned RemoveIf(TPred pred) noexcept;
+  template <typename TSet> unsigned RemoveAll(const TSet &values) noexcept;
+  template <typename TIter>
+  bool ContainsAll(TIter first, TIter last) const;
+
+  const_iterator begin() const noexcept;
+  const_iterator end() const noexcept { return {tail, tail}; }
+  template <typename TFunc> void ForEach(TFunc fn) const;
+
   LockFreeNode<T> *search(T value, LockFreeNode<T> **left_node) const;
   static bool is_marked(LockFreeNode<T> *);
   static LockFreeNode<T> *get_marked(LockFreeNode<T> *);
   static LockFreeNode<T> *get_unmarked(LockFreeNode<T> *);
+  static LockFreeNode<T> *skip_deleted(LockFreeNode<T> *, LockFreeNode<T> *);
 };
 
-template <typename T> bool LockFreeList<T>::is_marked(LockFreeNode<T> *addr) {
+template <typename T, typename TStats>
+bool LockFreeList<T, TStats>::is_marked(LockFreeNode<T> *addr) {
   return 0x1 & (long)addr;
 }
 
-template <typename T>
-LockFreeNode<T> *LockFreeList<T>::get_marked(LockFreeNode<T> *addr) {
+template <typename T, typename TStats>
+LockFreeNode<T> *LockFreeList<T, TStats>::get_marked(LockFreeNode<T> *addr) {
   return (LockFreeNode<T> *)((long)addr | 0x01);
 }
 
-template <typename T>
-LockFreeNode<T> *LockFreeList<T>::get_unmarked(LockFreeNode<T> *addr) {
+template <typename T, typename TStats>
+LockFreeNode<T> *LockFreeList<T, TStats>::get_unmarked(LockFreeNode<T> *addr) {
   return (LockFreeNode<T> *)((long)addr & ~0x01);
 }
 
-template <typename T>
-LockFreeNode<T> *LockFreeList<T>::search(T value,
-                                         LockFreeNode<T> **left_node) const {
-  LockFreeNode<T> *left_node_nxt, *right_node;
+/**
+ * @param node A node in the list.
+ * @param tail The tail of the list.
+ * @return The first node from node onwards that is not logically deleted, or
+ *  tail if there is none.
+ */
+template <typename T, typename TStats>
+LockFreeNode<T> *LockFreeList<T, TStats>::skip_deleted(LockFreeNode<T> *node,
+                                                       LockFreeNode<T> *tail) {
+  LockFreeNode<T> *next;
+  while (node != tail &&
+         is_marked(next = node->next.load(std::memory_order_acquire)))
+    node = get_unmarked(next);
+  return node;
+}
+
+template <typename T, typename TStats>
+LockFreeNode<T> *
+LockFreeList<T, TStats>::search(T value, LockFreeNode<T> **left_node) const {
+  LockFreeNode<T> *left_node_nxt = nullptr, *right_node;
   while (1) {
     LockFreeNode<T> *node = head;
-    LockFreeNode<T> *node_nxt = head->next;
+    LockFreeNode<T> *node_nxt = head->next.load(std::memory_order_acquire);
 
     while (1) {
       if (!is_marked(node_nxt)) {
@@ -108,7 +191,8 @@ LockFreeNode<T> *LockFreeList<T>::search(T value,
       if (node == tail) {
         break;
       }
-      node_nxt = node->next;
+      TStats::Hop();
+      node_nxt = node->next.load(std::memory_order_acquire);
       if (!is_marked(node_nxt) && node->value == value) {
         break;
       }
@@ -118,32 +202,35 @@ LockFreeNode<T> *LockFreeList<T>::search(T value,
     if (left_node_nxt == right_node) {
       return right_node;
     } else {
-      if (std::atomic_compare_exchange_weak(&(*left_node)->next,
-                                            (LockFreeNode<T> **)&left_node_nxt,
-                                            right_node)) {
+      if ((*left_node)->next.compare_exchange_weak(
+              left_node_nxt, right_node, std::memory_order_release,
+              std::memory_order_relaxed)) {
         return right_node;
       }
+      TStats::CasFailure();
     }
+    TStats::Restart();
   }
 }
 
 /**
  * Initializes the list.
  */
-template <typename T> LockFreeList<T>::LockFreeList() {
+template <typename T, typename TStats> LockFreeList<T, TStats>::LockFreeList() {
   head = new LockFreeNode<T>();
   tail = new LockFreeNode<T>();
-  head->next = tail;
+  head->next.store(tail, std::memory_order_relaxed);
 }
 
 /**
  * Destroys the list.
  */
-template <typename T> LockFreeList<T>::~LockFreeList() {
+template <typename T, typename TStats>
+LockFreeList<T, TStats>::~LockFreeList() {
   auto node = head;
   while (node) {
     auto prev = node;
-    node = get_unmarked(node->next);
+    node = get_unmarked(node->next.load(std::memory_order_relaxed));
     delete prev;
   }
 }
@@ -152,12 +239,18 @@ template <typename T> LockFreeList<T>::~LockFreeList() {
  * Inserts an element into the list at the front of the list.
  * @param value The value to insert into the list.
  */
-template <typename T> bool LockFreeList<T>::Insert(T value) {
-  LockFreeNode<T> *new_node = new LockFreeNode<T>(value, head->next, nullptr);
-  while (!std::atomic_compare_exchange_weak(
-      &head->next, (LockFreeNode<T> **)&new_node->next, new_node))
-    ;
-  size++;
+template <typename T, typename TStats>
+bool LockFreeList<T, TStats>::Insert(T value) {
+  LockFreeNode<T> *new_node = new LockFreeNode<T>(value);
+  LockFreeNode<T> *first = head->next.load(std::memory_order_relaxed);
+  new_node->next.store(first, std::memory_order_relaxed);
+  while (!head->next.compare_exchange_weak(first, new_node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    TStats::CasFailure();
+    new_node->next.store(first, std::memory_order_relaxed);
+  }
+  size.fetch_add(1, std::memory_order_relaxed);
   return true;
 }
 
@@ -166,7 +259,8 @@ template <typename T> bool LockFreeList<T>::Insert(T value) {
  * @param value The value to insert into the list.
  * @return True if the value was inserted, false otherwise.
  */
-template <typename T> bool LockFreeList<T>::InsertUnique(T value) {
+template <typename T, typename TStats>
+bool LockFreeList<T, TStats>::InsertUnique(T value) {
   LockFreeNode<T> *right_node, *left_node;
   LockFreeNode<T> *new_node = new LockFreeNode<T>(value, nullptr, nullptr);
   while (1) {
@@ -174,12 +268,15 @@ template <typename T> bool LockFreeList<T>::InsertUnique(T value) {
     if (right_node != tail) {
       return false;
     } else {
-      new_node->next = right_node;
-      if (std::atomic_compare_exchange_weak(
-              &left_node->next, (LockFreeNode<T> **)&right_node, new_node)) {
-        size++;
+      new_node->next.store(right_node, std::memory_order_relaxed);
+      if (left_node->next.compare_exchange_weak(right_node, new_node,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+        size.fetch_add(1, std::memory_order_relaxed);
         return true;
       }
+      TStats::CasFailure();
+      TStats::Restart();
     }
   }
 }
@@ -189,28 +286,33 @@ template <typename T> bool LockFreeList<T>::InsertUnique(T value) {
  * @param value The value to remove from the list.
  * @return True if the value was found, false otherwise.
  */
-template <typename T> bool LockFreeList<T>::Remove(T value) noexcept {
+template <typename T, typename TStats>
+bool LockFreeList<T, TStats>::Remove(T value) noexcept {
   LockFreeNode<T> *right_node, *left_node, *right_node_next;
   while (1) {
     right_node = search(value, &left_node);
     if ((right_node == tail) || (right_node->value != value)) {
       return false;
     }
-    right_node_next = right_node->next;
+    right_node_next = right_node->next.load(std::memory_order_acquire);
     if (!is_marked(right_node_next)) {
       // logically delete node
-      if (std::atomic_compare_exchange_weak(
-              &right_node->next, (LockFreeNode<T> **)&right_node_next,
-              get_marked(right_node_next))) {
-        size--;
+      if (right_node->next.compare_exchange_weak(
+              right_node_next, get_marked(right_node_next),
+              std::memory_order_relaxed, std::memory_order_relaxed)) {
+        size.fetch_sub(1, std::memory_order_relaxed);
         break;
       }
+      TStats::CasFailure();
     }
+    TStats::Restart();
   }
   // physically delete node
-  if (!std::atomic_compare_exchange_weak(&(left_node->next),
-                                         (LockFreeNode<T> **)&right_node,
-                                         right_node_next)) {
+  if (!left_node->next.compare_exchange_weak(right_node, right_node_next,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+    TStats::CasFailure();
+    TStats::Restart();
     search(value, &left_node);
   }
   return true;
@@ -221,13 +323,16 @@ template <typename T> bool LockFreeList<T>::Remove(T value) noexcept {
  * @param value The value to look for in the list.
  * @return True if the value was found, false otherwise.
  */
-template <typename T> bool LockFreeList<T>::Contains(T value) const noexcept {
-  auto node = get_unmarked(head->next);
+template <typename T, typename TStats>
+bool LockFreeList<T, TStats>::Contains(T value) const noexcept {
+  auto node = get_unmarked(head->next.load(std::memory_order_acquire));
   while (node != tail) {
-    if (value == node->value && !is_marked(node->next)) {
+    TStats::Hop();
+    auto next = node->next.load(std::memory_order_acquire);
+    if (value == node->value && !is_marked(next)) {
       return true;
     }
-    node = get_unmarked(node->next);
+    node = get_unmarked(next);
   }
   return false;
 }
@@ -238,64 +343,196 @@ template <typename T> bool LockFreeList<T>::Contains(T value) const noexcept {
  * @return True if the value was found, false otherwise.
  * Overwrites value with the values of the element found.
  */
-template <typename T> bool LockFreeList<T>::Find(T &value) const noexcept {
-  auto node = get_unmarked(head->next);
+template <typename T, typename TStats>
+bool LockFreeList<T, TStats>::Find(T &value) const noexcept {
+  auto node = get_unmarked(head->next.load(std::memory_order_acquire));
   while (node != tail) {
-    if (value == node->value && !is_marked(node->next)) {
+    TStats::Hop();
+    auto next = node->next.load(std::memory_order_acquire);
+    if (value == node->value && !is_marked(next)) {
       value = node->value;
       return true;
     }
-    node = get_unmarked(node->next);
+    node = get_unmarked(next);
   }
   return false;
 }
 
+/**
+ * Inserts a range of values at the front of the list, as if Insert() was
+ * called on each of them in order.
+ * @param first Iterator to the first value to insert.
+ * @param last Iterator past the last value to insert.
+ * @return The number of values inserted.
+ * @details The new nodes are linked to each other first, and then the whole
+ *  chain is published with a single CAS on head->next.
+ */
+template <typename T, typename TStats>
+template <typename TIter>
+unsigned LockFreeList<T, TStats>::InsertRange(TIter first, TIter last) {
+  LockFreeNode<T> *chainHead = nullptr, *chainTail = nullptr;
+  unsigned n = 0;
+  for (; first != last; ++first, ++n) {
+    auto node = new LockFreeNode<T>(*first, nullptr, chainHead);
+    if (!chainHead)
+      chainTail = node;
+    chainHead = node;
+  }
+  if (!n)
+    return 0;
+
+  LockFreeNode<T> *expected = head->next.load(std::memory_order_relaxed);
+  chainTail->next.store(expected, std::memory_order_relaxed);
+  while (!head->next.compare_exchange_weak(expected, chainHead,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    TStats::CasFailure();
+    chainTail->next.store(expected, std::memory_order_relaxed);
+  }
+  size.fetch_add(n, std::memory_order_relaxed);
+  return n;
+}
+
+/**
+ * Removes every element that satisfies a predicate.
+ * @param pred The predicate, called with a const reference to each value.
+ * @return The number of elements removed.
+ * @details Matching nodes are logically deleted as they are found, and runs of
+ *  deleted nodes are physically unlinked behind the traversal, in the same way
+ *  search() does.
+ */
+template <typename T, typename TStats>
+template <typename TPred>
+unsigned LockFreeList<T, TStats>::RemoveIf(TPred pred) noexcept {
+  unsigned removed = 0;
+  LockFreeNode<T> *left_node = head;
+  LockFreeNode<T> *left_node_nxt = head->next.load(std::memory_order_acquire);
+  LockFreeNode<T> *node = left_node_nxt;
+  while (node != tail) {
+    TStats::Hop();
+    LockFreeNode<T> *node_nxt = node->next.load(std::memory_order_acquire);
+    if (!is_marked(node_nxt) && pred(node->value)) {
+      // logically delete node, unless somebody else beats us to it
+      while (!is_marked(node_nxt)) {
+        if (node->next.compare_exchange_weak(node_nxt, get_marked(node_nxt),
+                                             std::memory_order_relaxed,
+                                             std::memory_order_acquire)) {
+          size.fetch_sub(1, std::memory_order_relaxed);
+          removed++;
+          node_nxt = get_marked(node_nxt);
+        } else {
+          TStats::CasFailure();
+        }
+      }
+    }
+    if (is_marked(node_nxt)) {
+      node = get_unmarked(node_nxt);
+      continue;
+    }
+    if (left_node_nxt != node &&
+        !left_node->next.compare_exchange_strong(left_node_nxt, node,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed))
+      TStats::CasFailure();
+    left_node = node;
+    left_node_nxt = node_nxt;
+    node = node_nxt;
+  }
+  if (left_node_nxt != tail &&
+      !left_node->next.compare_exchange_strong(left_node_nxt, tail,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed))
+    TStats::CasFailure();
+  return removed;
+}
+
+/**
+ * Removes every element whose value is in a set.
+ * @param values The values to remove. Only needs a count() member.
+ * @return The number of elements removed.
+ */
+template <typename T, typename TStats>
+template <typename TSet>
+unsigned LockFreeList<T, TStats>::RemoveAll(const TSet &values) noexcept {
+  return RemoveIf(
+      [&values](const T &value) { return values.count(value) != 0; });
+}
+
+/**
+ * Checks if all the values of a sorted range are in the list.
+ * @param first Iterator to the first value of a sorted random-access range.
+ * @param last Iterator past the last value of the range.
+ * @return True if every value of the range is in the list.
+ */
+template <typename T, typename TStats>
+template <typename TIter>
+bool LockFreeList<T, TStats>::ContainsAll(TIter first, TIter last) const {
+  SortedRangeMatcher<TIter> matcher(first, last);
+  auto node = get_unmarked(head->next.load(std::memory_order_acquire));
+  while (node != tail && !matcher.Done()) {
+    TStats::Hop();
+    auto next = node->next.load(std::memory_order_acquire);
+    if (!is_marked(next))
+      matcher.Visit(node->value);
+    node = get_unmarked(next);
+  }
+  return matcher.Done();
+}
+
 /**
  * @return The number of elements in the list.
  */
-template <typename T> unsigned LockFreeList<T>::Size() const noexcept {
-  return size;
+template <typename T, typename TStats>
+unsigned LockFreeList<T, TStats>::Size() const noexcept {
+  return size.load(std::memory_order_relaxed);
 }
 
 /**
  * @return True if the list is empty, false otherwise.
  */
-template <typename T> bool LockFreeList<T>::Empty() const noexcept {
-  return size == 0u;
+template <typename T, typename TStats>
+bool LockFreeList<T, TStats>::Empty() const noexcept {
+  return size.load(std::memory_order_relaxed) == 0u;
+}
+
+/**
+ * @return An iterator to the first element of the list that is not deleted.
+ */
+template <typename T, typename TStats>
+typename LockFreeList<T, TStats>::const_iterator
+LockFreeList<T, TStats>::begin() const noexcept {
+  return {skip_deleted(
+              get_unmarked(head->next.load(std::memory_order_acquire)), tail),
+          tail};
+}
+
+/**
+ * Calls a function on every value in the list. See const_iterator for the
+ * consistency guarantees.
+ * @param fn The function, called with a const reference to each value.
+ */
+template <typename T, typename TStats>
+template <typename TFunc>
+void LockFreeList<T, TStats>::ForEach(TFunc fn) const {
+  for (auto &value : *this)
+    fn(value);
 }
 
 /**
  * Output stream operator.
  * @param os The output stream.
- * @param dlList The list to be inserted into the output stream.
+ * @param lst The list to be inserted into the output stream.
  * @return A reference to the output stream.
  * @details The format is: (value1,value2,..,valueN).
  */
-template <typename T>
-std::ostream &operator<<(std::ostream &os, const LockFreeList<T> &dlList) {
-  using LockGuard = typename LockFreeList<T>::LockGuard;
-  LockGuard lck(dlList.mtx);
-  os << "(";
-  auto node = LockFreeList<T>::get_unmarked(dlList.head->next);
-  while (node != dlList.tail) {
-    if (!LockFreeList<T>::is_marked(node->next)) {
-      os << node->value;
-      break;
-    }
-    node = LockFreeList<T>::get_unmarked(node->next);
-  }
-  if (node == dlList.tail) {
-    os << ')';
-    return os;
-  }
-
-  node = LockFreeList<T>::get_unmarked(node->next);
-  while (node != dlList.tail) {
-    if (!LockFreeList<T>::is_marked(node->next)) {
-      os << ',' << node->value;
-    }
-    node = LockFreeList<T>::get_unmarked(node->next);
-  }
-  os << ')';
-  return os;
+template <typename T, typename TStats>
+std::ostream &operator<<(std::ostream &os, const LockFreeList<T, TStats> &lst) {
+  os << '(';
+  auto first = lst.begin();
+  auto last = lst.end();
+  if (first != last)
+    os << *first++;
+  for (; first != last; ++first)
+    os << ',' << *first;
+  return os << ')';
 }
@@ -0,0 +1,183 @@
+/**
+ * @file memory_accounting.cpp
+ *
+ * The counting operator new and delete, and the reading of the counts and of
+ * the peak RSS.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "allocator.h"
+#include "cache_line.h"
+#include "memory_accounting.h"
+
+namespace {
+
+constexpr size_t kSlots = 256;
+
+/**
+ * The counts of the threads that share a slot. Each thread counts in its own
+ * slot, so counting does not bounce a cache line between threads, and the
+ * slots are only added up when a snapshot is taken.
+ */
+struct CountSlot {
+  std::atomic<uint64_t> allocations;
+  std::atomic<uint64_t> frees;
+  std::atomic<uint64_t> bytesAllocated;
+  std::atomic<uint64_t> bytesFreed;
+  CacheLinePad pad;
+};
+
+// Zero-initialized before anything runs, so allocations made during static
+// initialization are counted too.
+CountSlot slots[kSlots];
+std::atomic<size_t> nextSlot{0};
+
+CountSlot &threadSlot() noexcept {
+  // A plain integer, so the first allocation of a thread does not have to
+  // allocate to set it up.
+  static thread_local size_t slot = kSlots;
+  if (slot == kSlots)
+    slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % kSlots;
+  return slots[slot];
+}
+
+void *countedMalloc(size_t bytes) noexcept {
+  void *ptr = allocate(bytes);
+  if (ptr)
+    countAllocation(allocatedSize(ptr));
+  return ptr;
+}
+
+void countedFree(void *ptr) noexcept {
+  if (not ptr)
+    return;
+  countFree(allocatedSize(ptr));
+  deallocate(ptr);
+}
+
+} // anonymous namespace
+
+void *operator new(size_t bytes) {
+  if (auto ptr = countedMalloc(bytes))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t bytes) { return operator new(bytes); }
+
+void *operator new(size_t bytes, const std::nothrow_t &) noexcept {
+  return countedMalloc(bytes);
+}
+
+void *operator new[](size_t bytes, const std::nothrow_t &) noexcept {
+  return countedMalloc(bytes);
+}
+
+void operator delete(void *ptr) noexcept { countedFree(ptr); }
+
+void operator delete[](void *ptr) noexcept { countedFree(ptr); }
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  countedFree(ptr);
+}
+
+/**
+ * @return The counts of all threads so far.
+ */
+MemorySnapshot MemorySnapshot::Take() noexcept {
+  MemorySnapshot snapshot;
+  for (auto &slot : slots) {
+    snapshot.allocations += slot.allocations.load(std::memory_order_relaxed);
+    snapshot.frees += slot.frees.load(std::memory_order_relaxed);
+    snapshot.bytesAllocated +=
+        slot.bytesAllocated.load(std::memory_order_relaxed);
+    snapshot.bytesFreed += slot.bytesFreed.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+/**
+ * Counts an allocation of the calling thread.
+ * @param bytes Its size.
+ */
+void countAllocation(size_t bytes) noexcept {
+  auto &slot = threadSlot();
+  slot.allocations.fetch_add(1, std::memory_order_relaxed);
+  slot.bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/**
+ * Counts a free of the calling thread.
+ * @param bytes The size of the allocation freed.
+ */
+void countFree(size_t bytes) noexcept {
+  auto &slot = threadSlot();
+  slot.frees.fetch_add(1, std::memory_order_relaxed);
+  slot.bytesFreed.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/**
+ * @param ptr Memory from operator new or allocate(), or nullptr.
+ * @return The bytes counted for it.
+ */
+size_t allocatedSize(const void *ptr) noexcept {
+  return allocationSize(ptr);
+}
+
+/**
+ * Resets the peak RSS of the process to its current RSS, where the kernel
+ * allows it, so that peakRss() covers what happens from now on.
+ */
+void resetPeakRss() noexcept {
+  if (auto file = std::fopen("/proc/self/clear_refs", "w")) {
+    std::fputs("5", file);
+    std::fclose(file);
+  }
+}
+
+/**
+ * @return The peak RSS of the process in bytes, since it started or since
+ *  the last resetPeakRss(), or 0 if it cannot be read.
+ */
+uint64_t peakRss() noexcept {
+  uint64_t kib = 0;
+  if (auto file = std::fopen("/proc/self/status", "r")) {
+    char line[256];
+    while (std::fgets(line, sizeof(line), file))
+      if (std::strncmp(line, "VmHWM:", 6) == 0)
+        kib = std::strtoull(line + 6, nullptr, 10);
+    std::fclose(file);
+  }
+  return kib * 1024;
+}
+
+/**
+ * Adds a repeat.
+ * @param built The counts before the structure was built.
+ * @param runStart The counts when the run started.
+ * @param runEnd The counts when it ended.
+ * @param elements The elements in the structure at the end.
+ * @param ops The operations of the run.
+ * @param otherBytes What was allocated between built and runStart for
+ *  something other than the structure and is still live.
+ */
+void MemoryUsage::Add(const MemorySnapshot &built,
+                      const MemorySnapshot &runStart,
+                      const MemorySnapshot &runEnd, size_t elements,
+                      uint64_t ops, size_t otherBytes) noexcept {
+  peakRss = std::max(peakRss, ::peakRss());
+  liveBytes = runEnd.LiveBytes() - built.LiveBytes() - otherBytes;
+  this->elements = elements;
+  allocations += runEnd.allocations - runStart.allocations;
+  frees += runEnd.frees - runStart.frees;
+  this->ops += ops;
+}
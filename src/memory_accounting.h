@@ -0,0 +1,100 @@
+/**
+ * @file memory_accounting.h
+ *
+ * Counts of the memory the process allocates, kept by the replacements of the
+ * global operator new and delete and by CountingAllocator, and the peak
+ * resident set size.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/**
+ * What had been allocated and freed by some point, over all threads. Bytes
+ * are as the allocator hands them out, so they include the rounding up malloc
+ * does but not its bookkeeping.
+ */
+struct MemorySnapshot {
+  uint64_t allocations{0};
+  uint64_t frees{0};
+  uint64_t bytesAllocated{0};
+  uint64_t bytesFreed{0};
+
+  static MemorySnapshot Take() noexcept;
+
+  int64_t LiveBytes() const noexcept { return bytesAllocated - bytesFreed; }
+};
+
+void countAllocation(size_t bytes) noexcept;
+void countFree(size_t bytes) noexcept;
+size_t allocatedSize(const void *ptr) noexcept;
+
+void resetPeakRss() noexcept;
+uint64_t peakRss() noexcept;
+
+/**
+ * The memory use of a structure at one thread count, over its repeats: the
+ * highest peak RSS of the process, the bytes the structure held and how many
+ * elements it had at the end of the last repeat, and the allocations and
+ * frees the operations of all repeats did, preloading left out.
+ */
+struct MemoryUsage {
+  uint64_t peakRss{0};
+  int64_t liveBytes{0};
+  uint64_t elements{0};
+  uint64_t allocations{0};
+  uint64_t frees{0};
+  uint64_t ops{0};
+
+  void Add(const MemorySnapshot &built, const MemorySnapshot &runStart,
+           const MemorySnapshot &runEnd, size_t elements, uint64_t ops,
+           size_t otherBytes) noexcept;
+
+  double BytesPerElement() const noexcept {
+    return elements ? static_cast<double>(liveBytes) / elements : 0.0;
+  }
+  double AllocationsPerOp() const noexcept {
+    return ops ? static_cast<double>(allocations) / ops : 0.0;
+  }
+};
+
+/**
+ * Counts the memory of a structure whose allocator does not go through
+ * operator new, while still getting it from its own allocator TBase.
+ */
+template <typename T, template <typename> class TBase>
+struct CountingAllocator : TBase<T> {
+  using value_type = T;
+  template <typename U> struct rebind {
+    using other = CountingAllocator<U, TBase>;
+  };
+
+  CountingAllocator() = default;
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U, TBase> &other) noexcept
+      : TBase<T>(other) {}
+
+  T *allocate(size_t n) {
+    countAllocation(n * sizeof(T));
+    return TBase<T>::allocate(n);
+  }
+  void deallocate(T *ptr, size_t n) {
+    countFree(n * sizeof(T));
+    TBase<T>::deallocate(ptr, n);
+  }
+};
+
+template <typename T, typename U, template <typename> class TBase>
+bool operator==(const CountingAllocator<T, TBase> &,
+                const CountingAllocator<U, TBase> &) noexcept {
+  return true;
+}
+
+template <typename T, typename U, template <typename> class TBase>
+bool operator!=(const CountingAllocator<T, TBase> &,
+                const CountingAllocator<U, TBase> &) noexcept {
+  return false;
+}
@@ -7,10 +7,21 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
+#include <iterator>
 #include <mutex>
+#include <ostream>
+
+#include "list_stats.h"
+#include "lock_profile.h"
+#include "scan_reclaimer.h"
+#include "sorted_range.h"
 
 /**
- * A reader-writer non-blocking lock.
+ * A reader-writer non-blocking lock. counter is the number of readers holding
+ * the lock, or -1 while a writer holds it. Taking the lock is an acquire and
+ * releasing it a release, which is all a lock needs; spinning while the lock is
+ * taken only has to read the counter, so it is relaxed.
  */
 struct RwLock {
   std::atomic_int counter{0};
@@ -18,31 +29,53 @@ struct RwLock {
   void ReadLock() noexcept {
     int val, old;
     do {
-      while ((val = counter.load()) < 0)
+      while ((val = counter.load(std::memory_order_relaxed)) < 0)
         ;
       old = val++;
-    } while (not counter.compare_exchange_weak(old, val));
+    } while (not counter.compare_exchange_weak(old, val,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed));
+  }
+
+  bool TryReadLock() noexcept {
+    int val = counter.load(std::memory_order_relaxed);
+    return val >= 0 and
+           counter.compare_exchange_strong(val, val + 1,
+                                           std::memory_order_acquire,
+                                           std::memory_order_relaxed);
   }
 
-  void ReadUnlock() noexcept { --counter; }
+  void ReadUnlock() noexcept {
+    counter.fetch_sub(1, std::memory_order_release);
+  }
 
   void WriteLock() noexcept {
     int val, old;
     do {
-      while ((val = counter.load()) != 0)
+      while ((val = counter.load(std::memory_order_relaxed)) != 0)
         ;
       old = val--;
-    } while (not counter.compare_exchange_weak(old, val));
+    } while (not counter.compare_exchange_weak(old, val,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed));
   }
 
-  void WriteUnlock() noexcept { ++counter; }
+  bool TryWriteLock() noexcept {
+    int val = 0;
+    return counter.compare_exchange_strong(val, -1, std::memory_order_acquire,
+                                           std::memory_order_relaxed);
+  }
+
+  void WriteUnlock() noexcept {
+    counter.fetch_add(1, std::memory_order_release);
+  }
 };
 
 template <typename T> struct NonBlockingNode {
   T value{};
   NonBlockingNode *prev{nullptr};
   NonBlockingNode *next{nullptr};
-  mutable RwLock lck{};
+  mutable Profiled<RwLock> lck{};
 
   /**
    * Initializes node with a specific value.
@@ -74,12 +107,105 @@ template <typename T> struct NonBlockingNode {
  * - inserting at the front of the list
  * - removing from anywhere in the list
  * - and finding elements
+ * - bulk inserts, removals and lookups done in a single hand-over-hand
+ *   traversal
+ * - iterating over the elements
  */
-template <typename T> struct NonBlockingList {
+template <typename T, typename TStats = DefaultListStats>
+struct NonBlockingList {
+  /**
+   * A single-pass iterator that copies the value and the next link of a node
+   * under the node's read lock, and lets go of it before the value is used,
+   * like the iterator of BasicFineGrainList. No lock is held between
+   * increments, so the iterating thread may modify the list, and the scan of
+   * the list's ScanReclaimer keeps the node it points to from being freed. It
+   * is weakly consistent: every element that is in the list for the whole
+   * iteration is seen exactly once, and elements inserted or removed
+   * concurrently may or may not be seen.
+   */
+  struct const_iterator {
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    const NonBlockingList *list;
+    NonBlockingNode<T> *node;
+    NonBlockingNode<T> *next;
+    T value;
+
+    const_iterator() noexcept : list(nullptr), node(nullptr), next(nullptr) {}
+    /**
+     * Starts at a node, in a scan that has been started on the list.
+     * @param list The list.
+     * @param node The first node, or nullptr to end the scan at once.
+     */
+    const_iterator(const NonBlockingList *list, NonBlockingNode<T> *node)
+        : list(list), node(nullptr), next(node) {
+      try {
+        ++*this;
+      } catch (...) {
+        list->reclaimer.EndScan();
+        throw;
+      }
+    }
+    const_iterator(const_iterator &&it) noexcept
+        : list(it.list), node(it.node), next(it.next),
+          value(std::move(it.value)) {
+      it.node = nullptr;
+    }
+    const_iterator &operator=(const_iterator &&it) noexcept {
+      if (this != &it) {
+        if (node)
+          list->reclaimer.EndScan();
+        list = it.list;
+        node = it.node;
+        next = it.next;
+        value = std::move(it.value);
+        it.node = nullptr;
+      }
+      return *this;
+    }
+    const_iterator(const const_iterator &it) = delete;
+    const_iterator &operator=(const const_iterator &it) = delete;
+    ~const_iterator() {
+      if (node)
+        list->reclaimer.EndScan();
+    }
+
+    reference operator*() const noexcept { return value; }
+    pointer operator->() const noexcept { return &value; }
+    const_iterator &operator++() {
+      node = next;
+      if (not node) {
+        list->reclaimer.EndScan();
+        return *this;
+      }
+      node->lck.ReadLock();
+      try {
+        value = node->value;
+      } catch (...) {
+        node->lck.ReadUnlock();
+        throw;
+      }
+      next = node->next;
+      node->lck.ReadUnlock();
+      return *this;
+    }
+    bool operator==(const const_iterator &it) const noexcept {
+      return node == it.node;
+    }
+    bool operator!=(const const_iterator &it) const noexcept {
+      return node != it.node;
+    }
+  };
+
   using NodeType = NonBlockingNode<T>;
   NonBlockingNode<T> *head{nullptr};
   std::atomic_uint size{0};
-  mutable RwLock lck{};
+  mutable Profiled<RwLock> lck{};
+  mutable ScanReclaimer<NodeType> reclaimer;
 
   ~NonBlockingList();
   NonBlockingNode<T> *Insert(T value);
@@ -89,13 +215,24 @@ template <typename T> struct NonBlockingList {
   bool Find(T &value) const noexcept;
   unsigned Size() const noexcept;
   bool Empty() const noexcept;
+
+  template <typename TIter> unsigned InsertRange(TIter first, TIter last);
+  template <typename TPred> unsigned RemoveIf(TPred pred) noexcept;
+  template <typename TSet> unsigned RemoveAll(const TSet &values) noexcept;
+  template <typename TIter>
+  bool ContainsAll(TIter first, TIter last) const;
+
+  const_iterator begin() const;
+  const_iterator end() const noexcept { return const_iterator(); }
+  template <typename TFunc> void ForEach(TFunc fn) const;
 };
 
 /**
  * Destroys the list. Since the list is being destroyed, we just lock the whole
  * list to prevent other threads from getting access to any part of the list.
  */
-template <typename T> NonBlockingList<T>::~NonBlockingList() {
+template <typename T, typename TStats>
+NonBlockingList<T, TStats>::~NonBlockingList() {
   lck.WriteLock();
   auto node = head;
   while (node) {
@@ -111,7 +248,8 @@ template <typename T> NonBlockingList<T>::~NonBlockingList() {
  * Inserts an element into the list at the front of the list.
  * @param value The value to insert into the list.
  */
-template <typename T> NonBlockingNode<T> *NonBlockingList<T>::Insert(T value) {
+template <typename T, typename TStats>
+NonBlockingNode<T> *NonBlockingList<T, TStats>::Insert(T value) {
   NodeType *node;
   lck.WriteLock();
   // The list is empty
@@ -149,7 +287,8 @@ template <typename T> NonBlockingNode<T> *NonBlockingList<T>::Insert(T value) {
  * @param value The value to insert into the list.
  * @return True if the value was inserted, false otherwise.
  */
-template <typename T> bool NonBlockingList<T>::InsertUnique(T value) {
+template <typename T, typename TStats>
+bool NonBlockingList<T, TStats>::InsertUnique(T value) {
   lck.WriteLock();
 
   if (not head) {
@@ -166,11 +305,13 @@ template <typename T> bool NonBlockingList<T>::InsertUnique(T value) {
 
   auto prev = head;
   prev->lck.WriteLock();
+  TStats::Hop();
   auto curr = prev->next;
   lck.WriteUnlock();
 
   while (curr) {
     curr->lck.WriteLock();
+    TStats::Hop();
     if (prev->value == value) {
       curr->lck.WriteUnlock();
       prev->lck.WriteUnlock();
@@ -203,7 +344,8 @@ template <typename T> bool NonBlockingList<T>::InsertUnique(T value) {
  * Removes an element from the list if the element is found.
  * @param value The value to remove from the list.
  */
-template <typename T> bool NonBlockingList<T>::Remove(T value) noexcept {
+template <typename T, typename TStats>
+bool NonBlockingList<T, TStats>::Remove(T value) noexcept {
   lck.WriteLock();
   // The list is empty
   if (not head) {
@@ -212,6 +354,7 @@ template <typename T> bool NonBlockingList<T>::Remove(T value) noexcept {
   }
 
   head->lck.WriteLock();
+  TStats::Hop();
   if (value == head->value and not head->next) {
     // The head matches and list only has one item
     auto node = head;
@@ -219,7 +362,7 @@ template <typename T> bool NonBlockingList<T>::Remove(T value) noexcept {
     lck.WriteUnlock();
     --size;
     node->lck.WriteUnlock();
-    delete node;
+    reclaimer.Retire(node);
     return true;
   } else if (value == head->value) {
     // The head matches but list has more than one item
@@ -230,7 +373,7 @@ template <typename T> bool NonBlockingList<T>::Remove(T value) noexcept {
     lck.WriteUnlock();
     --size;
     node->lck.WriteUnlock();
-    delete node;
+    reclaimer.Retire(node);
     return true;
   }
 
@@ -241,6 +384,7 @@ template <typename T> bool NonBlockingList<T>::Remove(T value) noexcept {
 
   while (curr) {
     curr->lck.WriteLock();
+    TStats::Hop();
     if (curr->value == value)
       break;
     auto prevlck = &prev->lck;
@@ -261,7 +405,7 @@ template <typename T> bool NonBlockingList<T>::Remove(T value) noexcept {
     curr->lck.WriteUnlock();
     prev->lck.WriteUnlock();
     --size;
-    delete curr;
+    reclaimer.Retire(curr);
     return true;
   }
 }
@@ -270,8 +414,8 @@ template <typename T> bool NonBlockingList<T>::Remove(T value) noexcept {
  * Removes an element from the list if the element is found.
  * @param value The value to remove from the list.
  */
-template <typename T>
-bool NonBlockingList<T>::Contains(T value) const noexcept {
+template <typename T, typename TStats>
+bool NonBlockingList<T, TStats>::Contains(T value) const noexcept {
   lck.ReadLock();
 
   if (not head) {
@@ -280,6 +424,7 @@ bool NonBlockingList<T>::Contains(T value) const noexcept {
   }
 
   head->lck.ReadLock();
+  TStats::Hop();
   if (value == head->value) {
     head->lck.ReadUnlock();
     lck.ReadUnlock();
@@ -292,6 +437,7 @@ bool NonBlockingList<T>::Contains(T value) const noexcept {
 
   while (curr) {
     curr->lck.ReadLock();
+    TStats::Hop();
     if (value == curr->value) {
       curr->lck.ReadUnlock();
       prev->lck.ReadUnlock();
@@ -308,7 +454,8 @@ bool NonBlockingList<T>::Contains(T value) const noexcept {
   return false;
 }
 
-template <typename T> bool NonBlockingList<T>::Find(T &value) const noexcept {
+template <typename T, typename TStats>
+bool NonBlockingList<T, TStats>::Find(T &value) const noexcept {
   lck.ReadLock();
 
   if (not head) {
@@ -317,6 +464,7 @@ template <typename T> bool NonBlockingList<T>::Find(T &value) const noexcept {
   }
 
   head->lck.ReadLock();
+  TStats::Hop();
   if (value == head->value) {
     value = head->value;
     head->lck.ReadUnlock();
@@ -330,6 +478,7 @@ template <typename T> bool NonBlockingList<T>::Find(T &value) const noexcept {
 
   while (curr) {
     curr->lck.ReadLock();
+    TStats::Hop();
     if (value == curr->value) {
       value = head->value;
       curr->lck.ReadUnlock();
@@ -350,57 +499,237 @@ template <typename T> bool NonBlockingList<T>::Find(T &value) const noexcept {
 /**
  * @return The number of elements in the list.
  */
-template <typename T> unsigned NonBlockingList<T>::Size() const noexcept {
+template <typename T, typename TStats>
+unsigned NonBlockingList<T, TStats>::Size() const noexcept {
   return size.load();
 }
 
 /**
  * @return True if the list is empty, false otherwise.
  */
-template <typename T> bool NonBlockingList<T>::Empty() const noexcept {
+template <typename T, typename TStats>
+bool NonBlockingList<T, TStats>::Empty() const noexcept {
   return size.load() == 0u;
 }
 
 /**
- * Output stream operator for NonBlockingList.
- * @param os The output stream.
- * @param lst The list to be inserted into the output stream.
- * @return A reference to the output stream.
- * @details The format is: (value1,value2,..,valueN).
+ * Inserts a range of values at the front of the list, as if Insert() was
+ * called on each of them in order.
+ * @param first Iterator to the first value to insert.
+ * @param last Iterator past the last value to insert.
+ * @return The number of values inserted.
+ * @details The new nodes are linked to each other before any lock is taken,
+ *  and then spliced in front of the head at once.
  */
-template <typename T>
-std::ostream &operator<<(std::ostream &os, const NonBlockingList<T> &lst) {
-  os << '(';
+template <typename T, typename TStats>
+template <typename TIter>
+unsigned NonBlockingList<T, TStats>::InsertRange(TIter first, TIter last) {
+  NodeType *chainHead = nullptr, *chainTail = nullptr;
+  unsigned n = 0;
+  try {
+    for (; first != last; ++first, ++n) {
+      auto node = new NodeType(*first, nullptr, chainHead);
+      if (chainHead)
+        chainHead->prev = node;
+      else
+        chainTail = node;
+      chainHead = node;
+    }
+  } catch (...) {
+    while (chainHead) {
+      auto node = chainHead;
+      chainHead = chainHead->next;
+      delete node;
+    }
+    throw;
+  }
 
-  lst.lck.ReadLock();
+  if (not n)
+    return 0;
 
-  if (not lst.head) {
-    lst.lck.ReadUnlock();
-    return os << ')';
+  lck.WriteLock();
+  if (head) {
+    head->lck.WriteLock();
+    auto oldHead = head;
+    chainTail->next = head;
+    head->prev = chainTail;
+    head = chainHead;
+    oldHead->lck.WriteUnlock();
+  } else {
+    head = chainHead;
   }
+  size += n;
+  lck.WriteUnlock();
+  return n;
+}
 
-  auto prev = lst.head;
-  prev->lck.ReadLock();
+/**
+ * Removes every element that satisfies a predicate.
+ * @param pred The predicate, called with a const reference to each value.
+ * @return The number of elements removed.
+ * @details Matching nodes at the head are removed while the list lock is held,
+ *  and the rest of the list is traversed hand-over-hand, unlinking matching
+ *  nodes while the locks of the node and its predecessor are held.
+ */
+template <typename T, typename TStats>
+template <typename TPred>
+unsigned NonBlockingList<T, TStats>::RemoveIf(TPred pred) noexcept {
+  unsigned removed = 0;
+  lck.WriteLock();
 
-  os << prev->value;
+  while (head) {
+    head->lck.WriteLock();
+    TStats::Hop();
+    if (not pred(head->value))
+      break;
+    auto node = head;
+    head = head->next;
+    if (head)
+      head->prev = nullptr;
+    node->lck.WriteUnlock();
+    reclaimer.Retire(node);
+    --size;
+    ++removed;
+  }
 
-  auto curr = prev->next;
-  lst.lck.ReadUnlock();
+  if (not head) {
+    lck.WriteUnlock();
+    return removed;
+  }
+
+  auto prev = head;
+  auto curr = head->next;
+  lck.WriteUnlock();
+
+  while (curr) {
+    curr->lck.WriteLock();
+    TStats::Hop();
+    if (pred(curr->value)) {
+      auto next = curr->next;
+      prev->next = next;
+      if (next)
+        next->prev = prev;
+      curr->lck.WriteUnlock();
+      reclaimer.Retire(curr);
+      --size;
+      ++removed;
+      curr = next;
+    } else {
+      auto prevlck = &prev->lck;
+      prev = curr;
+      curr = curr->next;
+      prevlck->WriteUnlock();
+    }
+  }
+
+  prev->lck.WriteUnlock();
+  return removed;
+}
+
+/**
+ * Removes every element whose value is in a set.
+ * @param values The values to remove. Only needs a count() member.
+ * @return The number of elements removed.
+ */
+template <typename T, typename TStats>
+template <typename TSet>
+unsigned NonBlockingList<T, TStats>::RemoveAll(const TSet &values) noexcept {
+  return RemoveIf(
+      [&values](const T &value) { return values.count(value) != 0; });
+}
+
+/**
+ * Checks if all the values of a sorted range are in the list.
+ * @param first Iterator to the first value of a sorted random-access range.
+ * @param last Iterator past the last value of the range.
+ * @return True if every value of the range is in the list.
+ */
+template <typename T, typename TStats>
+template <typename TIter>
+bool NonBlockingList<T, TStats>::ContainsAll(TIter first, TIter last) const {
+  SortedRangeMatcher<TIter> matcher(first, last);
+  if (matcher.Done())
+    return true;
+
+  lck.ReadLock();
+
+  if (not head) {
+    lck.ReadUnlock();
+    return false;
+  }
+
+  head->lck.ReadLock();
+  TStats::Hop();
+  auto prev = head;
+  auto curr = head->next;
+  lck.ReadUnlock();
+
+  if (matcher.Visit(prev->value)) {
+    prev->lck.ReadUnlock();
+    return true;
+  }
 
   while (curr) {
     curr->lck.ReadLock();
-    os << ',' << curr->value;
+    TStats::Hop();
     auto prevlck = &prev->lck;
     prev = curr;
     curr = curr->next;
     prevlck->ReadUnlock();
+    if (matcher.Visit(prev->value))
+      break;
   }
 
   prev->lck.ReadUnlock();
+  return matcher.Done();
+}
 
-  os << ')';
+/**
+ * @return An iterator to the first element of the list, which starts a scan
+ *  that lasts until the iterator reaches the end or is destroyed.
+ */
+template <typename T, typename TStats>
+typename NonBlockingList<T, TStats>::const_iterator
+NonBlockingList<T, TStats>::begin() const {
+  reclaimer.StartScan();
+  lck.ReadLock();
+  auto node = head;
+  lck.ReadUnlock();
+  return const_iterator(this, node);
+}
 
-  return os;
+/**
+ * Calls a function on every value in the list. See const_iterator for the
+ * consistency guarantees.
+ * @param fn The function, called with a const reference to each value.
+ */
+template <typename T, typename TStats>
+template <typename TFunc>
+void NonBlockingList<T, TStats>::ForEach(TFunc fn) const {
+  for (auto &value : *this)
+    fn(value);
+}
+
+/**
+ * Output stream operator for NonBlockingList.
+ * @param os The output stream.
+ * @param lst The list to be inserted into the output stream.
+ * @return A reference to the output stream.
+ * @details The format is: (value1,value2,..,valueN).
+ */
+template <typename T, typename TStats>
+std::ostream &operator<<(std::ostream &os,
+                         const NonBlockingList<T, TStats> &lst) {
+  os << '(';
+  auto first = lst.begin();
+  auto last = lst.end();
+  if (first != last) {
+    os << *first;
+    ++first;
+  }
+  for (; first != last; ++first)
+    os << ',' << *first;
+  return os << ')';
 }
 
 /**
@@ -418,8 +747,9 @@ std::ostream &operator<<(std::ostream &os, const NonBlockingList<T> &lst) {
  *  end, the thread doing the equality check might think that the lists are
  *  equal, even though it might not be true anymore.
  */
-template <typename T>
-bool operator==(const NonBlockingList<T> &lhs, const NonBlockingList<T> &rhs) {
+template <typename T, typename TStats>
+bool operator==(const NonBlockingList<T, TStats> &lhs,
+                const NonBlockingList<T, TStats> &rhs) {
   if (lhs.size.load() != rhs.size.load())
     return false;
 
@@ -477,7 +807,8 @@ bool operator==(const NonBlockingList<T> &lhs, const NonBlockingList<T> &rhs) {
  * @param rhs The list on right side.
  * @return True if the lists are not the same, false otherwise.
  */
-template <typename T>
-bool operator!=(const NonBlockingList<T> &lhs, const NonBlockingList<T> &rhs) {
+template <typename T, typename TStats>
+bool operator!=(const NonBlockingList<T, TStats> &lhs,
+                const NonBlockingList<T, TStats> &rhs) {
   return not(lhs == rhs);
 }
@@ -0,0 +1,68 @@
+/**
+ * @file op_stream.h
+ *
+ * Pre-generated operations for the benchmark workers to replay.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class MixOp { Insert, InsertUnique, Remove, Lookup };
+
+/**
+ * The operations of one worker, drawn before the clock starts so that the
+ * timed loop does no random number generation of its own. Each entry packs an
+ * operation, either a MixOp or a YcsbOp, into its top kOpBits and a uniform
+ * fraction into the rest, which the worker turns into a key once it knows how
+ * many keys it has to choose from. Streams hold at most kMaxOps entries, 4 MiB
+ * worth, and longer runs replay them from the start again, so memory does not
+ * grow with n.
+ */
+struct OpStream {
+  static constexpr unsigned kOpBits = 3;
+  static constexpr unsigned kFractionBits = 32 - kOpBits;
+  static constexpr uint32_t kFractionMask = (1u << kFractionBits) - 1;
+  static constexpr size_t kMaxOps = size_t{1} << 20;
+
+  std::vector<uint32_t> entries;
+  size_t pos{0};
+
+  /**
+   * @return The next entry, wrapping around at the end of the stream.
+   */
+  uint32_t Next() noexcept {
+    auto entry = entries[pos];
+    if (++pos == entries.size())
+      pos = 0;
+    return entry;
+  }
+
+  /**
+   * @param op The operation.
+   * @param u A number in [0, 1).
+   * @return The entry for the operation.
+   */
+  static uint32_t Pack(unsigned op, float u) noexcept {
+    return op << kFractionBits |
+           (static_cast<uint32_t>(u * (1u << kFractionBits)) & kFractionMask);
+  }
+
+  static unsigned Op(uint32_t entry) noexcept { return entry >> kFractionBits; }
+
+  /**
+   * @return The fraction of an entry, in [0, 1).
+   */
+  static double Fraction(uint32_t entry) noexcept {
+    return (entry & kFractionMask) * (1.0 / (1u << kFractionBits));
+  }
+
+  /**
+   * @return The fraction of an entry scaled to [0, n).
+   */
+  static size_t Index(uint32_t entry, size_t n) noexcept {
+    return (static_cast<uint64_t>(entry & kFractionMask) * n) >> kFractionBits;
+  }
+};
@@ -0,0 +1,186 @@
+/**
+ * @file perf_counters.cpp
+ *
+ * Definitions for PerfCounterGroup and PerfCounts.
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "perf_counters.h"
+
+namespace {
+
+#ifdef __linux__
+struct EventConfig {
+  uint32_t type;
+  uint64_t config;
+};
+
+// In the order of PerfEvent.
+const EventConfig kEventConfigs[kPerfEvents] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                             PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                             PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+};
+
+int perfEventOpen(const EventConfig &ec, int groupFd) noexcept {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = ec.type;
+  attr.config = ec.config;
+  attr.disabled = groupFd == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+#endif
+
+} // anonymous namespace
+
+const char *perfEventName(PerfEvent event) noexcept {
+  switch (event) {
+  case PerfEvent::Cycles:
+    return "cycles";
+  case PerfEvent::Instructions:
+    return "instructions";
+  case PerfEvent::BranchMisses:
+    return "branch-misses";
+  case PerfEvent::LlcMisses:
+    return "llc-misses";
+  case PerfEvent::DtlbMisses:
+    return "dtlb-misses";
+  default:
+    return "unknown";
+  }
+}
+
+/**
+ * @return True if any counter is available.
+ */
+bool PerfCounts::Any() const noexcept {
+  for (auto a : available)
+    if (a)
+      return true;
+  return false;
+}
+
+/**
+ * Adds the counts of another run, such as another thread of the same run.
+ * Counts that have nothing in them yet take the other counts as they are.
+ * @param other The counts to add.
+ */
+void PerfCounts::Merge(const PerfCounts &other) noexcept {
+  if (ops == 0 and not Any()) {
+    *this = other;
+    return;
+  }
+  for (std::size_t i = 0; i < kPerfEvents; ++i) {
+    values[i] += other.values[i];
+    available[i] = available[i] and other.available[i];
+  }
+  ops += other.ops;
+}
+
+/**
+ * @return Instructions per cycle, or 0 if either is unavailable.
+ */
+double PerfCounts::Ipc() const noexcept {
+  if (not Available(PerfEvent::Cycles) or
+      not Available(PerfEvent::Instructions) or
+      (*this)[PerfEvent::Cycles] == 0)
+    return 0.0;
+  return static_cast<double>((*this)[PerfEvent::Instructions]) /
+         (*this)[PerfEvent::Cycles];
+}
+
+/**
+ * @param event The event.
+ * @return The count of the event per operation, or 0 if it is unavailable.
+ */
+double PerfCounts::PerOp(PerfEvent event) const noexcept {
+  if (not Available(event) or ops == 0)
+    return 0.0;
+  return static_cast<double>((*this)[event]) / ops;
+}
+
+/**
+ * Opens the counters for the calling thread, disabled.
+ * @param enabled If false, nothing is opened.
+ */
+PerfCounterGroup::PerfCounterGroup(bool enabled) {
+  fds.fill(-1);
+#ifdef __linux__
+  if (not enabled)
+    return;
+  for (std::size_t i = 0; i < kPerfEvents; ++i) {
+    fds[i] = perfEventOpen(kEventConfigs[i], leader);
+    if (leader == -1)
+      leader = fds[i];
+  }
+#else
+  (void)enabled;
+#endif
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+#ifdef __linux__
+  for (auto fd : fds)
+    if (fd != -1)
+      close(fd);
+#endif
+}
+
+/**
+ * Resets the counters and starts counting.
+ */
+void PerfCounterGroup::Start() noexcept {
+#ifdef __linux__
+  if (not IsOpen())
+    return;
+  ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+/**
+ * Stops counting.
+ * @return The counts since Start().
+ */
+PerfCounts PerfCounterGroup::Stop() noexcept {
+  PerfCounts counts;
+#ifdef __linux__
+  if (not IsOpen())
+    return counts;
+  ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  // nr, time enabled, time running, and a value per counter in the group, in
+  // the order they were opened.
+  uint64_t buf[3 + kPerfEvents];
+  auto n = read(leader, buf, sizeof(buf));
+  if (n < static_cast<ssize_t>(3 * sizeof(uint64_t)) or buf[2] == 0)
+    return counts;
+  double scale = static_cast<double>(buf[1]) / buf[2];
+  std::size_t k = 3;
+  for (std::size_t i = 0; i < kPerfEvents and k < 3 + buf[0]; ++i) {
+    if (fds[i] == -1)
+      continue;
+    counts.values[i] = buf[k++] * scale;
+    counts.available[i] = true;
+  }
+#endif
+  return counts;
+}
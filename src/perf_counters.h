@@ -0,0 +1,68 @@
+/**
+ * @file perf_counters.h
+ *
+ * Hardware performance counters for the calling thread, via perf_event_open.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+enum class PerfEvent {
+  Cycles,
+  Instructions,
+  BranchMisses,
+  LlcMisses,
+  DtlbMisses,
+};
+
+constexpr std::size_t kPerfEvents = 5;
+
+const char *perfEventName(PerfEvent event) noexcept;
+
+/**
+ * The counts of a run, and the number of operations they were counted over.
+ * A counter that could not be opened or never got scheduled is unavailable,
+ * and merging counts keeps only the counters available in both.
+ */
+struct PerfCounts {
+  std::array<uint64_t, kPerfEvents> values{};
+  std::array<bool, kPerfEvents> available{};
+  uint64_t ops{0};
+
+  bool Available(PerfEvent event) const noexcept {
+    return available[static_cast<std::size_t>(event)];
+  }
+  uint64_t operator[](PerfEvent event) const noexcept {
+    return values[static_cast<std::size_t>(event)];
+  }
+  bool Any() const noexcept;
+  void Merge(const PerfCounts &other) noexcept;
+  double Ipc() const noexcept;
+  double PerOp(PerfEvent event) const noexcept;
+};
+
+/**
+ * A group of counters for the calling thread, counting user space only, so it
+ * works with the default perf_event_paranoid of 2. The counters are opened in
+ * a single group so they count over exactly the same instructions, and counts
+ * are scaled up if the kernel had to multiplex them. Any counter the kernel or
+ * the hardware does not support is left out, and if none can be opened, as in
+ * most containers and many VMs, Start() and Stop() do nothing and every count
+ * is unavailable.
+ */
+struct PerfCounterGroup {
+  std::array<int, kPerfEvents> fds;
+  int leader{-1};
+
+  PerfCounterGroup(bool enabled = true);
+  ~PerfCounterGroup();
+  PerfCounterGroup(const PerfCounterGroup &) = delete;
+  PerfCounterGroup &operator=(const PerfCounterGroup &) = delete;
+
+  bool IsOpen() const noexcept { return leader != -1; }
+  void Start() noexcept;
+  PerfCounts Stop() noexcept;
+};
@@ -0,0 +1,76 @@
+/**
+ * @file scan_reclaimer.h
+ *
+ * Deferred freeing of removed nodes while lock-free scans may hold them.
+ */
+
+#pragma once
+
+#include <atomic>
+
+/**
+ * Lets the iterators of the lists with node locks hold a pointer to a node
+ * without holding its lock. A scan is counted from before it reads the head
+ * until it ends, and a node removed while any scan is counted is retired
+ * instead of deleted. The retired nodes are freed by the last scan to end, or
+ * with the list. A node is only retired after it is unlinked, so a scan that
+ * starts once it is retired cannot reach it, and the last scan to end frees
+ * nothing another scan can hold.
+ *
+ * Removed nodes keep their next link, so a scan on one of them carries on
+ * into the list. Their prev link is no longer used by the list, so it links
+ * the retired nodes. While scans keep overlapping nothing is freed, so the
+ * retired nodes grow with the removals made until the scans stop overlapping.
+ */
+template <typename TNode> struct ScanReclaimer {
+  std::atomic_uint scans{0};
+  std::atomic<TNode *> retired{nullptr};
+
+  ScanReclaimer() = default;
+  ScanReclaimer(const ScanReclaimer &) = delete;
+  ScanReclaimer &operator=(const ScanReclaimer &) = delete;
+  ~ScanReclaimer() { Free(retired.load()); }
+
+  void StartScan() noexcept { scans.fetch_add(1); }
+
+  /**
+   * Ends a scan. The last scan to end frees the retired nodes, and the others
+   * put back the ones they took.
+   */
+  void EndScan() noexcept {
+    auto chain = retired.exchange(nullptr);
+    if (scans.fetch_sub(1) == 1) {
+      Free(chain);
+    } else if (chain) {
+      auto last = chain;
+      while (last->prev)
+        last = last->prev;
+      last->prev = retired.load();
+      while (not retired.compare_exchange_weak(last->prev, chain))
+        ;
+    }
+  }
+
+  /**
+   * Deletes a node that has been unlinked from the list, or retires it if a
+   * scan may hold it.
+   * @param node The node.
+   */
+  void Retire(TNode *node) noexcept {
+    if (scans.load() == 0) {
+      delete node;
+      return;
+    }
+    node->prev = retired.load();
+    while (not retired.compare_exchange_weak(node->prev, node))
+      ;
+  }
+
+  static void Free(TNode *node) noexcept {
+    while (node) {
+      auto prev = node->prev;
+      delete node;
+      node = prev;
+    }
+  }
+};
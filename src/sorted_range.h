@@ -0,0 +1,57 @@
+/**
+ * @file sorted_range.h
+ *
+ * Helper for checking many values against a list in a single traversal.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Keeps track of which values of a sorted range have been seen while a list is
+ * traversed once, so ContainsAll() does not need one traversal per value.
+ * Duplicate values in the range only need to be seen once.
+ */
+template <typename TIter> struct SortedRangeMatcher {
+  TIter first;
+  TIter last;
+  std::vector<bool> found;
+  size_t remaining{0};
+
+  /**
+   * Initializes the matcher.
+   * @param first Iterator to the first value of a sorted random-access range.
+   * @param last Iterator past the last value of the range.
+   */
+  SortedRangeMatcher(TIter first, TIter last)
+      : first(first), last(last), found(last - first) {
+    for (auto it = first; it != last; ++it)
+      if (it == first or *(it - 1) < *it)
+        ++remaining;
+  }
+
+  /**
+   * Marks a value from the list as seen if it is in the range.
+   * @param value A value from the list.
+   * @return True once every value in the range has been seen.
+   */
+  template <typename T> bool Visit(const T &value) {
+    auto it = std::lower_bound(first, last, value);
+    if (it != last and not(value < *it)) {
+      auto bit = found[it - first];
+      if (not bit) {
+        bit = true;
+        --remaining;
+      }
+    }
+    return Done();
+  }
+
+  /**
+   * @return True if every value in the range has been seen.
+   */
+  bool Done() const noexcept { return remaining == 0; }
+};
@@ -0,0 +1,35 @@
+/**
+ * @file statistics.h
+ *
+ * Summary statistics for the runtimes of repeated runs, and a test of whether
+ * two sets of runtimes differ.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * The summary of a sample. The confidence interval is the 95% interval for
+ * the mean from Student's t distribution, which is as wide as it should be for
+ * the handful of repeats a benchmark usually has. It has no width with fewer
+ * than two values.
+ */
+struct Summary {
+  size_t count{0};
+  double mean{0.0};
+  double stddev{0.0};
+  double min{0.0};
+  double max{0.0};
+  double median{0.0};
+  double ciLow{0.0};
+  double ciHigh{0.0};
+};
+
+double studentT95(size_t degreesOfFreedom) noexcept;
+
+Summary summarize(std::vector<double> values);
+
+double mannWhitneyP(const std::vector<double> &a,
+                    const std::vector<double> &b);
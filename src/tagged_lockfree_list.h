@@ -0,0 +1,378 @@
+/**
+ * @file tagged_lockfree_list.h
+ *
+ * A lockfree linked list with tagged next pointers, safe against ABA when its
+ * nodes are recycled.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <initializer_list>
+#include <ostream>
+#include <type_traits>
+
+#include "list_stats.h"
+#include "tagged_ptr.h"
+
+template <typename T> struct TaggedNode {
+  TaggedPtr<TaggedNode> next;
+  std::atomic_uint generation;
+  T value;
+
+  /**
+   * Default ctor. Initalizes everything to default or nullptr.
+   */
+  TaggedNode() : next{nullptr, 0}, generation(0), value() {}
+
+  /**
+   * Initializes node with specific value, and sets next to nullptr.
+   * @param value The value to initialize the node with.
+   */
+  TaggedNode(T value) : next{nullptr, 0}, generation(0), value(value) {}
+};
+
+/**
+ * A lockfree single linked list with the same basic operations as
+ * LockFreeList, after Michael's "High Performance Dynamic Lock-Free Hash Tables
+ * and List-Based Sets":
+ * - Insert(): inserts a value at the front of the list
+ * - InsertUnique(): inserts a value only if it does not exists in the list
+ * already
+ * - Remove(): remove a value from the list
+ * - Contains(): Checks if a value is in the list
+ * - Size(): Returns the size of the list
+ * - ForEach(): lockfree iteration over the elements
+ *
+ * Each next pointer is a TaggedPtr holding the deletion mark and a version, and
+ * every update to it is a double-width CAS. Traversals re-check the previous
+ * next pointer after reading a node, so a node that was unlinked and reused
+ * behind their back is detected and the traversal restarts. This makes it safe
+ * to recycle removed nodes, which go to a free list and are handed out again by
+ * later inserts. A node's value may be overwritten while a stale traversal is
+ * reading it, so nodes are only recycled when T is trivially destructible;
+ * otherwise they are kept on the free list until the list is destroyed.
+ */
+template <typename T, typename TStats = DefaultListStats>
+struct TaggedLockFreeList {
+  using NodeType = TaggedNode<T>;
+  using Ptr = TaggedPtr<NodeType>;
+
+  static constexpr bool kRecycle = std::is_trivially_destructible<T>::value;
+
+  /**
+   * Where a traversal stopped: curr is the successor of prev as of prevNext,
+   * and currNext is the next pointer of curr.
+   */
+  struct Position {
+    NodeType *prev;
+    Ptr prevNext;
+    NodeType *curr;
+    Ptr currNext;
+  };
+
+  NodeType *head;
+  NodeType *tail;
+  std::atomic_uint size{0};
+  mutable Ptr freeList{nullptr, 0};
+
+  TaggedLockFreeList();
+  ~TaggedLockFreeList();
+  TaggedLockFreeList(const TaggedLockFreeList &) = delete;
+  TaggedLockFreeList &operator=(const TaggedLockFreeList &) = delete;
+  virtual bool Insert(T value);
+  virtual bool InsertUnique(T value);
+  virtual bool Remove(T value) noexcept;
+  virtual bool Contains(T value) const noexcept;
+  virtual bool Find(T &value) const noexcept;
+  virtual unsigned Size() const noexcept;
+  virtual bool Empty() const noexcept;
+
+  template <typename TFunc> void ForEach(TFunc fn) const;
+
+  bool Search(const T &value, Position &pos, T *found = nullptr) const
+      noexcept;
+  NodeType *Allocate(const T &value);
+  void Recycle(NodeType *node) const noexcept;
+};
+
+template <typename T, typename TStats>
+constexpr bool TaggedLockFreeList<T, TStats>::kRecycle;
+
+/**
+ * Initializes the list.
+ */
+template <typename T, typename TStats>
+TaggedLockFreeList<T, TStats>::TaggedLockFreeList() {
+  head = new NodeType();
+  tail = new NodeType();
+  head->next.ptr = tail;
+}
+
+/**
+ * Destroys the list, along with every node on the free list.
+ */
+template <typename T, typename TStats>
+TaggedLockFreeList<T, TStats>::~TaggedLockFreeList() {
+  for (auto node : {head, freeList.ptr}) {
+    while (node) {
+      auto prev = node;
+      node = node->next.ptr;
+      delete prev;
+    }
+  }
+}
+
+/**
+ * Looks for a value, unlinking every deleted node on the way.
+ * @param value The value to look for.
+ * @param pos Set to where the traversal stopped: at the node holding value if
+ *  it was found, and at the last node otherwise, with pos.curr == tail.
+ * @param found If not null, set to a copy of the value found.
+ * @return True if the value was found, false otherwise.
+ */
+template <typename T, typename TStats>
+bool TaggedLockFreeList<T, TStats>::Search(const T &value, Position &pos,
+                                           T *found) const noexcept {
+retry:
+  pos.prev = head;
+  pos.prevNext = taggedLoad(&head->next);
+  while (true) {
+    pos.curr = pos.prevNext.ptr;
+    if (pos.curr == tail)
+      return false;
+    TStats::Hop();
+    pos.currNext = taggedLoad(&pos.curr->next);
+    T currValue = pos.curr->value;
+    // curr may have been unlinked and reused since prev->next was read, in
+    // which case currNext and currValue are garbage.
+    if (taggedLoad(&pos.prev->next) != pos.prevNext) {
+      TStats::Restart();
+      goto retry;
+    }
+    if (not pos.currNext.Marked()) {
+      if (currValue == value) {
+        if (found)
+          *found = currValue;
+        return true;
+      }
+      pos.prev = pos.curr;
+      pos.prevNext = pos.currNext;
+    } else {
+      auto unlinked = pos.prevNext.Next(pos.currNext.ptr);
+      if (not taggedCas(&pos.prev->next, pos.prevNext, unlinked)) {
+        TStats::CasFailure();
+        TStats::Restart();
+        goto retry;
+      }
+      Recycle(pos.curr);
+      pos.prevNext = unlinked;
+    }
+  }
+}
+
+/**
+ * @param value The value of the node.
+ * @return A node from the free list if there is one, or a new node.
+ */
+template <typename T, typename TStats>
+typename TaggedLockFreeList<T, TStats>::NodeType *
+TaggedLockFreeList<T, TStats>::Allocate(const T &value) {
+  if (kRecycle) {
+    auto top = taggedLoad(&freeList);
+    while (top.ptr) {
+      auto next = taggedLoad(&top.ptr->next).ptr;
+      if (taggedCas(&freeList, top, top.Next(next))) {
+        top.ptr->value = value;
+        return top.ptr;
+      }
+      top = taggedLoad(&freeList);
+    }
+  }
+  return new NodeType(value);
+}
+
+/**
+ * Puts an unlinked node on the free list.
+ * @param node The node, which must not be reachable from head anymore.
+ */
+template <typename T, typename TStats>
+void TaggedLockFreeList<T, TStats>::Recycle(NodeType *node) const noexcept {
+  node->generation.fetch_add(1, std::memory_order_release);
+  auto top = taggedLoad(&freeList);
+  while (true) {
+    taggedStore(&node->next, top.ptr);
+    if (taggedCas(&freeList, top, top.Next(node)))
+      return;
+    top = taggedLoad(&freeList);
+  }
+}
+
+/**
+ * Inserts an element into the list at the front of the list.
+ * @param value The value to insert into the list.
+ */
+template <typename T, typename TStats>
+bool TaggedLockFreeList<T, TStats>::Insert(T value) {
+  auto node = Allocate(value);
+  auto first = taggedLoad(&head->next);
+  taggedStore(&node->next, first.ptr);
+  while (not taggedCas(&head->next, first, first.Next(node))) {
+    TStats::CasFailure();
+    first = taggedLoad(&head->next);
+    taggedStore(&node->next, first.ptr);
+  }
+  size++;
+  return true;
+}
+
+/**
+ * Inserts an item only if the list does not cotain the item.
+ * @param value The value to insert into the list.
+ * @return True if the value was inserted, false otherwise.
+ */
+template <typename T, typename TStats>
+bool TaggedLockFreeList<T, TStats>::InsertUnique(T value) {
+  Position pos;
+  NodeType *node = nullptr;
+  while (true) {
+    if (Search(value, pos)) {
+      if (node)
+        Recycle(node);
+      return false;
+    }
+    if (not node)
+      node = Allocate(value);
+    taggedStore(&node->next, tail);
+    if (taggedCas(&pos.prev->next, pos.prevNext, pos.prevNext.Next(node))) {
+      size++;
+      return true;
+    }
+    TStats::CasFailure();
+    TStats::Restart();
+  }
+}
+
+/**
+ * Removes an element from the list if the element is found.
+ * @param value The value to remove from the list.
+ * @return True if the value was found, false otherwise.
+ */
+template <typename T, typename TStats>
+bool TaggedLockFreeList<T, TStats>::Remove(T value) noexcept {
+  Position pos;
+  while (true) {
+    if (not Search(value, pos))
+      return false;
+    // logically delete node
+    auto next = pos.currNext;
+    if (taggedCas(&pos.curr->next, next, next.Next(next.ptr, true)))
+      break;
+    TStats::CasFailure();
+    TStats::Restart();
+  }
+  size--;
+  // physically delete node
+  if (taggedCas(&pos.prev->next, pos.prevNext,
+                pos.prevNext.Next(pos.currNext.ptr))) {
+    Recycle(pos.curr);
+  } else {
+    TStats::CasFailure();
+    TStats::Restart();
+    Search(value, pos);
+  }
+  return true;
+}
+
+/**
+ * Checks if an element exists in the list
+ * @param value The value to look for in the list.
+ * @return True if the value was found, false otherwise.
+ */
+template <typename T, typename TStats>
+bool TaggedLockFreeList<T, TStats>::Contains(T value) const noexcept {
+  Position pos;
+  return Search(value, pos);
+}
+
+/**
+ * Checks if an element exists in the list
+ * @param value The value to look for in the list.
+ * @return True if the value was found, false otherwise.
+ * Overwrites value with the values of the element found.
+ */
+template <typename T, typename TStats>
+bool TaggedLockFreeList<T, TStats>::Find(T &value) const noexcept {
+  Position pos;
+  return Search(value, pos, &value);
+}
+
+/**
+ * @return The number of elements in the list.
+ */
+template <typename T, typename TStats>
+unsigned TaggedLockFreeList<T, TStats>::Size() const noexcept {
+  return size;
+}
+
+/**
+ * @return True if the list is empty, false otherwise.
+ */
+template <typename T, typename TStats>
+bool TaggedLockFreeList<T, TStats>::Empty() const noexcept {
+  return size == 0u;
+}
+
+/**
+ * Calls a function on a copy of every value in the list, without taking any
+ * locks. Every element that is in the list for the whole iteration is seen,
+ * and elements inserted or removed concurrently may or may not be seen. If the
+ * node the traversal stands on is recycled the traversal has to restart from
+ * the head, so elements before it can be seen twice.
+ * @param fn The function, called with a const reference to each value.
+ */
+template <typename T, typename TStats>
+template <typename TFunc>
+void TaggedLockFreeList<T, TStats>::ForEach(TFunc fn) const {
+restart:
+  NodeType *prev = head;
+  unsigned prevGen = 0;
+  while (true) {
+    auto prevNext = taggedLoad(&prev->next);
+    if (prev->generation.load(std::memory_order_acquire) != prevGen)
+      goto restart;
+    auto curr = prevNext.ptr;
+    if (curr == tail)
+      return;
+    auto currGen = curr->generation.load(std::memory_order_acquire);
+    auto currNext = taggedLoad(&curr->next);
+    T value = curr->value;
+    if (taggedLoad(&prev->next) != prevNext)
+      continue;
+    if (not currNext.Marked())
+      fn(value);
+    prev = curr;
+    prevGen = currGen;
+  }
+}
+
+/**
+ * Output stream operator.
+ * @param os The output stream.
+ * @param lst The list to be inserted into the output stream.
+ * @return A reference to the output stream.
+ * @details The format is: (value1,value2,..,valueN).
+ */
+template <typename T, typename TStats>
+std::ostream &operator<<(std::ostream &os,
+                         const TaggedLockFreeList<T, TStats> &lst) {
+  os << '(';
+  bool first = true;
+  lst.ForEach([&](const T &value) {
+    if (not first)
+      os << ',';
+    os << value;
+    first = false;
+  });
+  return os << ')';
+}
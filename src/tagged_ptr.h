@@ -0,0 +1,94 @@
+/**
+ * @file tagged_ptr.h
+ *
+ * A {pointer, tag} pair updated with a double-width compare-and-swap.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * A pointer with a tag next to it, updated as a single 128-bit word. The low
+ * bit of the tag is a deletion mark and the rest is a version that is bumped
+ * on every update, so a CAS against a stale value fails even if the pointer
+ * has been recycled and is the same again.
+ */
+template <typename TNode> struct alignas(16) TaggedPtr {
+  TNode *ptr;
+  uintptr_t tag;
+
+  bool Marked() const noexcept { return tag & 0x1; }
+
+  /**
+   * @param p The new pointer.
+   * @param mark The new deletion mark.
+   * @return A value with the next version of this one.
+   */
+  TaggedPtr Next(TNode *p, bool mark = false) const noexcept {
+    return {p, ((tag >> 1) + 1) << 1 | (mark ? 0x1 : 0x0)};
+  }
+
+  bool operator==(const TaggedPtr &tp) const noexcept {
+    return ptr == tp.ptr and tag == tp.tag;
+  }
+  bool operator!=(const TaggedPtr &tp) const noexcept {
+    return not(*this == tp);
+  }
+};
+
+/**
+ * Reads a TaggedPtr consistently without writing to it.
+ * @param addr The address to read.
+ * @return The value at addr.
+ * @details Every update bumps the tag, so reading the tag on both sides of the
+ *  pointer is enough to detect a torn read, which avoids paying for a locked
+ *  cmpxchg16b on every load.
+ */
+template <typename TNode>
+TaggedPtr<TNode> taggedLoad(const TaggedPtr<TNode> *addr) noexcept {
+  TaggedPtr<TNode> value;
+  uintptr_t tag;
+  do {
+    tag = __atomic_load_n(&addr->tag, __ATOMIC_ACQUIRE);
+    value.ptr = __atomic_load_n(&addr->ptr, __ATOMIC_ACQUIRE);
+    value.tag = __atomic_load_n(&addr->tag, __ATOMIC_ACQUIRE);
+  } while (tag != value.tag);
+  return value;
+}
+
+/**
+ * Compares and swaps a TaggedPtr as a single 128-bit word. On x86-64 this is a
+ * cmpxchg16b, which needs -mcx16; elsewhere it goes through libatomic.
+ * @param addr The address to update.
+ * @param expected The value addr must hold.
+ * @param desired The value to store.
+ * @return True if addr held expected and now holds desired.
+ */
+template <typename TNode>
+bool taggedCas(TaggedPtr<TNode> *addr, TaggedPtr<TNode> expected,
+               TaggedPtr<TNode> desired) noexcept {
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+  using Word = unsigned __int128;
+  Word e, d;
+  std::memcpy(&e, &expected, sizeof(Word));
+  std::memcpy(&d, &desired, sizeof(Word));
+  return __sync_bool_compare_and_swap(reinterpret_cast<Word *>(addr), e, d);
+#else
+  return __atomic_compare_exchange(addr, &expected, &desired, false,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * Stores a new pointer in a TaggedPtr, bumping its version.
+ * @param addr The address to update.
+ * @param p The new pointer.
+ */
+template <typename TNode>
+void taggedStore(TaggedPtr<TNode> *addr, TNode *p) noexcept {
+  auto old = taggedLoad(addr);
+  while (not taggedCas(addr, old, old.Next(p)))
+    old = taggedLoad(addr);
+}
@@ -6,17 +6,22 @@
 
 #pragma once
 
+#include <memory>
 #include <utility>
 
 #include "tbb/concurrent_hash_map.h"
 
 template <typename K, typename V> struct TbbHashMap {
-  using size_type = typename tbb::concurrent_hash_map<K, V>::size_type;
-  using accessor = typename tbb::concurrent_hash_map<K, V>::accessor;
-  using const_accessor =
-      typename tbb::concurrent_hash_map<K, V>::const_accessor;
+  // Through operator new, like the other structures, rather than TBB's own
+  // allocator, so that it is counted and gets the allocator chosen.
+  using Allocator = std::allocator<std::pair<const K, V>>;
+  using Table =
+      tbb::concurrent_hash_map<K, V, tbb::tbb_hash_compare<K>, Allocator>;
+  using size_type = typename Table::size_type;
+  using accessor = typename Table::accessor;
+  using const_accessor = typename Table::const_accessor;
   constexpr static size_type NUM_BUCKETS = 1000;
-  tbb::concurrent_hash_map<K, V> table;
+  Table table;
 
   /**
    * Constructs the TbbHashMap with the default number of buckets, 1000.
@@ -33,8 +38,11 @@ template <typename K, typename V> struct TbbHashMap {
   bool Insert(K key, V value);
   bool Remove(K key);
   bool Has(K key) const noexcept;
+  bool Find(K key, V &value) const;
+  bool Update(K key, V value);
   unsigned Size() const noexcept;
   V operator[](K key);
+  template <typename TFunc> void ForEach(TFunc fn) const;
 };
 
 /**
@@ -69,6 +77,36 @@ bool TbbHashMap<K, V>::Has(K key) const noexcept {
   return table.find(ca, key);
 }
 
+/**
+ * Looks up the value of a key.
+ * @param key The key to look for.
+ * @param value Set to the value of the key if it is found.
+ * @return True if the hash map contains the key, false otherwise.
+ */
+template <typename K, typename V>
+bool TbbHashMap<K, V>::Find(K key, V &value) const {
+  const_accessor ca;
+  if (not table.find(ca, key))
+    return false;
+  value = ca->second;
+  return true;
+}
+
+/**
+ * Replaces the value of a key that is in the map.
+ * @param key The key to look for.
+ * @param value The new value for the key.
+ * @return True if the key was in the map, false otherwise.
+ */
+template <typename K, typename V>
+bool TbbHashMap<K, V>::Update(K key, V value) {
+  accessor a;
+  if (not table.find(a, key))
+    return false;
+  a->second = std::move(value);
+  return true;
+}
+
 /**
  * @return The number of elements in the TbbHashMap.
  */
@@ -93,3 +131,16 @@ template <typename K, typename V> V TbbHashMap<K, V>::operator[](K key) {
     return value;
   }
 }
+
+/**
+ * Calls a function on every (key, value) pair in the TbbHashMap. TBB does not
+ * support iterating concurrently with writers, so this must only be called
+ * while no other thread modifies the map.
+ * @param fn The function, called as fn(key, value) with const references.
+ */
+template <typename K, typename V>
+template <typename TFunc>
+void TbbHashMap<K, V>::ForEach(TFunc fn) const {
+  for (const auto &kv : table)
+    fn(kv.first, kv.second);
+}
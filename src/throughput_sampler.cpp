@@ -0,0 +1,58 @@
+/**
+ * @file throughput_sampler.cpp
+ *
+ * Definitions for ThroughputSampler.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "throughput_sampler.h"
+
+/**
+ * Starts the sampler thread.
+ * @param repeat The repeat the samples belong to.
+ * @param duration How long the workers should run, in seconds.
+ * @param interval How often to sample the counters.
+ */
+void ThroughputSampler::Start(unsigned repeat, double duration,
+                              std::chrono::milliseconds interval) {
+  using namespace std::chrono;
+  stop = false;
+  for (auto &counter : counters)
+    counter.ops.store(0, std::memory_order_relaxed);
+  thread = std::thread([this, repeat, duration, interval] {
+    auto timeStart = steady_clock::now();
+    auto deadline =
+        timeStart + duration_cast<steady_clock::duration>(
+                        std::chrono::duration<double>(duration));
+    auto next = timeStart;
+    while (true) {
+      next = std::min(next + interval, deadline);
+      std::this_thread::sleep_until(next);
+      auto now = steady_clock::now();
+      auto elapsed = duration_cast<std::chrono::duration<double>>(
+          now - timeStart);
+      samples.push_back({repeat, elapsed.count(), TotalOps()});
+      if (now >= deadline)
+        break;
+    }
+    stop.store(true, std::memory_order_relaxed);
+  });
+}
+
+/**
+ * Waits for the duration to be over.
+ */
+void ThroughputSampler::Join() { thread.join(); }
+
+/**
+ * @return The number of operations done so far by all workers.
+ */
+uint64_t ThroughputSampler::TotalOps() const noexcept {
+  uint64_t total = 0;
+  for (auto &counter : counters)
+    total += counter.ops.load(std::memory_order_relaxed);
+  return total;
+}
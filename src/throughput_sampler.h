@@ -0,0 +1,61 @@
+/**
+ * @file throughput_sampler.h
+ *
+ * A thread that stops a timed run and samples its throughput along the way.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "cache_line.h"
+
+/**
+ * The number of operations a worker has done so far. Only its worker writes
+ * it, and the padding keeps the counters of different workers on different
+ * cache lines.
+ */
+struct OpCounter {
+  std::atomic<uint64_t> ops{0};
+  CacheLinePad pad;
+};
+
+/**
+ * The total number of operations done by all workers at some point of a run.
+ */
+struct ThroughputSample {
+  unsigned repeat;
+  double elapsed;
+  uint64_t ops;
+};
+
+/**
+ * Runs a timed benchmark: the workers go on until stop is set, and a sampler
+ * thread sets it once the duration is over. Every interval until then the
+ * sampler adds up the workers' counters, so the samples show how throughput
+ * changed over the run rather than just its average.
+ */
+struct ThroughputSampler {
+  std::vector<OpCounter> counters;
+  std::atomic_bool stop{false};
+  std::vector<ThroughputSample> samples;
+  std::thread thread;
+
+  ThroughputSampler(size_t nThreads) : counters(nThreads) {}
+  ThroughputSampler(const ThroughputSampler &) = delete;
+  ThroughputSampler &operator=(const ThroughputSampler &) = delete;
+
+  void Start(unsigned repeat, double duration,
+             std::chrono::milliseconds interval);
+  void Join();
+  uint64_t TotalOps() const noexcept;
+
+  /**
+   * @return True once the workers should stop.
+   */
+  bool Stopped() const noexcept { return stop.load(std::memory_order_relaxed); }
+};
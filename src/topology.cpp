@@ -0,0 +1,216 @@
+/**
+ * @file topology.cpp
+ *
+ * Definitions for CpuTopology and the placements.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <dirent.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <tuple>
+#include <utility>
+
+#include "topology.h"
+#include "util.h"
+
+namespace {
+
+const std::pair<Placement, const char *> kPlacementNames[] = {
+    {Placement::None, "none"},
+    {Placement::Linear, "linear"},
+    {Placement::Compact, "compact"},
+    {Placement::Scatter, "scatter"},
+    {Placement::PhysicalFirst, "physical-first"},
+    {Placement::NumaRoundRobin, "numa-rr"}};
+
+/**
+ * @return The integer in a sysfs file, or fallback if it cannot be read.
+ */
+int readId(const std::string &path, int fallback) {
+  std::ifstream in(path);
+  int id;
+  return in >> id ? id : fallback;
+}
+
+/**
+ * @return The NUMA node of a CPU, from the nodeN link in its directory, or 0.
+ */
+int readNode(const std::string &cpuDir) {
+  int node = 0;
+  if (auto dir = opendir(cpuDir.c_str())) {
+    while (auto entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      if (name.size() > 4 and name.compare(0, 4, "node") == 0 and
+          std::isdigit(name[4])) {
+        node = std::atoi(name.c_str() + 4);
+        break;
+      }
+    }
+    closedir(dir);
+  }
+  return node;
+}
+
+/**
+ * @return The CPUs the calling thread may run on.
+ */
+std::vector<unsigned> allowedCpus() {
+  std::vector<unsigned> allowed;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      if (CPU_ISSET(cpu, &set))
+        allowed.push_back(cpu);
+  return allowed;
+}
+
+} // anonymous namespace
+
+std::ostream &operator<<(std::ostream &os, Placement placement) {
+  for (auto &entry : kPlacementNames)
+    if (entry.first == placement)
+      return os << entry.second;
+  return os << "unknown";
+}
+
+/**
+ * Parses a placement given by its name: none, linear, compact, scatter,
+ * physical-first or numa-rr.
+ * @param s The string to parse.
+ * @param placement Set to the placement parsed.
+ * @return True if s is a valid placement, false otherwise.
+ */
+bool parsePlacement(const std::string &s, Placement &placement) {
+  auto name = toLower(s);
+  for (auto &entry : kPlacementNames) {
+    if (name == entry.second) {
+      placement = entry.first;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Reads the topology of the CPUs the process may run on.
+ * @param root The sysfs directory of the CPUs.
+ * @return The topology.
+ */
+CpuTopology CpuTopology::Read(const std::string &root) {
+  return Read(root, allowedCpus());
+}
+
+/**
+ * Reads the topology of some CPUs.
+ * @param root The sysfs directory of the CPUs.
+ * @param allowed The CPUs to read.
+ * @return The topology.
+ */
+CpuTopology CpuTopology::Read(const std::string &root,
+                              const std::vector<unsigned> &allowed) {
+  CpuTopology topology;
+  // The siblings of a core are numbered in CPU order.
+  std::map<std::tuple<int, int>, unsigned> siblings;
+  for (auto cpu : allowed) {
+    auto dir = root + "/cpu" + std::to_string(cpu);
+    CpuInfo info;
+    info.cpu = cpu;
+    info.core = readId(dir + "/topology/core_id", cpu);
+    info.package = readId(dir + "/topology/physical_package_id", 0);
+    info.node = readNode(dir);
+    info.smt = siblings[std::make_tuple(info.package, info.core)]++;
+    topology.cpus.push_back(info);
+  }
+  return topology;
+}
+
+/**
+ * @param placement The placement.
+ * @return The CPUs in the order the placement gives them to threads, empty
+ *  for Placement::None.
+ */
+std::vector<unsigned> CpuTopology::Order(Placement placement) const {
+  auto sorted = cpus;
+  auto sortBy = [&](std::function<std::tuple<int, int, int, int, unsigned>(
+                        const CpuInfo &)> key) {
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [&](const CpuInfo &a, const CpuInfo &b) {
+                       return key(a) < key(b);
+                     });
+  };
+
+  // The rank of each physical core within its package and within its node,
+  // so that scatter and numa-rr can take turns between them.
+  std::map<std::tuple<int, int>, int> coreRank, coreNodeRank;
+  std::map<int, int> coresInPackage, coresInNode;
+  for (auto &c : cpus) {
+    if (c.smt != 0)
+      continue;
+    coreRank[std::make_tuple(c.package, c.core)] = coresInPackage[c.package]++;
+    coreNodeRank[std::make_tuple(c.package, c.core)] = coresInNode[c.node]++;
+  }
+  auto rank = [&](const CpuInfo &c) {
+    return coreRank[std::make_tuple(c.package, c.core)];
+  };
+  auto nodeRank = [&](const CpuInfo &c) {
+    return coreNodeRank[std::make_tuple(c.package, c.core)];
+  };
+
+  switch (placement) {
+  case Placement::None:
+    return {};
+  case Placement::Linear:
+    break;
+  case Placement::Compact:
+    sortBy([](const CpuInfo &c) {
+      return std::make_tuple(c.node, c.package, c.core, int(c.smt), c.cpu);
+    });
+    break;
+  case Placement::Scatter:
+    sortBy([&](const CpuInfo &c) {
+      return std::make_tuple(int(c.smt), rank(c), c.node, c.package, c.cpu);
+    });
+    break;
+  case Placement::PhysicalFirst:
+    sortBy([](const CpuInfo &c) {
+      return std::make_tuple(int(c.smt), c.node, c.package, c.core, c.cpu);
+    });
+    break;
+  case Placement::NumaRoundRobin:
+    sortBy([&](const CpuInfo &c) {
+      return std::make_tuple(int(c.smt), nodeRank(c), c.node, c.package,
+                             c.cpu);
+    });
+    break;
+  }
+  std::vector<unsigned> order;
+  for (auto &c : sorted)
+    order.push_back(c.cpu);
+  return order;
+}
+
+/**
+ * @param placement The placement.
+ * @param nThreads The number of threads.
+ * @return The CPU of each thread, or -1 for threads that are not pinned.
+ */
+std::vector<int> CpuTopology::Assign(Placement placement,
+                                     size_t nThreads) const {
+  auto order = Order(placement);
+  std::vector<int> assigned(nThreads, -1);
+  if (not order.empty())
+    for (size_t t = 0; t < nThreads; ++t)
+      assigned[t] = order[t % order.size()];
+  return assigned;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file topology.h
+ *
+ * The CPU topology of the machine, read from sysfs, and the orders in which
+ * benchmark threads can be placed on it.
+ */
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * How threads are pinned to CPUs:
+ * - None: not at all
+ * - Linear: thread i on the i-th CPU by number, whatever that CPU is
+ * - Compact: filling a core with its SMT siblings, then a package with its
+ *   cores, before moving on
+ * - Scatter: spreading threads over packages, then over cores, and only then
+ *   doubling up on SMT siblings
+ * - PhysicalFirst: one thread per physical core, package by package, and the
+ *   siblings only once every core has a thread
+ * - NumaRoundRobin: taking turns between NUMA nodes, one thread per physical
+ *   core of a node first
+ * Threads beyond the number of CPUs wrap around.
+ */
+enum class Placement {
+  None,
+  Linear,
+  Compact,
+  Scatter,
+  PhysicalFirst,
+  NumaRoundRobin
+};
+
+std::ostream &operator<<(std::ostream &os, Placement placement);
+
+bool parsePlacement(const std::string &s, Placement &placement);
+
+/**
+ * Where a CPU is: its core, which SMT sibling of the core it is, its package
+ * and its NUMA node.
+ */
+struct CpuInfo {
+  unsigned cpu{0};
+  int core{0};
+  unsigned smt{0};
+  int package{0};
+  int node{0};
+};
+
+/**
+ * The CPUs the process may run on, with where each one is. Missing topology
+ * files, as in some containers, make every CPU its own core on package and
+ * node 0.
+ */
+struct CpuTopology {
+  std::vector<CpuInfo> cpus;
+
+  static CpuTopology Read(const std::string &root = "/sys/devices/system/cpu");
+  static CpuTopology Read(const std::string &root,
+                          const std::vector<unsigned> &allowed);
+  std::vector<unsigned> Order(Placement placement) const;
+  std::vector<int> Assign(Placement placement, size_t nThreads) const;
+};
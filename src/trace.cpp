@@ -0,0 +1,171 @@
+/**
+ * @file trace.cpp
+ *
+ * Definitions for TraceWriter and TraceFile.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#include "trace.h"
+
+constexpr char TraceHeader::kMagic[8];
+constexpr uint32_t TraceHeader::kVersion;
+
+TraceWriter *TraceWriter::active = nullptr;
+
+namespace {
+
+std::atomic<uint16_t> nextThreadId{0};
+
+uint16_t traceThreadId() noexcept {
+  static thread_local uint16_t id = nextThreadId++;
+  return id;
+}
+
+TraceHeader makeHeader(uint64_t nRecords) noexcept {
+  TraceHeader header;
+  std::memcpy(header.magic, TraceHeader::kMagic, sizeof(header.magic));
+  header.version = TraceHeader::kVersion;
+  header.recordSize = sizeof(TraceRecord);
+  header.nRecords = nRecords;
+  return header;
+}
+
+} // anonymous namespace
+
+TraceWriter::~TraceWriter() { Close(); }
+
+/**
+ * Creates the file, truncating it if it exists.
+ * @param path The path of the file.
+ * @return False if the file could not be created.
+ */
+bool TraceWriter::Open(const std::string &path) {
+  Close();
+  file = std::fopen(path.c_str(), "wb");
+  if (not file)
+    return false;
+  nRecords = 0;
+  last = std::chrono::steady_clock::now();
+  // The header is written again with the final count by Close().
+  auto header = makeHeader(0);
+  return std::fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+/**
+ * Appends a record for an operation of the calling thread.
+ * @param op The operation.
+ * @param key The key.
+ * @param valueSize The size of the value, for inserts and updates.
+ */
+void TraceWriter::Append(TraceOp op, int32_t key, uint32_t valueSize) {
+  using namespace std::chrono;
+  auto thread = traceThreadId();
+  std::lock_guard<std::mutex> lock(mutex);
+  if (not file)
+    return;
+  auto now = steady_clock::now();
+  auto delta = duration_cast<nanoseconds>(now - last).count();
+  last = now;
+  TraceRecord record;
+  record.key = key;
+  record.valueSize = valueSize;
+  record.timeDelta = static_cast<uint32_t>(
+      std::min<int64_t>(delta, std::numeric_limits<uint32_t>::max()));
+  record.thread = thread;
+  record.op = op;
+  record.reserved = 0;
+  if (std::fwrite(&record, sizeof(record), 1, file) == 1)
+    ++nRecords;
+}
+
+/**
+ * Writes the final header and closes the file. Does nothing if it is not
+ * open.
+ * @return False if the file could not be written.
+ */
+bool TraceWriter::Close() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (not file)
+    return true;
+  auto header = makeHeader(nRecords);
+  bool ok = std::fseek(file, 0, SEEK_SET) == 0 and
+            std::fwrite(&header, sizeof(header), 1, file) == 1;
+  ok = std::fclose(file) == 0 and ok;
+  file = nullptr;
+  return ok;
+}
+
+TraceFile::~TraceFile() {
+  if (base)
+    munmap(base, length);
+}
+
+/**
+ * Maps a trace file and checks its header. The pages are populated up front
+ * so that replay does not take page faults.
+ * @param path The path of the file.
+ * @param error Set to what went wrong, if anything did.
+ * @return False if the file could not be mapped or is not a valid trace.
+ */
+bool TraceFile::Open(const std::string &path, std::string &error) {
+  error.clear();
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    error = path + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 or
+      static_cast<size_t>(st.st_size) < sizeof(TraceHeader)) {
+    error = path + ": not a trace file";
+    close(fd);
+    return false;
+  }
+  length = st.st_size;
+  base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    base = nullptr;
+    error = path + ": " + std::strerror(errno);
+    return false;
+  }
+  madvise(base, length, MADV_SEQUENTIAL);
+
+  auto header = static_cast<const TraceHeader *>(base);
+  auto available = (length - sizeof(TraceHeader)) / sizeof(TraceRecord);
+  if (std::memcmp(header->magic, TraceHeader::kMagic, sizeof(header->magic)))
+    error = path + ": not a trace file";
+  else if (header->version != TraceHeader::kVersion or
+           header->recordSize != sizeof(TraceRecord))
+    error = path + ": unsupported trace version";
+  else if (header->nRecords > available)
+    error = path + ": trace is truncated";
+  if (not error.empty())
+    return false;
+  records = reinterpret_cast<const TraceRecord *>(header + 1);
+  nRecords = header->nRecords;
+  return true;
+}
+
+/**
+ * @param threadId The worker.
+ * @param nThreads The number of workers.
+ * @return The records of a worker and how many there are. The records are
+ *  split into contiguous parts of about the same size, in order.
+ */
+std::pair<const TraceRecord *, size_t>
+TraceFile::Slice(size_t threadId, size_t nThreads) const noexcept {
+  auto first = nRecords * threadId / nThreads;
+  auto last = nRecords * (threadId + 1) / nThreads;
+  return {records + first, last - first};
+}
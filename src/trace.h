@@ -0,0 +1,172 @@
+/**
+ * @file trace.h
+ *
+ * A binary format for operation traces, a writer for it, a read-only mapping
+ * of a trace for replay, and shims that record the operations on a list or a
+ * map.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <utility>
+
+enum class TraceOp : uint8_t { Insert, Remove, Lookup, Update };
+
+/**
+ * The start of a trace file, followed by nRecords records. Everything is in
+ * the byte order of the machine that wrote it.
+ */
+struct TraceHeader {
+  static constexpr char kMagic[8] = {'S', 'Y', 'N', 'C', 'T', 'R', 'C', '\0'};
+  static constexpr uint32_t kVersion = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  uint64_t nRecords;
+};
+
+/**
+ * One operation of a trace: the key, the size of the value for inserts and
+ * updates, the nanoseconds since the previous record, saturated at 32 bits,
+ * and the thread that did it.
+ */
+struct TraceRecord {
+  int32_t key;
+  uint32_t valueSize;
+  uint32_t timeDelta;
+  uint16_t thread;
+  TraceOp op;
+  uint8_t reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 24, "TraceHeader must be packed");
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord must be packed");
+
+/**
+ * Writes a trace file. Append() may be called from any thread, and each
+ * thread gets the next id the first time it appends, so the records come out
+ * in the order the operations were started in.
+ */
+struct TraceWriter {
+  // Where the recording shims write to, if anywhere.
+  static TraceWriter *active;
+
+  std::FILE *file{nullptr};
+  uint64_t nRecords{0};
+  std::chrono::steady_clock::time_point last;
+  std::mutex mutex;
+
+  TraceWriter() = default;
+  ~TraceWriter();
+  TraceWriter(const TraceWriter &) = delete;
+  TraceWriter &operator=(const TraceWriter &) = delete;
+
+  bool Open(const std::string &path);
+  void Append(TraceOp op, int32_t key, uint32_t valueSize = 0);
+  bool Close();
+};
+
+/**
+ * A trace file mapped read-only into memory. The records are read straight
+ * from the mapping, and Slice() splits them into contiguous parts, one per
+ * worker, without copying anything.
+ */
+struct TraceFile {
+  void *base{nullptr};
+  size_t length{0};
+  const TraceRecord *records{nullptr};
+  size_t nRecords{0};
+
+  TraceFile() = default;
+  ~TraceFile();
+  TraceFile(const TraceFile &) = delete;
+  TraceFile &operator=(const TraceFile &) = delete;
+
+  bool Open(const std::string &path, std::string &error);
+  std::pair<const TraceRecord *, size_t> Slice(size_t threadId,
+                                               size_t nThreads) const noexcept;
+};
+
+/**
+ * Wraps a list type so that every insert, remove and lookup is appended to
+ * TraceWriter::active, when it is set. Keys are recorded as 32-bit integers.
+ * RecordingList<TList>::Type can go wherever TList can.
+ */
+template <template <typename...> class TList> struct RecordingList {
+  template <typename T> struct Type {
+    TList<T> list;
+
+    template <typename... Args>
+    explicit Type(Args &&... args) : list(std::forward<Args>(args)...) {}
+
+    auto Insert(T value) -> decltype(list.Insert(value)) {
+      Record(TraceOp::Insert, value);
+      return list.Insert(value);
+    }
+    bool InsertUnique(T value) {
+      Record(TraceOp::Insert, value);
+      return list.InsertUnique(value);
+    }
+    bool Remove(T value) {
+      Record(TraceOp::Remove, value);
+      return list.Remove(value);
+    }
+    bool Contains(T value) const {
+      Record(TraceOp::Lookup, value);
+      return list.Contains(value);
+    }
+
+    static void Record(TraceOp op, const T &value) {
+      if (TraceWriter::active)
+        TraceWriter::active->Append(op, static_cast<int32_t>(value),
+                                    sizeof(T));
+    }
+  };
+};
+
+/**
+ * Wraps a map type so that every operation is appended to TraceWriter::active,
+ * when it is set. Keys are recorded as 32-bit integers.
+ * RecordingMap<TMap>::Type can go wherever TMap can.
+ */
+template <template <typename, typename> class TMap> struct RecordingMap {
+  template <typename K, typename V> struct Type {
+    TMap<K, V> map;
+
+    template <typename... Args>
+    explicit Type(Args &&... args) : map(std::forward<Args>(args)...) {}
+
+    bool Insert(K key, V value) {
+      Record(TraceOp::Insert, key, sizeof(V));
+      return map.Insert(key, value);
+    }
+    bool Remove(K key) {
+      Record(TraceOp::Remove, key);
+      return map.Remove(key);
+    }
+    bool Has(K key) const {
+      Record(TraceOp::Lookup, key);
+      return map.Has(key);
+    }
+    bool Find(K key, V &value) const {
+      Record(TraceOp::Lookup, key);
+      return map.Find(key, value);
+    }
+    bool Update(K key, V value) {
+      Record(TraceOp::Update, key, sizeof(V));
+      return map.Update(key, value);
+    }
+
+    static void Record(TraceOp op, const K &key, uint32_t valueSize = 0) {
+      if (TraceWriter::active)
+        TraceWriter::active->Append(op, static_cast<int32_t>(key), valueSize);
+    }
+  };
+};
@@ -13,18 +13,22 @@
 #include <cctype>
 #include <sstream>
 #include <string>
-#include <thread>
 #include <utility>
 #include <vector>
 
 #include "util.h"
 
-void setCoreAffinity(size_t coreId) {
-  coreId %= std::thread::hardware_concurrency();
+/**
+ * Pins the calling thread to a CPU.
+ * @param cpu The CPU, by its number.
+ * @return False if the thread could not be pinned to it.
+ */
+bool setCpuAffinity(unsigned cpu) {
   cpu_set_t cpuset;
   CPU_ZERO(&cpuset);
-  CPU_SET(coreId, &cpuset);
-  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+  CPU_SET(cpu, &cpuset);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                                &cpuset) == 0;
 }
 
 std::vector<std::string> split(const std::string &s, char delim) {
@@ -9,7 +9,7 @@
 #include <string>
 #include <vector>
 
-void setCoreAffinity(size_t coreId);
+bool setCpuAffinity(unsigned cpu);
 
 std::vector<std::string> split(const std::string &s, char delim);
 
@@ -0,0 +1,165 @@
+/**
+ * @file worker_pool.cpp
+ *
+ * Definitions for WorkerPool.
+ */
+
+#include <algorithm>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "util.h"
+#include "worker_pool.h"
+
+constexpr int WorkerPool::kSpins;
+
+namespace {
+
+void cpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#endif
+}
+
+/**
+ * Spins until a condition holds, yielding after a while so that the threads
+ * it waits for get to run when there are more threads than cores.
+ * @param done The condition.
+ */
+template <typename TPred> void spinUntil(TPred done) {
+  for (int i = 0; not done(); ++i) {
+    if (i < WorkerPool::kSpins)
+      cpuRelax();
+    else
+      std::this_thread::yield();
+  }
+}
+
+} // anonymous namespace
+
+/**
+ * Starts the workers, which wait for the first run.
+ * @param nThreads The number of workers, including the calling thread.
+ * @param cpus The CPU to pin each worker to, the calling thread included, or
+ *  -1 to leave it be. Workers past the end are not pinned.
+ */
+WorkerPool::WorkerPool(size_t nThreads, std::vector<int> cpus)
+    : clocks(std::max<size_t>(nThreads, 1)), cpus(std::move(cpus)) {
+  this->cpus.resize(Size(), -1);
+  if (this->cpus[0] >= 0)
+    setCpuAffinity(this->cpus[0]);
+  for (size_t t = 1; t < Size(); ++t)
+    threads.emplace_back(&WorkerPool::Loop, this, t);
+}
+
+WorkerPool::~WorkerPool() {
+  shutdown = true;
+  generation.fetch_add(1, std::memory_order_release);
+  WakeAll();
+  for (auto &thread : threads)
+    thread.join();
+}
+
+/**
+ * Runs a task on the first nThreads workers and waits for all of them.
+ * @param nThreads The number of workers to run the task on.
+ * @param task The task, which gets the id of the worker running it.
+ * @return The seconds from the first worker starting its clock to the last
+ *  one stopping it.
+ */
+double WorkerPool::Run(size_t nThreads, const Task &task) {
+  this->task = &task;
+  nActive = std::min(std::max<size_t>(nThreads, 1), Size());
+  arrived.store(0, std::memory_order_relaxed);
+  finished.store(0, std::memory_order_relaxed);
+  generation.fetch_add(1, std::memory_order_release);
+  WakeAll();
+  Work(0);
+  // Workers that sit the run out still check in, so none of them reads the
+  // task of this run once the next one has been set up.
+  spinUntil([&] {
+    return finished.load(std::memory_order_acquire) == Size();
+  });
+
+  auto first = clocks[0].start;
+  auto last = clocks[0].end;
+  for (size_t t = 1; t < nActive; ++t) {
+    first = std::min(first, clocks[t].start);
+    last = std::max(last, clocks[t].end);
+  }
+  using namespace std::chrono;
+  return duration_cast<duration<double>>(last - first).count();
+}
+
+void WorkerPool::Loop(size_t threadId) {
+  if (cpus[threadId] >= 0)
+    setCpuAffinity(cpus[threadId]);
+  uint32_t seen = 0;
+  for (;;) {
+    Wait(seen);
+    seen = generation.load(std::memory_order_acquire);
+    if (shutdown)
+      return;
+    if (threadId < nActive)
+      Work(threadId);
+    else
+      finished.fetch_add(1, std::memory_order_release);
+  }
+}
+
+/**
+ * Waits for the other workers of the run, then runs the task. The clock is
+ * stopped after the task unless the task stopped it itself.
+ * @param threadId The worker.
+ */
+void WorkerPool::Work(size_t threadId) {
+  arrived.fetch_add(1, std::memory_order_acq_rel);
+  spinUntil([&] {
+    return arrived.load(std::memory_order_acquire) == nActive;
+  });
+  auto &clock = clocks[threadId];
+  clock.end = {};
+  StartClock(threadId);
+  (*task)(threadId);
+  if (clock.end < clock.start)
+    StopClock(threadId);
+  finished.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * Spins for a while for the next run, then sleeps until it starts.
+ * @param seen The generation of the last run.
+ */
+void WorkerPool::Wait(uint32_t seen) noexcept {
+  for (int i = 0; i < kSpins; ++i) {
+    if (generation.load(std::memory_order_acquire) != seen)
+      return;
+    cpuRelax();
+  }
+  while (generation.load(std::memory_order_acquire) == seen) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&generation),
+            FUTEX_WAIT_PRIVATE, seen, nullptr, nullptr, 0);
+#else
+    std::this_thread::yield();
+#endif
+  }
+}
+
+void WorkerPool::WakeAll() noexcept {
+#ifdef __linux__
+  if (not threads.empty())
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&generation),
+            FUTEX_WAKE_PRIVATE, static_cast<int>(threads.size()), nullptr,
+            nullptr, 0);
+#endif
+}
@@ -0,0 +1,82 @@
+/**
+ * @file worker_pool.h
+ *
+ * A pool of benchmark threads that lives across runs.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "cache_line.h"
+
+/**
+ * The clock readings of one worker over a run. The padding keeps workers that
+ * write theirs at the same moment off each other's cache lines.
+ */
+struct WorkerClock {
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point end;
+  CacheLinePad pad;
+};
+
+/**
+ * A fixed set of threads that run one task after another, so thread creation
+ * and teardown stay out of the measurements. The calling thread is worker 0,
+ * and the others are created once, pinned to the CPUs given, if any, and
+ * sleep on a futex between runs. A run wakes the pool, and the workers taking
+ * part spin on a barrier until all of them are there, so they start at the
+ * same moment. Each worker times its own region, by default the whole task,
+ * and the run lasts from the first start to the last end.
+ */
+struct WorkerPool {
+  static constexpr int kSpins = 1000;
+  using Task = std::function<void(size_t threadId)>;
+
+  std::vector<std::thread> threads;
+  std::vector<WorkerClock> clocks;
+  // The CPU each worker is pinned to, or -1.
+  std::vector<int> cpus;
+  const Task *task{nullptr};
+  size_t nActive{0};
+  bool shutdown{false};
+  // Bumped to start a run. 32 bits, so workers can sleep on it.
+  std::atomic<uint32_t> generation{0};
+  std::atomic<size_t> arrived{0};
+  std::atomic<size_t> finished{0};
+
+  explicit WorkerPool(size_t nThreads, std::vector<int> cpus = {});
+  ~WorkerPool();
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  size_t Size() const noexcept { return clocks.size(); }
+  double Run(size_t nThreads, const Task &task);
+
+  /**
+   * Starts the clock of a worker, for tasks that set up before their region.
+   * @param threadId The worker.
+   */
+  void StartClock(size_t threadId) noexcept {
+    clocks[threadId].start = std::chrono::steady_clock::now();
+  }
+
+  /**
+   * Stops the clock of a worker, for tasks that clean up after their region.
+   * @param threadId The worker.
+   */
+  void StopClock(size_t threadId) noexcept {
+    clocks[threadId].end = std::chrono::steady_clock::now();
+  }
+
+  void Loop(size_t threadId);
+  void Work(size_t threadId);
+  void Wait(uint32_t seen) noexcept;
+  void WakeAll() noexcept;
+};
@@ -0,0 +1,71 @@
+/**
+ * @file ycsb.cpp
+ *
+ * Definitions of the YCSB core workloads.
+ */
+
+#include <cctype>
+#include <cstdint>
+
+#include "ycsb.h"
+
+constexpr double YcsbWorkload::kTheta;
+
+namespace {
+
+const YcsbWorkload kWorkloads[] = {
+    {'a', 0.50, 0.50, 0.00, 0.00, 0.00, Distribution::Zipf, 0},
+    {'b', 0.95, 0.05, 0.00, 0.00, 0.00, Distribution::Zipf, 0},
+    {'c', 1.00, 0.00, 0.00, 0.00, 0.00, Distribution::Zipf, 0},
+    {'d', 0.95, 0.00, 0.05, 0.00, 0.00, Distribution::Latest, 0},
+    {'e', 0.00, 0.00, 0.05, 0.95, 0.00, Distribution::Zipf, 100},
+    {'f', 0.50, 0.00, 0.00, 0.00, 0.50, Distribution::Zipf, 0},
+};
+
+} // anonymous namespace
+
+/**
+ * @param u A number drawn uniformly from [0, 1).
+ * @return The operation to run next.
+ */
+YcsbOp YcsbWorkload::ChooseOp(float u) const noexcept {
+  if (u < read)
+    return YcsbOp::Read;
+  u -= read;
+  if (u < update)
+    return YcsbOp::Update;
+  u -= update;
+  if (u < insert)
+    return YcsbOp::Insert;
+  u -= insert;
+  if (u < scan)
+    return YcsbOp::Scan;
+  return readModifyWrite > 0.0 ? YcsbOp::ReadModifyWrite : YcsbOp::Read;
+}
+
+/**
+ * @param name The name of the workload, from a to f, in either case.
+ * @return The workload, or nullptr if there is none with that name.
+ */
+const YcsbWorkload *findYcsbWorkload(char name) noexcept {
+  name = std::tolower(name);
+  for (auto &w : kWorkloads)
+    if (w.name == name)
+      return &w;
+  return nullptr;
+}
+
+/**
+ * The 64-bit FNV-1a hash of a value, which YCSB uses to scramble its keys.
+ * @param value The value to hash.
+ * @return The hash.
+ */
+uint64_t fnvHash64(uint64_t value) noexcept {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (int i = 0; i < 8; ++i) {
+    hash ^= value & 0xff;
+    hash *= 0x100000001b3ull;
+    value >>= 8;
+  }
+  return hash;
+}
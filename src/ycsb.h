@@ -0,0 +1,43 @@
+/**
+ * @file ycsb.h
+ *
+ * The core workloads of the Yahoo! Cloud Serving Benchmark.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "key_distribution.h"
+
+enum class YcsbOp { Read, Update, Insert, Scan, ReadModifyWrite };
+
+/**
+ * An operation mix and request distribution, after the core workloads of
+ * YCSB (Cooper et al., "Benchmarking Cloud Serving Systems with YCSB"):
+ * - A: update heavy, 50% reads and 50% updates
+ * - B: read mostly, 95% reads and 5% updates
+ * - C: read only
+ * - D: read latest, 95% reads of recently inserted keys and 5% inserts
+ * - E: short ranges, 95% scans of up to 100 keys and 5% inserts
+ * - F: read-modify-write, 50% reads and 50% reads followed by an update
+ * Every workload except D requests keys with a scrambled Zipfian distribution
+ * with theta 0.99, so the hot keys are spread over the key space.
+ */
+struct YcsbWorkload {
+  static constexpr double kTheta = 0.99;
+  char name;
+  float read;
+  float update;
+  float insert;
+  float scan;
+  float readModifyWrite;
+  Distribution distribution;
+  unsigned maxScanLength;
+
+  YcsbOp ChooseOp(float u) const noexcept;
+};
+
+const YcsbWorkload *findYcsbWorkload(char name) noexcept;
+
+uint64_t fnvHash64(uint64_t value) noexcept;
@@ -0,0 +1,124 @@
+#include <cstdint>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "allocator.h"
+#include "bucket_array.h"
+#include "memory_accounting.h"
+
+namespace {
+
+/**
+ * Chooses an allocator for the scope of a test and goes back to glibc after.
+ */
+struct ScopedAllocator {
+  explicit ScopedAllocator(Allocator allocator) { setAllocator(allocator); }
+  ~ScopedAllocator() { setAllocator(Allocator::Glibc); }
+};
+
+bool isAligned(const void *ptr, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+}
+
+TEST(Allocator, ParsesAndPrintsNames) {
+  for (auto name : {"glibc", "tbbmalloc", "pool"}) {
+    Allocator allocator;
+    ASSERT_TRUE(parseAllocator(name, allocator));
+    std::ostringstream oss;
+    oss << allocator;
+    EXPECT_EQ(name, oss.str());
+  }
+  Allocator allocator;
+  EXPECT_TRUE(parseAllocator("TBBMalloc", allocator));
+  EXPECT_EQ(Allocator::TbbMalloc, allocator);
+  EXPECT_FALSE(parseAllocator("jemalloc", allocator));
+}
+
+TEST(Allocator, PoolHandsOutDistinctBlocksOfTheirClass) {
+  ScopedAllocator scoped(Allocator::Pool);
+  std::set<void *> blocks;
+  for (size_t bytes = 1; bytes <= Pool::kMaxBytes; bytes += 7) {
+    auto ptr = allocate(bytes);
+    ASSERT_NE(nullptr, ptr);
+    EXPECT_TRUE(isAligned(ptr, Pool::kGranule));
+    EXPECT_GE(allocationSize(ptr), bytes);
+    EXPECT_LT(allocationSize(ptr), bytes + Pool::kGranule);
+    EXPECT_TRUE(blocks.insert(ptr).second);
+  }
+  for (auto ptr : blocks)
+    deallocate(ptr);
+  // Freed blocks are handed out again.
+  auto ptr = allocate(Pool::kMaxBytes);
+  EXPECT_EQ(1u, blocks.count(ptr));
+  deallocate(ptr);
+}
+
+TEST(Allocator, PoolLeavesBigAllocationsToMalloc) {
+  ScopedAllocator scoped(Allocator::Pool);
+  auto ptr = allocate(Pool::kMaxBytes + 1);
+  ASSERT_NE(nullptr, ptr);
+  EXPECT_GE(allocationSize(ptr), Pool::kMaxBytes + 1);
+  deallocate(ptr);
+}
+
+TEST(Allocator, AlignedAllocationsAreAligned) {
+  for (auto allocator :
+       {Allocator::Glibc, Allocator::TbbMalloc, Allocator::Pool}) {
+    ScopedAllocator scoped(allocator);
+    for (size_t alignment : {16, 64, 256}) {
+      auto ptr = allocateAligned(100, alignment);
+      ASSERT_NE(nullptr, ptr);
+      EXPECT_TRUE(isAligned(ptr, alignment)) << allocator;
+      EXPECT_GE(allocationSize(ptr), 100u);
+      deallocate(ptr);
+    }
+  }
+}
+
+TEST(Allocator, FreesMemoryOfTheAllocatorsBefore) {
+  std::vector<void *> blocks;
+  for (auto allocator :
+       {Allocator::Glibc, Allocator::TbbMalloc, Allocator::Pool}) {
+    setAllocator(allocator);
+    blocks.push_back(allocate(48));
+    blocks.push_back(new int[20]);
+  }
+  setAllocator(Allocator::Glibc);
+  auto before = MemorySnapshot::Take();
+  for (size_t i = 0; i < blocks.size(); i += 2) {
+    EXPECT_GE(allocationSize(blocks[i]), 48u);
+    deallocate(blocks[i]);
+    delete[] static_cast<int *>(blocks[i + 1]);
+  }
+  EXPECT_EQ(before.frees + 3, MemorySnapshot::Take().frees);
+}
+
+TEST(Allocator, PoolBlocksCanBeFreedOnOtherThreads) {
+  ScopedAllocator scoped(Allocator::Pool);
+  std::vector<void *> blocks(1000);
+  std::thread([&] {
+    for (auto &ptr : blocks)
+      ptr = allocate(32);
+  }).join();
+  for (auto ptr : blocks) {
+    ASSERT_NE(nullptr, ptr);
+    deallocate(ptr);
+  }
+  // The blocks the thread had left over went to the others when it exited.
+  auto ptr = allocate(32);
+  EXPECT_NE(nullptr, ptr);
+  deallocate(ptr);
+}
+
+TEST(Allocator, BucketArraysComeFromTheAllocatorChosen) {
+  ScopedAllocator scoped(Allocator::Pool);
+  BucketArray<int> buckets(4, BucketLayout::Padded);
+  EXPECT_TRUE(isAligned(&buckets[0], kCacheLineSize));
+  EXPECT_EQ(4 * kCacheLineSize, allocationSize(&buckets[0]));
+}
+
+} // anonymous namespace
@@ -0,0 +1,64 @@
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+#include "arrival_schedule.h"
+#include "latency_histogram.h"
+
+namespace {
+
+TEST(ArrivalSchedule, ClosedLoopWithoutRate) {
+  ArrivalSchedule schedule;
+  EXPECT_FALSE(schedule.IsOpen());
+  schedule.Start(0.0, Arrivals::Poisson, 1);
+  EXPECT_FALSE(schedule.IsOpen());
+}
+
+TEST(ArrivalSchedule, ConstantGaps) {
+  ArrivalSchedule schedule;
+  schedule.Start(1e5, Arrivals::Constant, 1);
+  ASSERT_TRUE(schedule.IsOpen());
+  auto gap = schedule.meanGap;
+  auto first = schedule.Wait();
+  for (int i = 1; i < 100; ++i) {
+    auto due = schedule.Wait();
+    EXPECT_NEAR(static_cast<double>(due - first), i * gap, 1.0);
+    // Nothing runs before it is due.
+    EXPECT_GE(CycleClock::Now(), due);
+  }
+}
+
+TEST(ArrivalSchedule, PoissonGapsAverageToTheRate) {
+  ArrivalSchedule schedule;
+  schedule.Start(1e9, Arrivals::Poisson, 7);
+  auto gap = schedule.meanGap;
+  const int n = 100000;
+  auto first = schedule.Wait();
+  uint64_t last = first;
+  for (int i = 0; i < n; ++i)
+    last = schedule.Wait();
+  EXPECT_NEAR((last - first) / gap / n, 1.0, 0.05);
+}
+
+TEST(ArrivalSchedule, LatenessIsKept) {
+  ArrivalSchedule schedule;
+  schedule.Start(1e6, Arrivals::Constant, 1);
+  auto first = schedule.Wait();
+  // Fall behind by many gaps: the operations that were due meanwhile are due
+  // at once, at their original times.
+  while (CycleClock::Now() < first + 100 * schedule.meanGap)
+    ;
+  auto second = schedule.Wait();
+  EXPECT_NEAR(static_cast<double>(second - first), schedule.meanGap, 1.0);
+}
+
+TEST(Arrivals, ParsesNames) {
+  Arrivals arrivals;
+  ASSERT_TRUE(parseArrivals("Constant", arrivals));
+  EXPECT_EQ(arrivals, Arrivals::Constant);
+  ASSERT_TRUE(parseArrivals("poisson", arrivals));
+  EXPECT_EQ(arrivals, Arrivals::Poisson);
+  EXPECT_FALSE(parseArrivals("bursty", arrivals));
+}
+
+} // anonymous namespace
@@ -1,5 +1,7 @@
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <numeric>
 #include <random>
 #include <thread>
 #include <utility>
@@ -8,9 +10,12 @@
 #include "gtest/gtest.h"
 
 #include "coarse_grain_list.h"
+#include "elimination_list.h"
 #include "fine_grain_list.h"
+#include "lockfree_dllist.h"
 #include "lockfree_list.h"
 #include "nonblocking_list.h"
+#include "tagged_lockfree_list.h"
 
 namespace {
 
@@ -95,15 +100,117 @@ TYPED_TEST_P(IntAsyncListTest, CanInsertAndRemoveItemsWithoutDeadlock) {
   EXPECT_TRUE(this->intList.Empty());
 }
 
+TYPED_TEST_P(IntAsyncListTest, ForEachSeesStableElementsDuringWrites) {
+  constexpr int kStable = 100;
+  constexpr int kChurn = kIntsPerThread;
+  for (int i = 0; i < kStable; ++i)
+    this->intList.Insert(i);
+
+  std::atomic_bool done{false};
+  std::thread writer([this, &done] {
+    for (int i = 0; i < kChurn; ++i) {
+      this->intList.Insert(kStable + i);
+      this->intList.Remove(kStable + i);
+    }
+    done = true;
+  });
+
+  // Elements that are in the list for the whole scan are always seen.
+  do {
+    int seen = 0;
+    this->intList.ForEach([&seen](const int &value) {
+      if (value < kStable)
+        ++seen;
+    });
+    EXPECT_EQ(kStable, seen);
+  } while (not done.load());
+  writer.join();
+
+  EXPECT_EQ(static_cast<unsigned>(kStable), this->intList.Size());
+}
+
+// Every thread tries to remove every value, in its own order. A linearizable
+// Remove succeeds for exactly one of them per value.
+TYPED_TEST_P(IntAsyncListTest, ConcurrentRemovesSucceedExactlyOnce) {
+  constexpr int kValues = 1000;
+  for (int i = 0; i < kValues; ++i)
+    this->intList.Insert(i);
+
+  std::vector<std::vector<int>> successes(kNumThreads,
+                                          std::vector<int>(kValues));
+  std::thread threads[kNumThreads];
+  for (int t = 0; t < kNumThreads; ++t)
+    threads[t] = std::thread([this, t, &successes] {
+      std::vector<int> values(kValues);
+      std::iota(values.begin(), values.end(), 0);
+      std::shuffle(values.begin(), values.end(),
+                   std::default_random_engine(t * 13));
+      for (auto v : values)
+        successes[t][v] += this->intList.Remove(v);
+    });
+  std::for_each(threads, threads + kNumThreads,
+                std::mem_fn(&std::thread::join));
+
+  for (int v = 0; v < kValues; ++v) {
+    int total = 0;
+    for (auto &s : successes)
+      total += s[v];
+    EXPECT_EQ(1, total) << "value " << v;
+    EXPECT_FALSE(this->intList.Contains(v));
+  }
+  EXPECT_TRUE(this->intList.Empty());
+}
+
+// Every thread tries to insert every value with InsertUnique, in its own order.
+// Exactly one of them may succeed per value.
+TYPED_TEST_P(IntAsyncListTest, ConcurrentInsertUniqueSucceedsExactlyOnce) {
+  constexpr int kValues = 1000;
+
+  std::vector<std::vector<int>> successes(kNumThreads,
+                                          std::vector<int>(kValues));
+  std::thread threads[kNumThreads];
+  for (int t = 0; t < kNumThreads; ++t)
+    threads[t] = std::thread([this, t, &successes] {
+      std::vector<int> values(kValues);
+      std::iota(values.begin(), values.end(), 0);
+      std::shuffle(values.begin(), values.end(),
+                   std::default_random_engine(t * 17));
+      for (auto v : values)
+        successes[t][v] += this->intList.InsertUnique(v);
+    });
+  std::for_each(threads, threads + kNumThreads,
+                std::mem_fn(&std::thread::join));
+
+  for (int v = 0; v < kValues; ++v) {
+    int total = 0;
+    for (auto &s : successes)
+      total += s[v];
+    EXPECT_EQ(1, total) << "value " << v;
+    EXPECT_TRUE(this->intList.Contains(v));
+  }
+  EXPECT_EQ(static_cast<unsigned>(kValues), this->intList.Size());
+}
+
 REGISTER_TYPED_TEST_CASE_P(IntAsyncListTest,
-                           CanInsertAndRemoveItemsWithoutDeadlock);
+                           CanInsertAndRemoveItemsWithoutDeadlock,
+                           ForEachSeesStableElementsDuringWrites,
+                           ConcurrentRemovesSucceedExactlyOnce,
+                           ConcurrentInsertUniqueSucceedsExactlyOnce);
 INSTANTIATE_TYPED_TEST_CASE_P(CoarseGrainList, IntAsyncListTest,
                               CoarseGrainList<int>);
 INSTANTIATE_TYPED_TEST_CASE_P(FineGrainList, IntAsyncListTest,
                               FineGrainList<int>);
+INSTANTIATE_TYPED_TEST_CASE_P(CompactFineGrainList, IntAsyncListTest,
+                              CompactFineGrainList<int>);
 INSTANTIATE_TYPED_TEST_CASE_P(LockFreeList, IntAsyncListTest,
                               LockFreeList<int>);
 INSTANTIATE_TYPED_TEST_CASE_P(NonBlockingList, IntAsyncListTest,
                               NonBlockingList<int>);
+INSTANTIATE_TYPED_TEST_CASE_P(EliminationList, IntAsyncListTest,
+                              EliminationList<int>);
+INSTANTIATE_TYPED_TEST_CASE_P(LockFreeDlList, IntAsyncListTest,
+                              LockFreeDlList<int>);
+INSTANTIATE_TYPED_TEST_CASE_P(TaggedLockFreeList, IntAsyncListTest,
+                              TaggedLockFreeList<int>);
 
 } // namespace
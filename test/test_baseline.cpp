@@ -0,0 +1,108 @@
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "baseline.h"
+
+namespace {
+
+std::string writeBaseline(const char *name, const std::string &text) {
+  auto path = std::string("/tmp/synch_test_") + name + ".json";
+  std::ofstream(path) << text;
+  return path;
+}
+
+RunnerResults makeResults(const std::string &name,
+                          const std::vector<double> &runTimes) {
+  RunnerParams params;
+  params.minThreads = 1;
+  RunnerResults results(name, params);
+  std::vector<RepeatSample> repeats;
+  for (auto t : runTimes)
+    repeats.push_back({t, 1000});
+  results.repeats.push_back(repeats);
+  return results;
+}
+
+BaselineCell makeCell(const std::string &list, unsigned threads,
+                      const std::vector<double> &runTimes) {
+  BaselineCell cell;
+  cell.list = list;
+  cell.threads = threads;
+  cell.runTimes = runTimes;
+  return cell;
+}
+
+TEST(Baseline, LoadsConfigAndCells) {
+  auto path = writeBaseline(
+      "load",
+      "{\"config\": {\"n\": 5000, \"inserts\": 0.2, \"removals\": 0.3, "
+      "\"lookups\": 0.5, \"scaling\": \"memory\", \"distribution\": "
+      "\"zipf:0.5\", \"repeat\": 4, \"minThreads\": 2, \"maxThreads\": 3, "
+      "\"allocator\": \"pool\", \"structs\": \"ycsb-AB\", "
+      "\"types\": \"finegrain,tagged\"},\n"
+      "\"results\": [\n"
+      "  {\"list\": \"A\", \"threads\": 2, \"mean\": 1.5, \"ci95\": [1, 2], "
+      "\"runtimes\": [1, 2]},\n"
+      "  {\"list\": \"A\", \"threads\": 3, \"runtimes\": [0.5]}\n]}\n");
+  Baseline baseline;
+  std::string error;
+  ASSERT_TRUE(baseline.Load(path, error)) << error;
+  unlink(path.c_str());
+  EXPECT_EQ(baseline.params.n, 5000u);
+  EXPECT_FLOAT_EQ(baseline.params.removals, 0.3f);
+  EXPECT_EQ(baseline.params.scalingMode, ScalingMode::Memory);
+  EXPECT_EQ(baseline.params.distribution.type, Distribution::Zipf);
+  EXPECT_EQ(baseline.params.repeat, 4u);
+  EXPECT_EQ(baseline.params.minThreads, 2u);
+  EXPECT_EQ(baseline.params.allocator, Allocator::Pool);
+  EXPECT_EQ(baseline.params.structs, "ycsb-AB");
+  EXPECT_EQ(baseline.params.types, "finegrain,tagged");
+  ASSERT_EQ(baseline.cells.size(), 2u);
+  ASSERT_NE(baseline.Find("A", 2), nullptr);
+  EXPECT_EQ(baseline.Find("A", 2)->runTimes, (std::vector<double>{1, 2}));
+  EXPECT_EQ(baseline.Find("A", 1), nullptr);
+  EXPECT_EQ(baseline.Find("B", 2), nullptr);
+}
+
+TEST(Baseline, RejectsMalformedFiles) {
+  Baseline baseline;
+  std::string error;
+  EXPECT_FALSE(baseline.Load("/tmp/synch_test_missing.json", error));
+  EXPECT_FALSE(error.empty());
+  auto path = writeBaseline("bad", "{\"results\": [{\"list\": 3}]}");
+  EXPECT_FALSE(baseline.Load(path, error));
+  EXPECT_FALSE(error.empty());
+  unlink(path.c_str());
+}
+
+TEST(CompareToBaseline, FlagsSignificantSlowdowns) {
+  Baseline baseline;
+  baseline.cells.push_back(makeCell("Fast", 1, {1.0, 1.1, 1.2, 1.0, 1.1}));
+  baseline.cells.push_back(makeCell("Same", 1, {1.0, 1.4, 1.2, 1.6, 1.1}));
+  baseline.cells.push_back(makeCell("Slow", 1, {2.0, 2.1, 2.2, 2.0, 2.1}));
+  std::vector<RunnerResults> results{
+      makeResults("Fast", {2.0, 2.1, 2.2, 2.3, 2.1}),
+      makeResults("Same", {1.3, 1.0, 1.5, 1.2, 1.1}),
+      makeResults("Slow", {1.0, 1.1, 1.2, 1.0, 1.1}),
+      makeResults("New", {1.0})};
+  auto comparisons = compareToBaseline(baseline, results, 0.05);
+  ASSERT_EQ(comparisons.size(), 4u);
+  EXPECT_TRUE(comparisons[0].regressed);
+  EXPECT_LT(comparisons[0].speedup, 1.0);
+  EXPECT_FALSE(comparisons[1].significant);
+  EXPECT_FALSE(comparisons[1].regressed);
+  EXPECT_TRUE(comparisons[2].significant);
+  EXPECT_FALSE(comparisons[2].regressed);
+  EXPECT_GT(comparisons[2].speedup, 1.0);
+  EXPECT_FALSE(comparisons[3].hasBaseline);
+  EXPECT_FALSE(comparisons[3].regressed);
+  // A large enough threshold lets the slowdown through.
+  EXPECT_FALSE(compareToBaseline(baseline, results, 2.0)[0].regressed);
+}
+
+} // anonymous namespace
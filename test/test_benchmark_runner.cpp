@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "benchmark_runner.h"
+#include "coarse_grain_list.h"
+#include "dllist.h"
+#include "fine_grain_list.h"
+#include "hashmap.h"
+
+namespace {
+
+template <typename K, typename V>
+using FineGrainListMap = HashMap<K, V, FineGrainList>;
+
+RunnerParams TestParams() {
+  RunnerParams params(1003, 0.2, 0.2, 0.6);
+  params.preload = 0.5;
+  params.minThreads = 1;
+  params.maxThreads = 3;
+  params.perfCounters = false;
+  return params;
+}
+
+// The numbers the workers of a run are meant to preload, in order.
+std::vector<int> PreloadedNumbers(const BenchmarkRunner &runner,
+                                  size_t nThreads) {
+  std::vector<int> expected;
+  for (size_t t = 0; t < nThreads; ++t) {
+    auto cp = runner.GetChunkParams(t, nThreads);
+    auto last = std::min(cp.startNext, cp.start + cp.nPreload);
+    for (auto j = cp.start; j < last; ++j)
+      expected.push_back(runner.numbers[j]);
+  }
+  return expected;
+}
+
+TEST(BenchmarkRunner, ParallelListPreloadLeavesTheChunkPreloads) {
+  BenchmarkRunner runner(TestParams());
+  for (size_t c = 1; c <= 3; ++c) {
+    CoarseGrainList<int> lst;
+    auto buffers = runner.PreloadList(lst, c);
+    auto expected = PreloadedNumbers(runner, c);
+
+    std::vector<int> values;
+    lst.ForEach([&values](const int &value) { values.push_back(value); });
+    std::sort(values.begin(), values.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(expected, values);
+
+    // Each worker's buffer starts with what it preloaded, in order.
+    ASSERT_EQ(c, buffers.size());
+    for (size_t t = 0; t < c; ++t) {
+      auto cp = runner.GetChunkParams(t, c);
+      ASSERT_EQ(cp.chunk, buffers[t].size());
+      auto last = std::min(cp.startNext, cp.start + cp.nPreload);
+      for (auto j = cp.start; j < last; ++j)
+        EXPECT_EQ(runner.numbers[j], buffers[t][j - cp.start]);
+    }
+  }
+}
+
+TEST(BenchmarkRunner, ParallelMapPreloadLeavesTheChunkPreloads) {
+  BenchmarkRunner runner(TestParams());
+  FineGrainListMap<int, int> hashMap(64);
+  runner.PreloadMap(hashMap, 3);
+  auto expected = PreloadedNumbers(runner, 3);
+
+  EXPECT_EQ(expected.size(), hashMap.Size());
+  for (auto num : expected) {
+    int value = -1;
+    EXPECT_TRUE(hashMap.Find(num, value));
+    EXPECT_EQ(num, value);
+  }
+}
+
+TEST(BenchmarkRunner, ListBuildReportsEachThreadCount) {
+  auto params = TestParams();
+  params.repeat = 2;
+  BenchmarkRunner runner(params);
+  auto results = runner.RunListBuild<CoarseGrainList>("CoarseGrainList");
+
+  EXPECT_EQ("CoarseGrainList/build", results.name);
+  ASSERT_EQ(3u, results.runTimes.size());
+  ASSERT_EQ(3u, results.repeats.size());
+  ASSERT_EQ(3u, results.memory.size());
+  ASSERT_EQ(3u, results.latencies.size());
+  EXPECT_TRUE(results.perfCounts.empty());
+  EXPECT_TRUE(results.timeSeries.empty());
+  for (size_t i = 0; i < 3; ++i) {
+    // Every number is inserted once per repeat, and nothing else is done.
+    ASSERT_EQ(2u, results.repeats[i].size());
+    for (auto &repeat : results.repeats[i])
+      EXPECT_EQ(params.n, repeat.ops);
+    EXPECT_EQ(2 * params.n, results.latencies[i].insert.count);
+    EXPECT_EQ(0u, results.latencies[i].remove.count);
+    EXPECT_EQ(0u, results.latencies[i].lookup.count);
+  }
+}
+
+TEST(BenchmarkRunner, SingleListBuildRunsOneThread) {
+  BenchmarkRunner runner(TestParams());
+  auto results = runner.RunListBuild<DlList>("DlList", true);
+  ASSERT_EQ(1u, results.runTimes.size());
+  ASSERT_EQ(1u, results.repeats.size());
+  EXPECT_EQ(runner.params.n, results.repeats[0][0].ops);
+}
+
+} // namespace
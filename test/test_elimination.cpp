@@ -0,0 +1,100 @@
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "elimination_list.h"
+
+namespace {
+
+TEST(EliminationArray, VisitWithoutPartnerIsNotEliminated) {
+  EliminationArray<int> ea;
+
+  EXPECT_FALSE(ea.Visit(1, true, true));
+  EXPECT_FALSE(ea.Visit(1, false, false));
+  for (auto &slot : ea.slots)
+    EXPECT_EQ(EliminationArray<int>::kEmpty, slot.state.load());
+}
+
+TEST(EliminationArray, InsertAndRemoveOfSameValueMeet) {
+  EliminationArray<int> ea;
+  std::atomic_bool done{false};
+  std::atomic_int eliminated{0};
+
+  std::thread inserter([&] {
+    while (not done.load())
+      if (ea.Visit(7, true, true))
+        ++eliminated;
+  });
+  while (eliminated.load() == 0)
+    if (ea.Visit(7, false, false))
+      ++eliminated;
+  done = true;
+  inserter.join();
+
+  // A match eliminates exactly one insert and one remove.
+  EXPECT_EQ(2, eliminated.load());
+}
+
+TEST(EliminationArray, DifferentValuesDoNotMeet) {
+  EliminationArray<int> ea;
+  std::atomic_bool done{false};
+  bool removeEliminated = false;
+
+  std::thread inserter([&] {
+    while (not done.load())
+      EXPECT_FALSE(ea.Visit(1, true, true));
+  });
+  for (int i = 0; i < 10000; ++i)
+    removeEliminated |= ea.Visit(2, false, false);
+  done = true;
+  inserter.join();
+
+  EXPECT_FALSE(removeEliminated);
+}
+
+TEST(EliminationList, InsertAndRemoveWorkCorrectly) {
+  EliminationList<int> lst;
+
+  EXPECT_TRUE(lst.Insert(1));
+  EXPECT_TRUE(lst.Insert(2));
+  EXPECT_TRUE(lst.Insert(3));
+  EXPECT_EQ(3u, lst.Size());
+  EXPECT_TRUE(lst.Remove(2));
+  EXPECT_FALSE(lst.Remove(2));
+  EXPECT_FALSE(lst.Contains(2));
+  EXPECT_EQ(2u, lst.Size());
+
+  std::ostringstream oss;
+  oss << lst;
+  EXPECT_EQ("(3,1)", oss.str());
+}
+
+TEST(EliminationList, PairedChurnLeavesListConsistent) {
+  constexpr int kThreads = 4;
+  constexpr int kRounds = 5000;
+  EliminationList<int> lst;
+  std::atomic_int removed{0};
+  std::thread threads[kThreads];
+
+  for (int t = 0; t < kThreads; ++t) {
+    threads[t] = std::thread([&, t] {
+      for (int i = 0; i < kRounds; ++i) {
+        lst.Insert(t);
+        if (lst.Remove(t))
+          ++removed;
+      }
+    });
+  }
+  for (auto &t : threads)
+    t.join();
+
+  // Each thread only removes its own values, so every remove must succeed.
+  EXPECT_EQ(kThreads * kRounds, removed.load());
+  EXPECT_TRUE(lst.Empty());
+  for (int t = 0; t < kThreads; ++t)
+    EXPECT_FALSE(lst.Contains(t));
+}
+
+} // namespace
@@ -0,0 +1,61 @@
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "fine_grain_list.h"
+#include "futex_lock.h"
+
+namespace {
+
+TEST(FutexLock, TryLockFailsWhileLocked) {
+  FutexLock lck;
+
+  EXPECT_TRUE(lck.try_lock());
+  EXPECT_FALSE(lck.try_lock());
+  lck.unlock();
+  EXPECT_EQ(0u, lck.state.load());
+  EXPECT_TRUE(lck.try_lock());
+  lck.unlock();
+}
+
+TEST(FutexLock, ProvidesMutualExclusion) {
+  constexpr int kThreads = 4;
+  constexpr int kIncrements = 20000;
+  FutexLock lck;
+  int counter = 0;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t)
+    threads.emplace_back([&] {
+      for (int i = 0; i < kIncrements; ++i) {
+        std::lock_guard<FutexLock> guard(lck);
+        ++counter;
+      }
+    });
+  for (auto &thread : threads)
+    thread.join();
+
+  EXPECT_EQ(kThreads * kIncrements, counter);
+  EXPECT_EQ(0u, lck.state.load());
+}
+
+TEST(FutexLock, WorksWithStdLock) {
+  FutexLock a, b;
+
+  std::lock(a, b);
+  EXPECT_FALSE(a.try_lock());
+  EXPECT_FALSE(b.try_lock());
+  a.unlock();
+  b.unlock();
+}
+
+TEST(FutexLock, ShrinksFineGrainNodesAndLists) {
+  EXPECT_EQ(4u, sizeof(FutexLock));
+  EXPECT_LT(sizeof(FineGrainNode<int, FutexLock>),
+            sizeof(FineGrainNode<int, std::mutex>));
+  EXPECT_LT(sizeof(CompactFineGrainList<int>), sizeof(FineGrainList<int>));
+}
+
+} // namespace
@@ -1,3 +1,5 @@
+#include <cstdint>
+#include <map>
 #include <sstream>
 #include <string>
 
@@ -5,11 +7,14 @@
 
 #include "coarse_grain_list.h"
 #include "dllist.h"
+#include "elimination_list.h"
 #include "fine_grain_list.h"
 #include "hashmap.h"
 #include "libcuckoo_hashmap.h"
+#include "lockfree_dllist.h"
 #include "lockfree_list.h"
 #include "nonblocking_list.h"
+#include "tagged_lockfree_list.h"
 #include "tbb_hashmap.h"
 
 namespace {
@@ -82,15 +87,57 @@ TYPED_TEST_P(StringHashMapTest, RemoveWorksCorrectly) {
   EXPECT_EQ(1u, this->hm.Size());
 }
 
+TYPED_TEST_P(StringHashMapTest, FindAndUpdateWorkCorrectly) {
+  this->hm.Insert("color", "blue");
+  this->hm.Insert("hair", "brown");
+
+  std::string value;
+  EXPECT_TRUE(this->hm.Find("color", value));
+  EXPECT_EQ("blue", value);
+  EXPECT_FALSE(this->hm.Find("size", value));
+  EXPECT_EQ("blue", value);
+
+  EXPECT_TRUE(this->hm.Update("color", "red"));
+  EXPECT_FALSE(this->hm.Update("size", "small"));
+  EXPECT_TRUE(this->hm.Find("color", value));
+  EXPECT_EQ("red", value);
+  EXPECT_FALSE(this->hm.Has("size"));
+  EXPECT_EQ(2u, this->hm.Size());
+}
+
+TYPED_TEST_P(StringHashMapTest, ForEachVisitsAllPairs) {
+  this->hm.Insert("color", "blue");
+  this->hm.Insert("hair", "brown");
+  this->hm.Insert("size", "small");
+  this->hm.Remove("size");
+
+  std::map<std::string, std::string> pairs;
+  this->hm.ForEach([&pairs](const std::string &key, const std::string &value) {
+    pairs[key] = value;
+  });
+
+  std::map<std::string, std::string> expected = {{"color", "blue"},
+                                                 {"hair", "brown"}};
+  EXPECT_EQ(expected, pairs);
+}
+
 using DlListStringHashMap = HashMap<std::string, std::string, DlList>;
 using CoarseGrainListStringHashMap =
     HashMap<std::string, std::string, CoarseGrainList>;
 using FineGrainListStringHashMap =
     HashMap<std::string, std::string, FineGrainList>;
+using CompactFineGrainListStringHashMap =
+    HashMap<std::string, std::string, CompactFineGrainList>;
 using NonBlockingListStringHashMap =
     HashMap<std::string, std::string, NonBlockingList>;
 using LockFreeListStringHashMap =
     HashMap<std::string, std::string, LockFreeList>;
+using EliminationListStringHashMap =
+    HashMap<std::string, std::string, EliminationList>;
+using LockFreeDlListStringHashMap =
+    HashMap<std::string, std::string, LockFreeDlList>;
+using TaggedLockFreeListStringHashMap =
+    HashMap<std::string, std::string, TaggedLockFreeList>;
 using LibCuckooStringHashMap = LibCuckooHashMap<std::string, std::string>;
 using TbbStringHashMap = TbbHashMap<std::string, std::string>;
 
@@ -98,19 +145,93 @@ REGISTER_TYPED_TEST_CASE_P(StringHashMapTest, SizeWorksCorrectly,
                            HasWorksCorrectly, InsertGetWorksCorrectly,
                            GetsNonExistingWorksCorrectly,
                            ReadWithSubscriptWorksCorrectly,
-                           RemoveWorksCorrectly);
+                           RemoveWorksCorrectly, FindAndUpdateWorkCorrectly,
+                           ForEachVisitsAllPairs);
 
 INSTANTIATE_TYPED_TEST_CASE_P(DlList, StringHashMapTest, DlListStringHashMap);
 INSTANTIATE_TYPED_TEST_CASE_P(CoarseGrainList, StringHashMapTest,
                               CoarseGrainListStringHashMap);
 INSTANTIATE_TYPED_TEST_CASE_P(FineGrainList, StringHashMapTest,
                               FineGrainListStringHashMap);
+INSTANTIATE_TYPED_TEST_CASE_P(CompactFineGrainList, StringHashMapTest,
+                              CompactFineGrainListStringHashMap);
 INSTANTIATE_TYPED_TEST_CASE_P(NonBlockingList, StringHashMapTest,
                               NonBlockingListStringHashMap);
 INSTANTIATE_TYPED_TEST_CASE_P(LockFreeList, StringHashMapTest,
                               LockFreeListStringHashMap);
+INSTANTIATE_TYPED_TEST_CASE_P(EliminationList, StringHashMapTest,
+                              EliminationListStringHashMap);
+INSTANTIATE_TYPED_TEST_CASE_P(LockFreeDlList, StringHashMapTest,
+                              LockFreeDlListStringHashMap);
+INSTANTIATE_TYPED_TEST_CASE_P(TaggedLockFreeList, StringHashMapTest,
+                              TaggedLockFreeListStringHashMap);
 INSTANTIATE_TYPED_TEST_CASE_P(LibCuckooHashMap, StringHashMapTest,
                               LibCuckooStringHashMap);
 INSTANTIATE_TYPED_TEST_CASE_P(TbbHashMap, StringHashMapTest, TbbStringHashMap);
 
+template <typename TMap> void CheckForEachCanWriteToTheMap() {
+  // Few buckets, so the writes land in the buckets being scanned.
+  TMap hm(4);
+  for (char c = 'a'; c <= 'p'; ++c)
+    hm.Insert(std::string(1, c), "old");
+
+  // Each key is replaced with a longer one, which is skipped if it is seen.
+  hm.ForEach([&hm](const std::string &key, const std::string &value) {
+    if (key.size() > 1)
+      return;
+    EXPECT_EQ("old", value);
+    EXPECT_TRUE(hm.Update(key, "new"));
+    EXPECT_TRUE(hm.Remove(key));
+    EXPECT_TRUE(hm.Insert(key + key, "new"));
+  });
+
+  std::map<std::string, std::string> pairs;
+  hm.ForEach([&pairs](const std::string &key, const std::string &value) {
+    pairs[key] = value;
+  });
+  EXPECT_EQ(16u, pairs.size());
+  for (char c = 'a'; c <= 'p'; ++c)
+    EXPECT_EQ("new", pairs[std::string(2, c)]);
+  EXPECT_EQ(16u, hm.Size());
+}
+
+TEST(HashMap, ForEachCanWriteToFineGrainListMap) {
+  CheckForEachCanWriteToTheMap<FineGrainListStringHashMap>();
+}
+
+TEST(HashMap, ForEachCanWriteToCompactFineGrainListMap) {
+  CheckForEachCanWriteToTheMap<CompactFineGrainListStringHashMap>();
+}
+
+TEST(HashMap, ForEachCanWriteToNonBlockingListMap) {
+  CheckForEachCanWriteToTheMap<NonBlockingListStringHashMap>();
+}
+
+TEST(HashMap, PaddedBucketsAreOnTheirOwnCacheLines) {
+  FineGrainListStringHashMap hm(8, BucketLayout::Padded);
+
+  for (size_t i = 0; i < hm.nBuckets; ++i) {
+    auto addr = reinterpret_cast<uintptr_t>(&hm.buckets[i]);
+    EXPECT_EQ(0u, addr % kCacheLineSize);
+  }
+  EXPECT_EQ(0u, hm.buckets.stride % kCacheLineSize);
+  EXPECT_GE(hm.buckets.stride, sizeof(FineGrainList<int>));
+
+  EXPECT_TRUE(hm.Insert("color", "blue"));
+  EXPECT_TRUE(hm.Insert("hair", "brown"));
+  EXPECT_TRUE(hm.Has("color"));
+  EXPECT_TRUE(hm.Remove("color"));
+  EXPECT_FALSE(hm.Has("color"));
+  EXPECT_EQ(1u, hm.Size());
+}
+
+TEST(HashMap, PackedBucketsAreNextToEachOther) {
+  LockFreeListStringHashMap hm(8);
+
+  EXPECT_EQ(sizeof(LockFreeList<LockFreeListStringHashMap::Element>),
+            hm.buckets.stride);
+  EXPECT_EQ(reinterpret_cast<char *>(&hm.buckets[0]) + hm.buckets.stride,
+            reinterpret_cast<char *>(&hm.buckets[1]));
+}
+
 } // namespace
@@ -0,0 +1,71 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "key_distribution.h"
+
+namespace {
+
+std::string toString(const DistributionParams &dp) {
+  std::ostringstream oss;
+  oss << dp;
+  return oss.str();
+}
+
+TEST(KeyDistribution, ParsesValidDistributions) {
+  DistributionParams dp;
+
+  EXPECT_TRUE(parseDistribution("uniform", dp));
+  EXPECT_EQ(Distribution::Uniform, dp.type);
+
+  EXPECT_TRUE(parseDistribution("zipf", dp));
+  EXPECT_EQ(Distribution::Zipf, dp.type);
+  EXPECT_DOUBLE_EQ(DistributionParams::kDefaultTheta, dp.theta);
+
+  EXPECT_TRUE(parseDistribution("Zipf:0.5", dp));
+  EXPECT_EQ("zipf:0.5", toString(dp));
+
+  EXPECT_TRUE(parseDistribution("hotspot:0.8,0.2", dp));
+  EXPECT_EQ(Distribution::Hotspot, dp.type);
+  EXPECT_EQ("hotspot:0.8,0.2", toString(dp));
+
+  EXPECT_TRUE(parseDistribution("latest", dp));
+  EXPECT_EQ(Distribution::Latest, dp.type);
+}
+
+TEST(KeyDistribution, RejectsInvalidDistributions) {
+  DistributionParams dp;
+
+  for (auto s : {"", "normal", "uniform:1", "zipf:1", "zipf:0", "zipf:x",
+                 "hotspot", "hotspot:0.8", "hotspot:1.5,0.2", "hotspot:0.8,1",
+                 "latest:0.5,0.5"})
+    EXPECT_FALSE(parseDistribution(s, dp)) << s;
+}
+
+TEST(ZipfGenerator, RanksAreInRangeAndSkewed) {
+  constexpr size_t kN = 1000;
+  constexpr int kDraws = 100000;
+  ZipfGenerator zipf(kN, 0.99);
+  std::vector<int> counts(kN);
+
+  for (int i = 0; i < kDraws; ++i) {
+    auto rank = zipf((i + 0.5) / kDraws);
+    ASSERT_LT(rank, kN);
+    ++counts[rank];
+  }
+  // With theta close to 1, rank 0 is about twice as likely as rank 1, which
+  // is more likely than anything further down.
+  EXPECT_NEAR(kDraws / zipf.zetan, counts[0], kDraws * 0.01);
+  EXPECT_GT(counts[0], counts[1]);
+  EXPECT_GT(counts[1], counts[10]);
+  EXPECT_GT(counts[10], counts[kN - 1]);
+}
+
+TEST(ZipfGenerator, ZetaWorksCorrectly) {
+  EXPECT_DOUBLE_EQ(1.0, ZipfGenerator::Zeta(1, 0.5));
+  EXPECT_DOUBLE_EQ(1.0 + 1.0 / 2 + 1.0 / 3, ZipfGenerator::Zeta(3, 1.0));
+}
+
+} // namespace
@@ -0,0 +1,72 @@
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+#include "latency_histogram.h"
+
+namespace {
+
+TEST(LatencyHistogram, SmallValuesAreExact) {
+  for (uint64_t v = 0; v < LatencyHistogram::kSubBuckets; ++v)
+    EXPECT_EQ(v, LatencyHistogram::BucketHighest(
+                     LatencyHistogram::BucketIndex(v)));
+}
+
+TEST(LatencyHistogram, BucketsCoverEveryValueWithBoundedError) {
+  unsigned prevIndex = 0;
+  for (unsigned shift = 0; shift < 64; ++shift) {
+    for (uint64_t v : {uint64_t{1} << shift, (uint64_t{1} << shift) + 1,
+                       (uint64_t{1} << shift) * 3 / 2, ~uint64_t{0} >> shift}) {
+      auto index = LatencyHistogram::BucketIndex(v);
+      ASSERT_LT(index, LatencyHistogram::kBuckets);
+      auto highest = LatencyHistogram::BucketHighest(index);
+      EXPECT_LE(v, highest);
+      EXPECT_LE(highest - v, v / LatencyHistogram::kSubBuckets);
+    }
+    // Indices grow with the values.
+    auto index = LatencyHistogram::BucketIndex(uint64_t{1} << shift);
+    EXPECT_LE(prevIndex, index);
+    prevIndex = index;
+  }
+  EXPECT_EQ(LatencyHistogram::kBuckets - 1,
+            LatencyHistogram::BucketIndex(~uint64_t{0}));
+}
+
+TEST(LatencyHistogram, PercentilesWorkCorrectly) {
+  LatencyHistogram hist;
+
+  EXPECT_EQ(0u, hist.Percentile(50));
+  for (uint64_t v = 1; v <= 1000; ++v)
+    hist.Record(v);
+  hist.Record(1000000);
+
+  EXPECT_EQ(1001u, hist.count);
+  EXPECT_EQ(1000000u, hist.max);
+  EXPECT_NEAR(501.0, hist.Percentile(50), 501.0 / 32);
+  EXPECT_NEAR(991.0, hist.Percentile(99), 991.0 / 32);
+  EXPECT_EQ(1000000u, hist.Percentile(100));
+  EXPECT_EQ(1u, hist.Percentile(0));
+}
+
+TEST(LatencyHistogram, MergeAddsCountsAndKeepsLargestMax) {
+  LatencyHistogram a, b;
+
+  a.Record(10);
+  a.Record(20);
+  b.Record(5000);
+  a.Merge(b);
+
+  EXPECT_EQ(3u, a.count);
+  EXPECT_EQ(5000u, a.max);
+  EXPECT_EQ(10u, a.Percentile(33));
+  EXPECT_EQ(20u, a.Percentile(66));
+  EXPECT_EQ(5000u, a.Percentile(100));
+}
+
+TEST(CycleClock, TicksForward) {
+  auto start = CycleClock::Now();
+  EXPECT_GT(CycleClock::NsPerTick(), 0.0);
+  EXPECT_LT(start, CycleClock::Now());
+}
+
+} // namespace
@@ -1,4 +1,6 @@
+#include <set>
 #include <sstream>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -166,6 +168,91 @@ TYPED_TEST_P(IntListTest, EqualityOpWorksCorrectly) {
   EXPECT_NE(this->intList, this->otherIntList);
 }
 
+TYPED_TEST_P(IntListTest, InsertRangeWorksCorrectly) {
+  std::vector<int> numbers = {1, 2, 3};
+  EXPECT_EQ(0u, this->intList.InsertRange(numbers.begin(), numbers.begin()));
+  EXPECT_EQ(3u, this->intList.InsertRange(numbers.begin(), numbers.end()));
+  EXPECT_EQ(3u, this->intList.Size());
+  EXPECT_EQ(nullptr, this->intList.head->prev);
+
+  this->otherIntList.Insert(4);
+  this->otherIntList.InsertRange(numbers.begin(), numbers.end());
+  EXPECT_EQ(4u, this->otherIntList.Size());
+
+  std::ostringstream oss, oss1;
+  oss << this->intList;
+  EXPECT_EQ("(3,2,1)", oss.str());
+  oss1 << this->otherIntList;
+  EXPECT_EQ("(3,2,1,4)", oss1.str());
+  EXPECT_EQ(this->otherIntList.head, this->otherIntList.head->next->prev);
+}
+
+TYPED_TEST_P(IntListTest, RemoveIfWorksCorrectly) {
+  for (int i = 0; i < 10; ++i)
+    this->intList.Insert(i);
+
+  auto isEven = [](const int &value) { return value % 2 == 0; };
+  EXPECT_EQ(5u, this->intList.RemoveIf(isEven));
+  EXPECT_EQ(0u, this->intList.RemoveIf(isEven));
+  EXPECT_EQ(5u, this->intList.Size());
+  EXPECT_EQ(nullptr, this->intList.head->prev);
+  EXPECT_EQ(this->intList.head, this->intList.head->next->prev);
+
+  std::ostringstream oss;
+  oss << this->intList;
+  EXPECT_EQ("(9,7,5,3,1)", oss.str());
+
+  EXPECT_EQ(5u, this->intList.RemoveIf([](const int &) { return true; }));
+  EXPECT_TRUE(this->intList.Empty());
+  EXPECT_EQ(nullptr, this->intList.head);
+}
+
+TYPED_TEST_P(IntListTest, RemoveAllWorksCorrectly) {
+  for (int i = 0; i < 5; ++i)
+    this->intList.Insert(i);
+
+  EXPECT_EQ(3u, this->intList.RemoveAll(std::set<int>{0, 2, 4, 100}));
+  EXPECT_EQ(2u, this->intList.Size());
+  EXPECT_TRUE(this->intList.Contains(1));
+  EXPECT_TRUE(this->intList.Contains(3));
+  EXPECT_FALSE(this->intList.Contains(2));
+}
+
+TYPED_TEST_P(IntListTest, ContainsAllWorksCorrectly) {
+  std::vector<int> none;
+  std::vector<int> some = {1, 3, 3, 5};
+  std::vector<int> missing = {1, 2, 3};
+  EXPECT_TRUE(this->intList.ContainsAll(none.begin(), none.end()));
+  EXPECT_FALSE(this->intList.ContainsAll(some.begin(), some.end()));
+
+  for (int i = 5; i > 0; i -= 2)
+    this->intList.Insert(i);
+
+  EXPECT_TRUE(this->intList.ContainsAll(some.begin(), some.end()));
+  EXPECT_FALSE(this->intList.ContainsAll(missing.begin(), missing.end()));
+}
+
+TYPED_TEST_P(IntListTest, IteratorVisitsAllElements) {
+  EXPECT_TRUE(this->intList.begin() == this->intList.end());
+
+  for (int i = 1; i <= 3; ++i)
+    this->intList.Insert(i);
+
+  std::vector<int> values;
+  for (auto &value : this->intList)
+    values.push_back(value);
+  EXPECT_EQ((std::vector<int>{3, 2, 1}), values);
+}
+
+TYPED_TEST_P(IntListTest, ForEachVisitsAllElements) {
+  for (int i = 1; i <= 3; ++i)
+    this->intList.Insert(i);
+
+  int sum = 0;
+  this->intList.ForEach([&sum](const int &value) { sum += value; });
+  EXPECT_EQ(6, sum);
+}
+
 REGISTER_TYPED_TEST_CASE_P(IntListTest, DefaultCtorInitalizesListCorrectly,
                            InsertWorksCorrectly, InsertUniqueWorksCorrectly,
                            RemoveCanRemoveWhenListOnlyHasOne,
@@ -174,11 +261,16 @@ REGISTER_TYPED_TEST_CASE_P(IntListTest, DefaultCtorInitalizesListCorrectly,
                            RemoveCanRemoveLastOfMany, ContainsWorksCorrectly,
                            FindWorksCorrectly, SizeWorksCorrectly,
                            EmptyWorksCorrectly, OutputOpWorksCorrectly,
-                           EqualityOpWorksCorrectly);
+                           EqualityOpWorksCorrectly, InsertRangeWorksCorrectly,
+                           RemoveIfWorksCorrectly, RemoveAllWorksCorrectly,
+                           ContainsAllWorksCorrectly, IteratorVisitsAllElements,
+                           ForEachVisitsAllElements);
 INSTANTIATE_TYPED_TEST_CASE_P(DlList, IntListTest, DlList<int>);
 INSTANTIATE_TYPED_TEST_CASE_P(CoarseGrainList, IntListTest,
                               CoarseGrainList<int>);
 INSTANTIATE_TYPED_TEST_CASE_P(FineGrainList, IntListTest, FineGrainList<int>);
+INSTANTIATE_TYPED_TEST_CASE_P(CompactFineGrainList, IntListTest,
+                              CompactFineGrainList<int>);
 INSTANTIATE_TYPED_TEST_CASE_P(NonBlockingList, IntListTest,
                               NonBlockingList<int>);
 
@@ -0,0 +1,132 @@
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "coarse_grain_list.h"
+#include "dllist.h"
+#include "fine_grain_list.h"
+#include "hashmap.h"
+#include "list_stats.h"
+#include "lockfree_dllist.h"
+#include "lockfree_list.h"
+#include "nonblocking_list.h"
+#include "tagged_lockfree_list.h"
+
+namespace {
+
+/**
+ * Counts the list operations of the calling thread for the scope of a test.
+ */
+struct ScopedListCounters {
+  ListCounters counters;
+  ScopedListCounters() { ListCounters::current = &counters; }
+  ~ScopedListCounters() { ListCounters::current = nullptr; }
+};
+
+TEST(ListStats, CompilesAwayUnlessEnabled) {
+#ifdef SYNCH_LIST_STATS
+  EXPECT_TRUE((std::is_same<DefaultListStats, CountingListStats>::value));
+#else
+  EXPECT_TRUE((std::is_same<DefaultListStats, NoListStats>::value));
+#endif
+  EXPECT_TRUE((std::is_same<LockFreeList<int>,
+                            LockFreeList<int, DefaultListStats>>::value));
+  EXPECT_TRUE(std::is_empty<NoListStats>::value);
+}
+
+TEST(ListStats, NoListStatsCountsNothing) {
+  ScopedListCounters scoped;
+  LockFreeList<int, NoListStats> lst;
+  for (int i = 0; i < 10; ++i)
+    lst.InsertUnique(i);
+  lst.Contains(0);
+  lst.Remove(5);
+  EXPECT_FALSE(scoped.counters.Any());
+}
+
+TEST(ListStats, NothingIsCountedWithoutCounters) {
+  LockFreeList<int, CountingListStats> lst;
+  for (int i = 0; i < 10; ++i)
+    lst.InsertUnique(i);
+  EXPECT_TRUE(lst.Contains(0));
+}
+
+template <typename TList> void ExpectContainsHops() {
+  TList lst;
+  for (int i = 0; i < 100; ++i)
+    lst.Insert(i);
+  ScopedListCounters scoped;
+  // Inserted at the front, so 0 is the last node and 99 the first.
+  EXPECT_TRUE(lst.Contains(0));
+  EXPECT_EQ(100u, scoped.counters.hops);
+  EXPECT_TRUE(lst.Contains(99));
+  EXPECT_EQ(101u, scoped.counters.hops);
+  EXPECT_FALSE(lst.Contains(100));
+  EXPECT_EQ(201u, scoped.counters.hops);
+  EXPECT_EQ(0u, scoped.counters.casFailures);
+  EXPECT_EQ(0u, scoped.counters.restarts);
+}
+
+TEST(ListStats, ContainsCountsTheNodesItVisits) {
+  ExpectContainsHops<DlList<int, CountingListStats>>();
+  ExpectContainsHops<CoarseGrainList<int, CountingListStats>>();
+  ExpectContainsHops<FineGrainList<int, CountingListStats>>();
+  ExpectContainsHops<CompactFineGrainList<int, CountingListStats>>();
+  ExpectContainsHops<NonBlockingList<int, CountingListStats>>();
+  ExpectContainsHops<LockFreeList<int, CountingListStats>>();
+  ExpectContainsHops<LockFreeDlList<int, CountingListStats>>();
+}
+
+TEST(ListStats, SearchCountsTheNodesItVisits) {
+  TaggedLockFreeList<int, CountingListStats> lst;
+  for (int i = 0; i < 100; ++i)
+    lst.Insert(i);
+  ScopedListCounters scoped;
+  EXPECT_TRUE(lst.Contains(0));
+  EXPECT_EQ(100u, scoped.counters.hops);
+  EXPECT_TRUE(lst.Remove(0));
+  EXPECT_EQ(200u, scoped.counters.hops);
+  EXPECT_EQ(0u, scoped.counters.restarts);
+}
+
+TEST(ListStats, HashMapCountsItsBuckets) {
+  HashMap<int, int, LockFreeList, CountingListStats> map(1);
+  for (int i = 0; i < 10; ++i)
+    map.Insert(i, i);
+  ScopedListCounters scoped;
+  // InsertUnique appends, so 9 is the last node of the single bucket.
+  EXPECT_TRUE(map.Has(9));
+  EXPECT_EQ(10u, scoped.counters.hops);
+}
+
+TEST(ListStats, CountsEachThreadSeparately) {
+  LockFreeList<int, CountingListStats> lst;
+  const int nThreads = 4;
+  const int nValues = 2000;
+  std::vector<ListCounters> counters(nThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nThreads; ++t)
+    threads.emplace_back([&, t] {
+      ListCounters::current = &counters[t];
+      for (int i = 0; i < nValues; ++i) {
+        lst.InsertUnique(i);
+        lst.Remove(i);
+      }
+      ListCounters::current = nullptr;
+    });
+  for (auto &thread : threads)
+    thread.join();
+  ListCounters total;
+  for (auto &c : counters) {
+    EXPECT_TRUE(c.hops);
+    total.Merge(c);
+  }
+  EXPECT_EQ(counters[0].hops + counters[1].hops + counters[2].hops +
+                counters[3].hops,
+            total.hops);
+  EXPECT_EQ(0u, lst.Size());
+}
+
+} // anonymous namespace
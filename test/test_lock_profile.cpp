@@ -0,0 +1,118 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "gtest/gtest.h"
+
+#include "coarse_grain_list.h"
+#include "futex_lock.h"
+#include "lock_profile.h"
+#include "nonblocking_list.h"
+
+namespace {
+
+/**
+ * Records the locks the calling thread takes for the scope of a test.
+ */
+struct ScopedLockStats {
+  LockStats stats;
+  ScopedLockStats() { LockStats::current = &stats; }
+  ~ScopedLockStats() { LockStats::current = nullptr; }
+};
+
+TEST(LockProfile, CompilesAwayUnlessEnabled) {
+  EXPECT_EQ(LockStats::kEnabled,
+            (std::is_same<Profiled<std::mutex>,
+                          ProfiledLock<std::mutex>>::value));
+  EXPECT_EQ(not LockStats::kEnabled,
+            (std::is_same<Profiled<FutexLock>, FutexLock>::value));
+}
+
+TEST(LockProfile, CountsUncontendedAcquisitionsAndHolds) {
+  ScopedLockStats scoped;
+  ProfiledLock<std::mutex> mtx;
+  for (int i = 0; i < 10; ++i) {
+    std::lock_guard<ProfiledLock<std::mutex>> guard(mtx);
+  }
+  EXPECT_TRUE(mtx.try_lock());
+  mtx.unlock();
+  EXPECT_EQ(11u, scoped.stats.acquisitions);
+  EXPECT_EQ(0u, scoped.stats.contended);
+  EXPECT_EQ(0u, scoped.stats.wait.count);
+  EXPECT_EQ(11u, scoped.stats.hold.count);
+}
+
+TEST(LockProfile, TimesContendedWaits) {
+  ScopedLockStats scoped;
+  ProfiledLock<FutexLock> lck;
+  std::atomic<bool> locked{false};
+  std::thread holder([&] {
+    lck.lock();
+    locked = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    lck.unlock();
+  });
+  while (not locked)
+    std::this_thread::yield();
+  EXPECT_FALSE(lck.try_lock());
+  lck.lock();
+  lck.unlock();
+  holder.join();
+  // The holder does not record, so only the waiter is counted.
+  EXPECT_EQ(1u, scoped.stats.acquisitions);
+  EXPECT_EQ(1u, scoped.stats.contended);
+  ASSERT_EQ(1u, scoped.stats.wait.count);
+  EXPECT_GT(scoped.stats.wait.max * CycleClock::NsPerTick(), 1e6);
+}
+
+TEST(LockProfile, ProfilesReadAndWriteLocks) {
+  ScopedLockStats scoped;
+  ProfiledLock<RwLock> lck;
+  lck.ReadLock();
+  lck.ReadLock();
+  EXPECT_FALSE(lck.inner.TryWriteLock());
+  lck.ReadUnlock();
+  lck.ReadUnlock();
+  lck.WriteLock();
+  EXPECT_FALSE(lck.inner.TryReadLock());
+  lck.WriteUnlock();
+  EXPECT_EQ(3u, scoped.stats.acquisitions);
+  EXPECT_EQ(0u, scoped.stats.contended);
+  // Only the write lock is held exclusively.
+  EXPECT_EQ(1u, scoped.stats.hold.count);
+}
+
+TEST(LockProfile, RecordsNothingWithoutStats) {
+  ProfiledLock<std::mutex> mtx;
+  mtx.lock();
+  EXPECT_EQ(0u, mtx.acquired);
+  mtx.unlock();
+}
+
+TEST(LockProfile, ProfilesTheListsWhenEnabled) {
+  ScopedLockStats scoped;
+  CoarseGrainList<int> lst;
+  lst.Insert(1);
+  lst.Contains(1);
+  lst.Remove(1);
+  EXPECT_EQ(LockStats::kEnabled ? 3u : 0u, scoped.stats.acquisitions);
+}
+
+TEST(LockStats, MergeAddsUp) {
+  LockStats a, b;
+  a.acquisitions = 3;
+  a.contended = 1;
+  a.wait.Record(100);
+  b.acquisitions = 4;
+  b.contended = 2;
+  b.hold.Record(50);
+  a.Merge(b);
+  EXPECT_EQ(7u, a.acquisitions);
+  EXPECT_EQ(3u, a.contended);
+  EXPECT_EQ(1u, a.wait.count);
+  EXPECT_EQ(1u, a.hold.count);
+}
+
+} // anonymous namespace
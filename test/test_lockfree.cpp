@@ -1,4 +1,7 @@
+#include <set>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -132,4 +135,93 @@ TEST(IntListTest, OutputOpWorksCorrectly) {
   EXPECT_EQ("(6,2,1)", oss2.str());
 }
 
+TEST(LockFreeList, InsertRangeWorksCorrectly) {
+  LockFreeList<int> lf;
+  std::vector<int> numbers = {1, 2, 3};
+
+  lf.Insert(4);
+  EXPECT_EQ(3u, lf.InsertRange(numbers.begin(), numbers.end()));
+  EXPECT_EQ(4u, lf.Size());
+
+  std::ostringstream oss;
+  oss << lf;
+  EXPECT_EQ("(3,2,1,4)", oss.str());
+}
+
+TEST(LockFreeList, RemoveIfAndRemoveAllWorkCorrectly) {
+  LockFreeList<int> lf;
+  for (int i = 0; i < 10; ++i)
+    lf.Insert(i);
+
+  EXPECT_EQ(5u, lf.RemoveIf([](const int &value) { return value % 2 == 0; }));
+  EXPECT_EQ(2u, lf.RemoveAll(std::set<int>{1, 9, 100}));
+  EXPECT_EQ(3u, lf.Size());
+
+  std::ostringstream oss;
+  oss << lf;
+  EXPECT_EQ("(7,5,3)", oss.str());
+
+  // Deleted nodes are also physically unlinked.
+  auto node = lf.head->next.load();
+  while (node != lf.tail) {
+    EXPECT_FALSE(LockFreeList<int>::is_marked(node->next));
+    node = node->next;
+  }
+}
+
+TEST(LockFreeList, ContainsAllWorksCorrectly) {
+  LockFreeList<int> lf;
+  std::vector<int> some = {1, 3, 3, 5};
+  std::vector<int> missing = {1, 2, 3};
+
+  for (int i = 5; i > 0; i -= 2)
+    lf.Insert(i);
+
+  EXPECT_TRUE(lf.ContainsAll(some.begin(), some.end()));
+  EXPECT_FALSE(lf.ContainsAll(missing.begin(), missing.end()));
+}
+
+TEST(LockFreeList, ConcurrentRemoveIfRemovesEachValueOnce) {
+  constexpr int kThreads = 4;
+  constexpr int kValues = 10000;
+  LockFreeList<int> lf;
+  std::vector<int> numbers;
+  for (int i = 0; i < kValues; ++i)
+    numbers.push_back(i);
+  lf.InsertRange(numbers.begin(), numbers.end());
+
+  unsigned removed[kThreads];
+  std::thread threads[kThreads];
+  for (int t = 0; t < kThreads; ++t)
+    threads[t] = std::thread([&lf, &removed, t] {
+      removed[t] = lf.RemoveIf([](const int &) { return true; });
+    });
+  for (auto &t : threads)
+    t.join();
+
+  unsigned total = 0;
+  for (auto r : removed)
+    total += r;
+  EXPECT_EQ(static_cast<unsigned>(kValues), total);
+  EXPECT_TRUE(lf.Empty());
+}
+
+TEST(LockFreeList, IteratorSkipsDeletedNodes) {
+  LockFreeList<int> lf;
+  for (int i = 1; i <= 4; ++i)
+    lf.Insert(i);
+
+  // Logically delete 3 without unlinking it.
+  auto node = lf.head->next.load()->next.load();
+  ASSERT_EQ(3, node->value);
+  node->next = LockFreeList<int>::get_marked(node->next);
+
+  std::vector<int> values(lf.begin(), lf.end());
+  EXPECT_EQ((std::vector<int>{4, 2, 1}), values);
+
+  int sum = 0;
+  lf.ForEach([&sum](const int &value) { sum += value; });
+  EXPECT_EQ(7, sum);
+}
+
 } // namespace
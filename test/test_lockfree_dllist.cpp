@@ -0,0 +1,160 @@
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "lockfree_dllist.h"
+
+namespace {
+
+TEST(LockFreeDlList, DefaultCtorInitalizesListCorrectly) {
+  LockFreeDlList<int> lst;
+
+  EXPECT_EQ(0u, lst.size);
+  EXPECT_EQ(lst.tail, lst.head->next);
+  EXPECT_EQ(lst.head, lst.tail->prev);
+}
+
+TEST(LockFreeDlList, InsertLinksBothDirections) {
+  LockFreeDlList<int> lst;
+
+  lst.Insert(1);
+  lst.Insert(2);
+  auto first = lst.head->next.load();
+  auto second = first->next.load();
+  EXPECT_EQ(2, first->value);
+  EXPECT_EQ(1, second->value);
+  EXPECT_EQ(lst.head, first->prev);
+  EXPECT_EQ(first, second->prev);
+  EXPECT_EQ(second, lst.tail->prev);
+}
+
+TEST(LockFreeDlList, InsertUniqueAppendsCorrectly) {
+  LockFreeDlList<int> lst;
+
+  EXPECT_TRUE(lst.Insert(1));
+  EXPECT_FALSE(lst.InsertUnique(1));
+  EXPECT_TRUE(lst.InsertUnique(2));
+  EXPECT_FALSE(lst.InsertUnique(2));
+  EXPECT_TRUE(lst.InsertUnique(3));
+  EXPECT_EQ(3u, lst.Size());
+
+  std::ostringstream oss;
+  oss << lst;
+  EXPECT_EQ("(1,2,3)", oss.str());
+}
+
+TEST(LockFreeDlList, RemoveWorksCorrectly) {
+  LockFreeDlList<int> lst;
+
+  lst.Insert(1);
+  lst.Insert(2);
+  lst.Insert(3);
+  EXPECT_TRUE(lst.Remove(2));
+  EXPECT_FALSE(lst.Remove(2));
+  EXPECT_FALSE(lst.Contains(2));
+  EXPECT_TRUE(lst.Contains(1));
+  EXPECT_TRUE(lst.Contains(3));
+  EXPECT_EQ(2u, lst.Size());
+
+  auto first = lst.head->next.load();
+  EXPECT_EQ(3, first->value);
+  EXPECT_EQ(1, first->next.load()->value);
+  EXPECT_EQ(first, first->next.load()->prev);
+
+  EXPECT_TRUE(lst.Remove(3));
+  EXPECT_TRUE(lst.Remove(1));
+  EXPECT_TRUE(lst.Empty());
+  EXPECT_EQ(lst.tail, lst.head->next);
+  EXPECT_EQ(lst.head, lst.tail->prev);
+}
+
+TEST(LockFreeDlList, FindWorksCorrectly) {
+  LockFreeDlList<int> lst;
+
+  lst.Insert(5);
+  int value = 5;
+  EXPECT_TRUE(lst.Find(value));
+  value = 6;
+  EXPECT_FALSE(lst.Find(value));
+}
+
+TEST(LockFreeDlList, CursorTraversesBothWays) {
+  LockFreeDlList<int> lst;
+  for (int i = 1; i <= 4; ++i)
+    lst.InsertUnique(i);
+
+  std::vector<int> forward, backward;
+  auto cursor = lst.Begin();
+  while (cursor.Next())
+    forward.push_back(cursor.Value());
+  EXPECT_TRUE(cursor.AtTail());
+  while (cursor.Prev())
+    backward.push_back(cursor.Value());
+  EXPECT_TRUE(cursor.AtHead());
+
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 4}), forward);
+  EXPECT_EQ((std::vector<int>{4, 3, 2, 1}), backward);
+}
+
+TEST(LockFreeDlList, CursorInsertsAndRemoves) {
+  LockFreeDlList<int> lst;
+  lst.InsertUnique(1);
+  lst.InsertUnique(3);
+
+  auto cursor = lst.Begin();
+  ASSERT_TRUE(cursor.Next());
+  EXPECT_TRUE(cursor.InsertAfter(2));
+  EXPECT_EQ(2, cursor.Value());
+  EXPECT_TRUE(cursor.InsertBefore(0));
+  EXPECT_EQ(0, cursor.Value());
+
+  std::ostringstream oss;
+  oss << lst;
+  EXPECT_EQ("(1,0,2,3)", oss.str());
+
+  EXPECT_TRUE(cursor.Remove());
+  EXPECT_FALSE(cursor.Remove());
+  EXPECT_TRUE(cursor.Next());
+  EXPECT_EQ(2, cursor.Value());
+  EXPECT_TRUE(cursor.Prev());
+  EXPECT_EQ(1, cursor.Value());
+
+  auto end = lst.End();
+  EXPECT_TRUE(end.InsertBefore(4));
+  EXPECT_EQ(4u, lst.Size());
+
+  std::ostringstream oss1;
+  oss1 << lst;
+  EXPECT_EQ("(1,2,3,4)", oss1.str());
+}
+
+TEST(LockFreeDlList, ConcurrentBackwardScanSeesStableElements) {
+  constexpr int kStable = 100;
+  constexpr int kChurn = 10000;
+  LockFreeDlList<int> lst;
+  for (int i = 0; i < kStable; ++i)
+    lst.InsertUnique(i);
+
+  std::thread writer([&] {
+    for (int i = 0; i < kChurn; ++i) {
+      lst.Insert(kStable + i);
+      lst.Remove(kStable + i);
+    }
+  });
+
+  // Elements that are never removed have to be seen by every backward scan.
+  for (int r = 0; r < 100; ++r) {
+    auto cursor = lst.End();
+    int seen = 0;
+    while (cursor.Prev())
+      if (cursor.Value() < kStable)
+        ++seen;
+    EXPECT_EQ(kStable, seen);
+  }
+  writer.join();
+  EXPECT_EQ(static_cast<unsigned>(kStable), lst.Size());
+}
+
+} // namespace
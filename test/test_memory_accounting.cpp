@@ -0,0 +1,68 @@
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "bucket_array.h"
+#include "memory_accounting.h"
+
+namespace {
+
+TEST(MemoryAccounting, CountsNewAndDelete) {
+  auto before = MemorySnapshot::Take();
+  auto ptr = ::operator new(1000);
+  auto allocated = MemorySnapshot::Take();
+  EXPECT_EQ(before.allocations + 1, allocated.allocations);
+  EXPECT_LE(before.LiveBytes() + 1000, allocated.LiveBytes());
+  ::operator delete(ptr);
+  auto freed = MemorySnapshot::Take();
+  EXPECT_EQ(allocated.frees + 1, freed.frees);
+  EXPECT_EQ(before.LiveBytes(), freed.LiveBytes());
+}
+
+TEST(MemoryAccounting, CountsBucketArrays) {
+  auto before = MemorySnapshot::Take();
+  {
+    BucketArray<int> buckets(100, BucketLayout::Padded);
+    auto after = MemorySnapshot::Take();
+    EXPECT_LE(before.LiveBytes() + 100 * static_cast<int64_t>(kCacheLineSize),
+              after.LiveBytes());
+  }
+  EXPECT_EQ(before.LiveBytes(), MemorySnapshot::Take().LiveBytes());
+}
+
+TEST(MemoryAccounting, CountingAllocatorCountsItsMemory) {
+  auto before = MemorySnapshot::Take();
+  {
+    std::vector<int, CountingAllocator<int, std::allocator>> v(256);
+    EXPECT_LE(before.LiveBytes() + 256 * static_cast<int64_t>(sizeof(int)),
+              MemorySnapshot::Take().LiveBytes());
+  }
+  EXPECT_EQ(before.LiveBytes(), MemorySnapshot::Take().LiveBytes());
+}
+
+TEST(MemoryAccounting, UsageLeavesOutOtherBytesAndAddsUpOps) {
+  MemorySnapshot built, runStart, runEnd;
+  built.allocations = 10;
+  built.bytesAllocated = 1000;
+  runStart.allocations = 110;
+  runStart.bytesAllocated = 5000;
+  runEnd.allocations = 150;
+  runEnd.frees = 20;
+  runEnd.bytesAllocated = 6000;
+  runEnd.bytesFreed = 800;
+
+  MemoryUsage usage;
+  usage.Add(built, runStart, runEnd, 100, 80, 200);
+  EXPECT_EQ(4000, usage.liveBytes);
+  EXPECT_DOUBLE_EQ(40.0, usage.BytesPerElement());
+  EXPECT_DOUBLE_EQ(0.5, usage.AllocationsPerOp());
+
+  usage.Add(built, runStart, runEnd, 100, 80, 200);
+  EXPECT_EQ(80u, usage.allocations);
+  EXPECT_EQ(40u, usage.frees);
+  EXPECT_EQ(160u, usage.ops);
+  EXPECT_GT(usage.peakRss, 0u);
+}
+
+} // anonymous namespace
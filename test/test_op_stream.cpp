@@ -0,0 +1,37 @@
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+#include "op_stream.h"
+
+namespace {
+
+TEST(OpStream, PackKeepsOpAndFraction) {
+  for (unsigned op = 0; op < (1u << OpStream::kOpBits); ++op) {
+    for (float u : {0.0f, 0.25f, 0.5f, 0.999f}) {
+      auto entry = OpStream::Pack(op, u);
+      EXPECT_EQ(op, OpStream::Op(entry));
+      EXPECT_NEAR(u, OpStream::Fraction(entry), 1e-6);
+    }
+  }
+}
+
+TEST(OpStream, IndexStaysInRange) {
+  for (size_t n : {1u, 2u, 7u, 1000u, 1u << 30}) {
+    EXPECT_EQ(0u, OpStream::Index(OpStream::Pack(0, 0.0f), n));
+    EXPECT_LT(OpStream::Index(OpStream::Pack(3, 0.99999994f), n), n);
+    EXPECT_EQ(n / 2, OpStream::Index(OpStream::Pack(1, 0.5f), n));
+  }
+}
+
+TEST(OpStream, NextWrapsAround) {
+  OpStream stream;
+  stream.entries = {1, 2, 3};
+  for (int round = 0; round < 3; ++round) {
+    EXPECT_EQ(1u, stream.Next());
+    EXPECT_EQ(2u, stream.Next());
+    EXPECT_EQ(3u, stream.Next());
+  }
+}
+
+} // anonymous namespace
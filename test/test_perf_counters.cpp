@@ -0,0 +1,60 @@
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+#include "perf_counters.h"
+
+namespace {
+
+// Counters are often unavailable in containers and VMs, so the tests only
+// check the counts that could be read.
+TEST(PerfCounterGroup, CountsWhatIsAvailable) {
+  PerfCounterGroup group;
+  group.Start();
+  volatile uint64_t sum = 0;
+  for (uint64_t i = 0; i < 1000000; ++i)
+    sum = sum + i;
+  auto counts = group.Stop();
+  if (not group.IsOpen()) {
+    EXPECT_FALSE(counts.Any());
+    return;
+  }
+  if (counts.Available(PerfEvent::Instructions)) {
+    EXPECT_GE(counts[PerfEvent::Instructions], 1000000u);
+  }
+  if (counts.Available(PerfEvent::Cycles)) {
+    EXPECT_GT(counts[PerfEvent::Cycles], 0u);
+  }
+}
+
+TEST(PerfCounterGroup, DisabledGroupCountsNothing) {
+  PerfCounterGroup group(false);
+  EXPECT_FALSE(group.IsOpen());
+  group.Start();
+  EXPECT_FALSE(group.Stop().Any());
+}
+
+TEST(PerfCounts, MergeAddsAndKeepsCommonCounters) {
+  PerfCounts a, b;
+  a.values = {100, 200, 3, 4, 5};
+  a.available = {true, true, true, true, false};
+  a.ops = 10;
+  b.values = {300, 600, 1, 0, 7};
+  b.available = {true, true, true, false, true};
+  b.ops = 30;
+
+  PerfCounts merged;
+  merged.Merge(a);
+  merged.Merge(b);
+  EXPECT_EQ(400u, merged[PerfEvent::Cycles]);
+  EXPECT_EQ(800u, merged[PerfEvent::Instructions]);
+  EXPECT_EQ(40u, merged.ops);
+  EXPECT_TRUE(merged.Available(PerfEvent::BranchMisses));
+  EXPECT_FALSE(merged.Available(PerfEvent::LlcMisses));
+  EXPECT_FALSE(merged.Available(PerfEvent::DtlbMisses));
+  EXPECT_DOUBLE_EQ(2.0, merged.Ipc());
+  EXPECT_DOUBLE_EQ(0.1, merged.PerOp(PerfEvent::BranchMisses));
+  EXPECT_DOUBLE_EQ(0.0, merged.PerOp(PerfEvent::LlcMisses));
+}
+
+} // anonymous namespace
@@ -0,0 +1,76 @@
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "statistics.h"
+
+namespace {
+
+TEST(Summarize, EmptySample) {
+  auto s = summarize({});
+  EXPECT_EQ(s.count, 0u);
+  EXPECT_EQ(s.mean, 0.0);
+  EXPECT_EQ(s.stddev, 0.0);
+}
+
+TEST(Summarize, SingleValueHasNoSpread) {
+  auto s = summarize({2.5});
+  EXPECT_EQ(s.count, 1u);
+  EXPECT_EQ(s.mean, 2.5);
+  EXPECT_EQ(s.median, 2.5);
+  EXPECT_EQ(s.stddev, 0.0);
+  EXPECT_EQ(s.ciLow, 2.5);
+  EXPECT_EQ(s.ciHigh, 2.5);
+}
+
+TEST(Summarize, OddSample) {
+  auto s = summarize({5.0, 1.0, 3.0});
+  EXPECT_EQ(s.count, 3u);
+  EXPECT_DOUBLE_EQ(s.mean, 3.0);
+  EXPECT_DOUBLE_EQ(s.median, 3.0);
+  EXPECT_DOUBLE_EQ(s.min, 1.0);
+  EXPECT_DOUBLE_EQ(s.max, 5.0);
+  EXPECT_DOUBLE_EQ(s.stddev, 2.0);
+  // t(2) = 4.303, and the standard error is 2 / sqrt(3).
+  EXPECT_NEAR(s.ciHigh - s.mean, 4.303 * 2.0 / std::sqrt(3.0), 1e-9);
+  EXPECT_NEAR(s.mean - s.ciLow, s.ciHigh - s.mean, 1e-12);
+}
+
+TEST(Summarize, EvenSampleMedian) {
+  auto s = summarize({4.0, 1.0, 2.0, 3.0});
+  EXPECT_DOUBLE_EQ(s.median, 2.5);
+}
+
+TEST(StudentT95, ApproachesNormal) {
+  EXPECT_DOUBLE_EQ(studentT95(1), 12.706);
+  EXPECT_DOUBLE_EQ(studentT95(30), 2.042);
+  EXPECT_DOUBLE_EQ(studentT95(1000), 1.960);
+  for (size_t df = 1; df < 40; ++df)
+    EXPECT_GE(studentT95(df), studentT95(df + 1));
+}
+
+TEST(MannWhitneyP, SeparatedSamples) {
+  // With four values on each side, complete separation has p = 2 / C(8, 4).
+  EXPECT_NEAR(mannWhitneyP({1, 2, 3, 4}, {5, 6, 7, 8}), 2.0 / 70.0, 1e-12);
+  EXPECT_NEAR(mannWhitneyP({5, 6, 7, 8}, {1, 2, 3, 4}), 2.0 / 70.0, 1e-12);
+  // And with three it is 0.1, never significant at 5%.
+  EXPECT_NEAR(mannWhitneyP({1, 2, 3}, {4, 5, 6}), 0.1, 1e-12);
+}
+
+TEST(MannWhitneyP, InterleavedSamples) {
+  EXPECT_DOUBLE_EQ(mannWhitneyP({1, 4, 5, 8}, {2, 3, 6, 7}), 1.0);
+  EXPECT_GT(mannWhitneyP({1, 3, 5, 7, 9}, {2, 4, 6, 8, 10}), 0.5);
+}
+
+TEST(MannWhitneyP, TiesUseNormalApproximation) {
+  std::vector<double> a(20, 1.0), b(20, 2.0);
+  EXPECT_LT(mannWhitneyP(a, b), 1e-6);
+  EXPECT_DOUBLE_EQ(mannWhitneyP(a, a), 1.0);
+}
+
+TEST(MannWhitneyP, EmptySample) {
+  EXPECT_EQ(mannWhitneyP({}, {1.0, 2.0}), 1.0);
+}
+
+} // anonymous namespace
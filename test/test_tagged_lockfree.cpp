@@ -0,0 +1,153 @@
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "tagged_lockfree_list.h"
+
+namespace {
+
+TEST(TaggedPtr, NextBumpsVersionAndKeepsMarkSeparate) {
+  int a = 0, b = 0;
+  TaggedPtr<int> tp{&a, 0};
+
+  auto next = tp.Next(&b);
+  EXPECT_EQ(&b, next.ptr);
+  EXPECT_FALSE(next.Marked());
+  EXPECT_NE(tp.tag, next.tag);
+
+  auto marked = next.Next(&b, true);
+  EXPECT_TRUE(marked.Marked());
+  EXPECT_FALSE(marked.Next(&a).Marked());
+  // Same pointer and mark, different version.
+  EXPECT_NE(tp, next.Next(&b).Next(&a));
+}
+
+TEST(TaggedPtr, CasFailsOnStaleVersion) {
+  int a = 0, b = 0;
+  TaggedPtr<int> tp{&a, 0};
+  auto stale = taggedLoad(&tp);
+
+  EXPECT_TRUE(taggedCas(&tp, stale, stale.Next(&b)));
+  auto current = taggedLoad(&tp);
+  EXPECT_TRUE(taggedCas(&tp, current, current.Next(&a)));
+  // tp points to a again, but the old value must not match.
+  EXPECT_EQ(&a, tp.ptr);
+  EXPECT_FALSE(taggedCas(&tp, stale, stale.Next(&b)));
+  EXPECT_EQ(&a, tp.ptr);
+}
+
+TEST(TaggedLockFreeList, DefaultCtorInitalizesListCorrectly) {
+  TaggedLockFreeList<int> lst;
+
+  EXPECT_EQ(0u, lst.size);
+  EXPECT_EQ(lst.tail, lst.head->next.ptr);
+}
+
+TEST(TaggedLockFreeList, InsertAndInsertUniqueWorkCorrectly) {
+  TaggedLockFreeList<int> lst;
+
+  EXPECT_TRUE(lst.Insert(1));
+  EXPECT_FALSE(lst.InsertUnique(1));
+  EXPECT_TRUE(lst.Insert(2));
+  EXPECT_TRUE(lst.InsertUnique(3));
+  EXPECT_FALSE(lst.InsertUnique(3));
+  EXPECT_EQ(3u, lst.Size());
+
+  std::ostringstream oss;
+  oss << lst;
+  EXPECT_EQ("(2,1,3)", oss.str());
+}
+
+TEST(TaggedLockFreeList, RemoveWorksCorrectly) {
+  TaggedLockFreeList<int> lst;
+
+  lst.Insert(1);
+  lst.Insert(2);
+  lst.Insert(3);
+  EXPECT_TRUE(lst.Remove(2));
+  EXPECT_FALSE(lst.Remove(2));
+  EXPECT_FALSE(lst.Contains(2));
+  EXPECT_TRUE(lst.Contains(1));
+  EXPECT_TRUE(lst.Contains(3));
+  EXPECT_TRUE(lst.Remove(3));
+  EXPECT_TRUE(lst.Remove(1));
+  EXPECT_TRUE(lst.Empty());
+  EXPECT_EQ(lst.tail, lst.head->next.ptr);
+}
+
+TEST(TaggedLockFreeList, FindWorksCorrectly) {
+  TaggedLockFreeList<int> lst;
+
+  lst.Insert(5);
+  int value = 5;
+  EXPECT_TRUE(lst.Find(value));
+  value = 6;
+  EXPECT_FALSE(lst.Find(value));
+}
+
+TEST(TaggedLockFreeList, RemovedNodesAreRecycled) {
+  TaggedLockFreeList<int> lst;
+
+  lst.Insert(1);
+  auto node = lst.head->next.ptr;
+  auto generation = node->generation.load();
+  lst.Remove(1);
+  EXPECT_EQ(node, lst.freeList.ptr);
+
+  lst.Insert(2);
+  EXPECT_EQ(node, lst.head->next.ptr);
+  EXPECT_EQ(2, node->value);
+  EXPECT_NE(generation, node->generation.load());
+  EXPECT_EQ(nullptr, lst.freeList.ptr);
+}
+
+TEST(TaggedLockFreeList, NodesWithNonTrivialValuesAreNotRecycled) {
+  TaggedLockFreeList<std::string> lst;
+
+  lst.Insert("a");
+  auto node = lst.head->next.ptr;
+  lst.Remove("a");
+  EXPECT_EQ(node, lst.freeList.ptr);
+
+  lst.Insert("b");
+  EXPECT_NE(node, lst.head->next.ptr);
+  EXPECT_EQ(node, lst.freeList.ptr);
+}
+
+TEST(TaggedLockFreeList, ConcurrentRecyclingKeepsStableElements) {
+  constexpr int kStable = 100;
+  constexpr int kChurn = 20000;
+  constexpr int kWriters = 3;
+  TaggedLockFreeList<int> lst;
+  for (int i = 0; i < kStable; ++i)
+    lst.InsertUnique(i);
+
+  // The writers share a small set of values, so nodes are unlinked and reused
+  // while the other threads are still traversing them.
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kWriters; ++t)
+    writers.emplace_back([&lst, t] {
+      for (int i = 0; i < kChurn; ++i) {
+        int value = kStable + (i + t) % 8;
+        lst.Insert(value);
+        lst.Remove(value);
+      }
+    });
+
+  for (int r = 0; r < 200; ++r)
+    for (int i = 0; i < kStable; i += 7)
+      EXPECT_TRUE(lst.Contains(i));
+  for (auto &writer : writers)
+    writer.join();
+
+  EXPECT_EQ(static_cast<unsigned>(kStable), lst.Size());
+  for (int i = 0; i < kStable; ++i)
+    EXPECT_TRUE(lst.Contains(i));
+  for (int i = kStable; i < kStable + 8; ++i)
+    EXPECT_FALSE(lst.Contains(i));
+}
+
+} // namespace
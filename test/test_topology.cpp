@@ -0,0 +1,89 @@
+#include <sys/stat.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "topology.h"
+
+namespace {
+
+// Two packages, each a NUMA node with two cores of two SMT siblings, numbered
+// the way most x86 machines are: first siblings first.
+const std::string kRoot = "/tmp/synch_test_topology";
+const struct {
+  unsigned cpu;
+  int package, core, node;
+} kCpus[] = {{0, 0, 0, 0}, {1, 0, 1, 0}, {2, 1, 0, 1}, {3, 1, 1, 1},
+             {4, 0, 0, 0}, {5, 0, 1, 0}, {6, 1, 0, 1}, {7, 1, 1, 1}};
+
+CpuTopology fakeTopology() {
+  mkdir(kRoot.c_str(), S_IRWXU);
+  std::vector<unsigned> allowed;
+  for (auto &c : kCpus) {
+    auto dir = kRoot + "/cpu" + std::to_string(c.cpu);
+    mkdir(dir.c_str(), S_IRWXU);
+    mkdir((dir + "/topology").c_str(), S_IRWXU);
+    mkdir((dir + "/node" + std::to_string(c.node)).c_str(), S_IRWXU);
+    std::ofstream(dir + "/topology/core_id") << c.core << '\n';
+    std::ofstream(dir + "/topology/physical_package_id") << c.package << '\n';
+    allowed.push_back(c.cpu);
+  }
+  return CpuTopology::Read(kRoot, allowed);
+}
+
+TEST(CpuTopology, ReadsSysfs) {
+  auto topology = fakeTopology();
+  ASSERT_EQ(topology.cpus.size(), 8u);
+  EXPECT_EQ(topology.cpus[6].package, 1);
+  EXPECT_EQ(topology.cpus[6].core, 0);
+  EXPECT_EQ(topology.cpus[6].node, 1);
+  EXPECT_EQ(topology.cpus[2].smt, 0u);
+  EXPECT_EQ(topology.cpus[6].smt, 1u);
+}
+
+TEST(CpuTopology, MissingFilesMakeEveryCpuACore) {
+  auto topology = CpuTopology::Read("/nonexistent", {0, 1, 2});
+  ASSERT_EQ(topology.cpus.size(), 3u);
+  for (auto &c : topology.cpus) {
+    EXPECT_EQ(c.core, static_cast<int>(c.cpu));
+    EXPECT_EQ(c.smt, 0u);
+    EXPECT_EQ(c.package, 0);
+    EXPECT_EQ(c.node, 0);
+  }
+  EXPECT_EQ(topology.Order(Placement::PhysicalFirst),
+            (std::vector<unsigned>{0, 1, 2}));
+}
+
+TEST(CpuTopology, Orders) {
+  auto topology = fakeTopology();
+  using V = std::vector<unsigned>;
+  EXPECT_EQ(topology.Order(Placement::None), V{});
+  EXPECT_EQ(topology.Order(Placement::Linear), (V{0, 1, 2, 3, 4, 5, 6, 7}));
+  EXPECT_EQ(topology.Order(Placement::Compact), (V{0, 4, 1, 5, 2, 6, 3, 7}));
+  EXPECT_EQ(topology.Order(Placement::Scatter), (V{0, 2, 1, 3, 4, 6, 5, 7}));
+  EXPECT_EQ(topology.Order(Placement::PhysicalFirst),
+            (V{0, 1, 2, 3, 4, 5, 6, 7}));
+  EXPECT_EQ(topology.Order(Placement::NumaRoundRobin),
+            (V{0, 2, 1, 3, 4, 6, 5, 7}));
+}
+
+TEST(CpuTopology, AssignWrapsAround) {
+  auto topology = fakeTopology();
+  EXPECT_EQ(topology.Assign(Placement::Compact, 10),
+            (std::vector<int>{0, 4, 1, 5, 2, 6, 3, 7, 0, 4}));
+  EXPECT_EQ(topology.Assign(Placement::None, 2), (std::vector<int>{-1, -1}));
+}
+
+TEST(Placement, ParsesNames) {
+  Placement placement;
+  ASSERT_TRUE(parsePlacement("physical-first", placement));
+  EXPECT_EQ(placement, Placement::PhysicalFirst);
+  ASSERT_TRUE(parsePlacement("NUMA-RR", placement));
+  EXPECT_EQ(placement, Placement::NumaRoundRobin);
+  EXPECT_FALSE(parsePlacement("sideways", placement));
+}
+
+} // anonymous namespace
@@ -0,0 +1,123 @@
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "coarse_grain_list.h"
+#include "hashmap.h"
+#include "trace.h"
+
+namespace {
+
+template <typename K, typename V>
+using CoarseGrainListMap = HashMap<K, V, CoarseGrainList>;
+
+std::string tracePath(const char *name) {
+  return std::string("/tmp/synch_test_") + name + ".trace";
+}
+
+TEST(Trace, RecordedMapOperationsReadBack) {
+  auto path = tracePath("map");
+  TraceWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  TraceWriter::active = &writer;
+  RecordingMap<CoarseGrainListMap>::Type<int, int> map(16);
+  EXPECT_TRUE(map.Insert(1, 10));
+  EXPECT_TRUE(map.Insert(2, 20));
+  EXPECT_TRUE(map.Has(1));
+  EXPECT_TRUE(map.Update(2, 21));
+  EXPECT_TRUE(map.Remove(1));
+  EXPECT_FALSE(map.Has(1));
+  TraceWriter::active = nullptr;
+  ASSERT_TRUE(writer.Close());
+
+  TraceFile trace;
+  std::string error;
+  ASSERT_TRUE(trace.Open(path, error)) << error;
+  ASSERT_EQ(6u, trace.nRecords);
+  const TraceOp ops[] = {TraceOp::Insert, TraceOp::Insert, TraceOp::Lookup,
+                         TraceOp::Update, TraceOp::Remove, TraceOp::Lookup};
+  const int keys[] = {1, 2, 1, 2, 1, 1};
+  for (size_t i = 0; i < trace.nRecords; ++i) {
+    EXPECT_EQ(ops[i], trace.records[i].op);
+    EXPECT_EQ(keys[i], trace.records[i].key);
+    EXPECT_EQ(trace.records[0].thread, trace.records[i].thread);
+  }
+  EXPECT_EQ(sizeof(int), trace.records[0].valueSize);
+  EXPECT_EQ(0u, trace.records[2].valueSize);
+  std::remove(path.c_str());
+}
+
+TEST(Trace, RecordsTheThreadOfEachOperation) {
+  auto path = tracePath("threads");
+  TraceWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  TraceWriter::active = &writer;
+  RecordingList<CoarseGrainList>::Type<int> lst;
+  lst.InsertUnique(1);
+  std::thread([&] { lst.Remove(1); }).join();
+  TraceWriter::active = nullptr;
+  ASSERT_TRUE(writer.Close());
+
+  TraceFile trace;
+  std::string error;
+  ASSERT_TRUE(trace.Open(path, error)) << error;
+  ASSERT_EQ(2u, trace.nRecords);
+  EXPECT_NE(trace.records[0].thread, trace.records[1].thread);
+  std::remove(path.c_str());
+}
+
+TEST(Trace, SlicesCoverEveryRecordOnce) {
+  auto path = tracePath("slices");
+  TraceWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  for (int i = 0; i < 103; ++i)
+    writer.Append(TraceOp::Insert, i);
+  ASSERT_TRUE(writer.Close());
+
+  TraceFile trace;
+  std::string error;
+  ASSERT_TRUE(trace.Open(path, error)) << error;
+  for (size_t nThreads = 1; nThreads <= 8; ++nThreads) {
+    int next = 0;
+    for (size_t t = 0; t < nThreads; ++t) {
+      auto slice = trace.Slice(t, nThreads);
+      for (size_t i = 0; i < slice.second; ++i)
+        EXPECT_EQ(next++, slice.first[i].key);
+    }
+    EXPECT_EQ(103, next);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(Trace, RejectsFilesThatAreNotTraces) {
+  auto path = tracePath("bad");
+  std::string error;
+  TraceFile missing;
+  EXPECT_FALSE(missing.Open(path, error));
+  EXPECT_FALSE(error.empty());
+
+  auto file = std::fopen(path.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  std::fputs("this is not a trace, but it is long enough", file);
+  std::fclose(file);
+  TraceFile garbage;
+  EXPECT_FALSE(garbage.Open(path, error));
+  EXPECT_FALSE(error.empty());
+
+  TraceWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  writer.Append(TraceOp::Lookup, 7);
+  writer.Append(TraceOp::Lookup, 8);
+  ASSERT_TRUE(writer.Close());
+  ASSERT_EQ(0, truncate(path.c_str(), sizeof(TraceHeader) + 20));
+  TraceFile truncated;
+  EXPECT_FALSE(truncated.Open(path, error));
+  EXPECT_FALSE(error.empty());
+  std::remove(path.c_str());
+}
+
+} // anonymous namespace
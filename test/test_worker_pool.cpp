@@ -0,0 +1,59 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "worker_pool.h"
+
+namespace {
+
+TEST(WorkerPool, RunsTaskOnceOnEachActiveWorker) {
+  WorkerPool pool(4);
+  ASSERT_EQ(4u, pool.Size());
+  for (int run = 0; run < 100; ++run) {
+    for (size_t c = 1; c <= pool.Size(); ++c) {
+      std::vector<std::atomic<int>> calls(pool.Size());
+      for (auto &n : calls)
+        n = 0;
+      pool.Run(c, [&](size_t t) { ++calls[t]; });
+      for (size_t t = 0; t < pool.Size(); ++t)
+        EXPECT_EQ(t < c ? 1 : 0, calls[t].load());
+    }
+  }
+}
+
+TEST(WorkerPool, CallerIsWorkerZero) {
+  WorkerPool pool(2);
+  std::thread::id ids[2];
+  pool.Run(2, [&](size_t t) { ids[t] = std::this_thread::get_id(); });
+  EXPECT_EQ(std::this_thread::get_id(), ids[0]);
+  EXPECT_NE(ids[0], ids[1]);
+}
+
+TEST(WorkerPool, NoWorkerStartsBeforeAllHaveArrived) {
+  WorkerPool pool(3);
+  std::vector<size_t> arrived(3);
+  for (int run = 0; run < 100; ++run) {
+    pool.Run(3, [&](size_t t) { arrived[t] = pool.arrived.load(); });
+    for (auto n : arrived)
+      EXPECT_EQ(3u, n);
+  }
+}
+
+TEST(WorkerPool, TimesOnlyTheRegionBetweenTheClocks) {
+  using namespace std::chrono;
+  WorkerPool pool(2);
+  auto seconds = pool.Run(2, [&](size_t t) {
+    std::this_thread::sleep_for(milliseconds(50));
+    pool.StartClock(t);
+    std::this_thread::sleep_for(milliseconds(10));
+    pool.StopClock(t);
+    std::this_thread::sleep_for(milliseconds(50));
+  });
+  EXPECT_GE(seconds, 0.009);
+  EXPECT_LT(seconds, 0.080);
+}
+
+} // anonymous namespace